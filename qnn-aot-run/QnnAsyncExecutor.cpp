@@ -0,0 +1,252 @@
+#include "QnnAsyncExecutor.h"
+#include <chrono>
+#include <cstdio>
+
+static uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+AsyncExecutor::AsyncExecutor(const QnnInterface_t *interface, uint32_t depth, bool force_emulation)
+    : interface_(interface),
+      depth_(depth ? depth : 1),
+      emulated_(force_emulation || interface->QNN_INTERFACE_VER_NAME.graphExecuteAsync == nullptr)
+{
+    if (emulated_)
+        printf("AsyncExecutor: emulating graphExecuteAsync with %u worker(s)\n", depth_);
+}
+
+AsyncExecutor::~AsyncExecutor()
+{
+    drain();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (std::thread &thread : workers_)
+        thread.join();
+}
+
+bool AsyncExecutor::is_unsupported(Qnn_ErrorHandle_t err)
+{
+    return err == QNN_COMMON_ERROR_NOT_SUPPORTED || err == QNN_GRAPH_ERROR_UNSUPPORTED_FEATURE;
+}
+
+uint64_t AsyncExecutor::submit(Qnn_GraphHandle_t graph,
+                               const Qnn_Tensor_t *inputs, uint32_t num_inputs,
+                               Qnn_Tensor_t *outputs, uint32_t num_outputs,
+                               void *user_data,
+                               AsyncCallback callback)
+{
+    Request *request = new Request{this, 0, graph, inputs, num_inputs, outputs, num_outputs,
+                                   user_data, std::move(callback), 0};
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint32_t &graph_in_flight = in_flight_[graph];
+        if (graph_in_flight >= depth_)
+        {
+            stats_.stalls++;
+            slot_cv_.wait(lock, [&]
+                          { return graph_in_flight < depth_; });
+        }
+
+        graph_in_flight++;
+        total_in_flight_++;
+        if (!request->callback)
+            queued_in_flight_++;
+        if (total_in_flight_ > stats_.peak_in_flight)
+            stats_.peak_in_flight = total_in_flight_;
+
+        request->id = next_id_++;
+        stats_.submitted++;
+    }
+
+    uint64_t id = request->id;
+    request->submit_ns = now_ns();
+
+    if (emulated_)
+    {
+        enqueue_emulated(request);
+        return id;
+    }
+
+    // The notify callback may run before graphExecuteAsync returns
+    Qnn_ErrorHandle_t err = interface_->QNN_INTERFACE_VER_NAME.graphExecuteAsync(
+        graph,
+        inputs, num_inputs,
+        outputs, num_outputs,
+        nullptr, // Qnn_ProfileHandle_t
+        nullptr, // Qnn_SignalHandle_t
+        &AsyncExecutor::notify,
+        request);
+
+    if (err == QNN_SUCCESS)
+        return id;
+
+    if (is_unsupported(err))
+    {
+        if (!emulated_.exchange(true))
+            printf("AsyncExecutor: graphExecuteAsync unsupported (%lu), emulating with %u worker(s)\n", err, depth_);
+        enqueue_emulated(request);
+        return id;
+    }
+
+    printf("graphExecuteAsync failed: %lu\n", err);
+    complete(request, err);
+    return id;
+}
+
+void AsyncExecutor::notify(void *param, Qnn_NotifyStatus_t status)
+{
+    Request *request = static_cast<Request *>(param);
+    request->owner->complete(request, status.error);
+}
+
+void AsyncExecutor::enqueue_emulated(Request *request)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Workers start on first use, so native backends never pay for them
+        while (workers_.size() < depth_)
+            workers_.emplace_back(&AsyncExecutor::worker, this);
+        pending_.push_back(request);
+    }
+    work_cv_.notify_one();
+}
+
+void AsyncExecutor::worker()
+{
+    for (;;)
+    {
+        Request *request = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]
+                          { return stopping_ || !pending_.empty(); });
+            if (pending_.empty())
+                return;
+
+            request = pending_.front();
+            pending_.pop_front();
+        }
+
+        Qnn_ErrorHandle_t err = interface_->QNN_INTERFACE_VER_NAME.graphExecute(
+            request->graph,
+            request->inputs, request->num_inputs,
+            request->outputs, request->num_outputs,
+            nullptr, // Qnn_ProfileHandle_t
+            nullptr  // Qnn_SignalHandle_t
+        );
+
+        if (err != QNN_SUCCESS)
+            printf("graphExecute failed: %lu\n", err);
+
+        complete(request, err);
+    }
+}
+
+void AsyncExecutor::complete(Request *request, Qnn_ErrorHandle_t error)
+{
+    AsyncCompletion completion{request->id, request->graph, error, request->user_data,
+                               now_ns() - request->submit_ns};
+
+    bool queued = !request->callback;
+    if (!queued)
+        request->callback(completion);
+
+    Qnn_GraphHandle_t graph = request->graph;
+    delete request;
+
+    // Notify under the lock: drain() may return and destroy the executor as soon as it is released
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queued)
+    {
+        completions_.push_back(completion);
+        queued_in_flight_--;
+    }
+
+    in_flight_[graph]--;
+    total_in_flight_--;
+    stats_.completed++;
+    if (error != QNN_SUCCESS)
+        stats_.failed++;
+
+    slot_cv_.notify_all();
+    done_cv_.notify_all();
+}
+
+bool AsyncExecutor::wait(AsyncCompletion &out)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]
+                  { return !completions_.empty() || queued_in_flight_ == 0; });
+    if (completions_.empty())
+        return false;
+
+    out = completions_.front();
+    completions_.pop_front();
+    return true;
+}
+
+bool AsyncExecutor::poll(AsyncCompletion &out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (completions_.empty())
+        return false;
+
+    out = completions_.front();
+    completions_.pop_front();
+    return true;
+}
+
+void AsyncExecutor::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]
+                  { return total_in_flight_ == 0; });
+}
+
+AsyncExecutorStats AsyncExecutor::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool run_async_throughput(AsyncExecutor &executor, Qnn_GraphHandle_t graph,
+                          const std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                          uint32_t num_requests)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_requests; i++)
+        executor.submit(graph, inputs.data(), inputs.size(), outputs.data(), outputs.size());
+
+    uint64_t latency_ns = 0;
+    uint64_t failed = 0;
+    AsyncCompletion completion;
+    while (executor.wait(completion))
+    {
+        latency_ns += completion.latency_ns;
+        if (completion.error != QNN_SUCCESS)
+            failed++;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("Async execute (%s, depth %u): %u requests in %.3f ms, %.1f req/s, avg latency %.3f ms\n",
+           executor.is_emulated() ? "emulated" : "graphExecuteAsync",
+           executor.depth(), num_requests, seconds * 1e3,
+           num_requests / seconds,
+           num_requests ? latency_ns / 1e6 / num_requests : 0.0);
+
+    if (failed)
+    {
+        printf("Async execute: %lu request(s) failed\n", failed);
+        return false;
+    }
+    return true;
+}
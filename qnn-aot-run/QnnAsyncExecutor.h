@@ -0,0 +1,119 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct AsyncCompletion
+{
+    uint64_t id;
+    Qnn_GraphHandle_t graph;
+    Qnn_ErrorHandle_t error;
+    void *user_data;
+    uint64_t latency_ns; // submit to completion
+};
+
+struct AsyncExecutorStats
+{
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t stalls;        // submits that waited for a free slot
+    uint64_t peak_in_flight;
+};
+
+using AsyncCallback = std::function<void(const AsyncCompletion &)>;
+
+/**
+ * Keeps up to `depth` graphExecuteAsync requests in flight per graph.
+ *
+ * Completions go to the callback given at submit, or to the completion
+ * queue read by wait()/poll(). Backends without graphExecuteAsync (or that
+ * report it as unsupported) are served by `depth` worker threads calling the
+ * blocking graphExecute, so the same code path runs against stub backends.
+ *
+ * Tensors passed to submit() and the memory behind them must stay valid
+ * until the request completes.
+ */
+class AsyncExecutor
+{
+public:
+    AsyncExecutor(const QnnInterface_t *interface, uint32_t depth, bool force_emulation = false);
+    AsyncExecutor(const AsyncExecutor &) = delete;
+    AsyncExecutor &operator=(const AsyncExecutor &) = delete;
+    ~AsyncExecutor();
+
+    // Returns the request id, blocking while the graph has `depth` requests in flight
+    uint64_t submit(Qnn_GraphHandle_t graph,
+                    const Qnn_Tensor_t *inputs, uint32_t num_inputs,
+                    Qnn_Tensor_t *outputs, uint32_t num_outputs,
+                    void *user_data = nullptr,
+                    AsyncCallback callback = nullptr);
+
+    // Next queued completion; false once nothing queued is left in flight
+    bool wait(AsyncCompletion &out);
+    bool poll(AsyncCompletion &out);
+    // Block until every submitted request has completed
+    void drain();
+
+    bool is_emulated() const { return emulated_.load(); }
+    uint32_t depth() const { return depth_; }
+    AsyncExecutorStats get_stats();
+
+private:
+    struct Request
+    {
+        AsyncExecutor *owner;
+        uint64_t id;
+        Qnn_GraphHandle_t graph;
+        const Qnn_Tensor_t *inputs;
+        uint32_t num_inputs;
+        Qnn_Tensor_t *outputs;
+        uint32_t num_outputs;
+        void *user_data;
+        AsyncCallback callback;
+        uint64_t submit_ns;
+    };
+
+    static void notify(void *param, Qnn_NotifyStatus_t status);
+    static bool is_unsupported(Qnn_ErrorHandle_t err);
+
+    void enqueue_emulated(Request *request);
+    void worker();
+    void complete(Request *request, Qnn_ErrorHandle_t error);
+
+    const QnnInterface_t *interface_;
+    uint32_t depth_;
+    std::atomic<bool> emulated_;
+
+    std::mutex mutex_;
+    std::condition_variable slot_cv_;
+    std::condition_variable done_cv_;
+    std::condition_variable work_cv_;
+
+    std::unordered_map<Qnn_GraphHandle_t, uint32_t> in_flight_;
+    uint32_t total_in_flight_{0};
+    uint32_t queued_in_flight_{0}; // in flight without a callback
+    std::deque<Request *> pending_;
+    std::deque<AsyncCompletion> completions_;
+    std::vector<std::thread> workers_;
+    bool stopping_{false};
+    uint64_t next_id_{1};
+    AsyncExecutorStats stats_{};
+};
+
+/**
+ * Run `num_requests` executions of one tensor set through `executor` and
+ * print the throughput. Every request shares the same buffers, so this is
+ * only meaningful when the inputs are not rewritten between requests.
+ */
+bool run_async_throughput(AsyncExecutor &executor, Qnn_GraphHandle_t graph,
+                          const std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                          uint32_t num_requests);
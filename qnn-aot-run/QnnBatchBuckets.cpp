@@ -0,0 +1,104 @@
+#include "QnnBatchBuckets.h"
+#include "QnnIOPlanner.h"
+#include "QnnShard.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+std::vector<uint32_t> default_batch_buckets()
+{
+    return {1, 2, 4, 8, 16, 32, 64};
+}
+
+std::string batch_bucket_graph_name(const std::string &prefix, uint32_t batch)
+{
+    return prefix + "_b" + std::to_string(batch);
+}
+
+bool BatchBuckets::build(QnnGraphTable &graphs, const std::string &prefix)
+{
+    buckets_.clear();
+    for (auto &entry : graphs)
+    {
+        if (entry.first.compare(0, prefix.size(), prefix) != 0)
+            continue;
+
+        // Shards of a split layer are not buckets on their own
+        std::string bucket_name;
+        uint32_t col, tile;
+        if (parse_shard_graph_name(entry.first, bucket_name, col, tile))
+            continue;
+
+        const QnnGraphInfo &info = entry.second.info;
+        if (info.numGraphInputs == 0 || qnn_tensor_rank(info.graphInputs[0]) == 0)
+            continue;
+
+        buckets_.push_back({qnn_tensor_dims(info.graphInputs[0])[0], &entry.second});
+    }
+
+    std::sort(buckets_.begin(), buckets_.end(), [](const BatchBucket &a, const BatchBucket &b)
+              { return a.batch < b.batch; });
+    return !buckets_.empty();
+}
+
+const BatchBucket *BatchBuckets::select(uint32_t rows) const
+{
+    if (buckets_.empty())
+        return nullptr;
+
+    for (const BatchBucket &bucket : buckets_)
+        if (bucket.batch >= rows)
+            return &bucket;
+    return &buckets_.back();
+}
+
+uint32_t BatchBuckets::executions(uint32_t rows) const
+{
+    const BatchBucket *bucket = select(rows);
+    if (bucket == nullptr || rows == 0)
+        return 0;
+    return (rows + bucket->batch - 1) / bucket->batch;
+}
+
+void print_bucket_savings(const BatchBuckets &buckets, const std::vector<double> &latency_ms,
+                          uint32_t fixed_batch, uint32_t num_samples)
+{
+    const std::vector<BatchBucket> &list = buckets.buckets();
+    if (list.empty() || latency_ms.size() != list.size())
+        return;
+
+    size_t fixed = list.size() - 1;
+    for (size_t i = 0; i < list.size(); i++)
+        if (list[i].batch == fixed_batch)
+            fixed = i;
+
+    // Geometric with mean ~6 rows, clipped to the largest bucket
+    std::mt19937 rng(1234);
+    std::geometric_distribution<uint32_t> extra_rows(0.15);
+    uint32_t max_rows = list.back().batch;
+
+    std::vector<uint64_t> hits(list.size(), 0);
+    double bucketed_ms = 0.0;
+    double fixed_ms = 0.0;
+    uint64_t total_rows = 0;
+    for (uint32_t i = 0; i < num_samples; i++)
+    {
+        uint32_t rows = std::min(1 + extra_rows(rng), max_rows);
+        total_rows += rows;
+
+        const BatchBucket *bucket = buckets.select(rows);
+        size_t index = bucket - list.data();
+        hits[index]++;
+        bucketed_ms += buckets.executions(rows) * latency_ms[index];
+        fixed_ms += (rows + list[fixed].batch - 1) / list[fixed].batch * latency_ms[fixed];
+    }
+
+    printf("Batch buckets (%u sampled batches, mean %.1f rows):\n", num_samples, static_cast<double>(total_rows) / num_samples);
+    printf("  %8s %14s %10s\n", "bucket", "latency (ms)", "share");
+    for (size_t i = 0; i < list.size(); i++)
+        printf("  %8u %14.3f %9.1f%%\n", list[i].batch, latency_ms[i], 100.0 * hits[i] / num_samples);
+
+    printf("  always batch %u: %.3f ms/batch, bucketed: %.3f ms/batch, saving %.1f%%\n",
+           list[fixed].batch, fixed_ms / num_samples, bucketed_ms / num_samples,
+           fixed_ms > 0 ? 100.0 * (1.0 - bucketed_ms / fixed_ms) : 0.0);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "QnnSetup.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Batch buckets compiled into one context by the AOT tools, default 1, 2, 4, ..., 64
+std::vector<uint32_t> default_batch_buckets();
+// Graph name of one bucket, e.g. linear_b8
+std::string batch_bucket_graph_name(const std::string &prefix, uint32_t batch);
+
+struct BatchBucket
+{
+    uint32_t batch;
+    QnnGraph *graph;
+};
+
+/**
+ * Graphs of one context that differ only in their batch dimension, sorted
+ * by batch. The batch of each graph is read from the outermost dimension of
+ * its first input, so the table works for any naming scheme. Shard graphs
+ * of a split layer (see ShardedLayer) are left out.
+ */
+class BatchBuckets
+{
+public:
+    // Graphs whose name starts with `prefix`, all graphs when empty
+    bool build(QnnGraphTable &graphs, const std::string &prefix = "");
+
+    // Smallest bucket holding `rows`, the largest one when none does
+    const BatchBucket *select(uint32_t rows) const;
+    // Executions of the selected bucket needed for `rows`
+    uint32_t executions(uint32_t rows) const;
+
+    const std::vector<BatchBucket> &buckets() const { return buckets_; }
+
+private:
+    std::vector<BatchBucket> buckets_;
+};
+
+/**
+ * Expected latency of bucketed execution against always running the
+ * `fixed_batch` bucket, for batch sizes drawn from a skewed distribution
+ * (most batches small, a long tail up to the largest bucket).
+ * `latency_ms[i]` is the measured latency of buckets()[i].
+ */
+void print_bucket_savings(const BatchBuckets &buckets, const std::vector<double> &latency_ms,
+                          uint32_t fixed_batch, uint32_t num_samples = 10000);
@@ -0,0 +1,210 @@
+#include "QnnBatchServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+static uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+BatchServer::BatchServer(const BatchServerConfig &config, ExecuteFn execute)
+    : config_(config), execute_(std::move(execute))
+{
+    if (config_.batch_size == 0)
+        config_.batch_size = 1;
+
+    if (config_.input == nullptr)
+    {
+        input_storage_.resize(config_.input_row_bytes * config_.batch_size);
+        config_.input = input_storage_.data();
+    }
+    if (config_.output == nullptr)
+    {
+        output_storage_.resize(config_.output_row_bytes * config_.batch_size);
+        config_.output = output_storage_.data();
+    }
+
+    thread_ = std::thread(&BatchServer::batcher, this);
+}
+
+BatchServer::~BatchServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::future<BatchReply> BatchServer::submit(const void *row)
+{
+    Request request;
+    const uint8_t *bytes = static_cast<const uint8_t *>(row);
+    request.input.assign(bytes, bytes + config_.input_row_bytes);
+    request.submit_ns = now_ns();
+    std::future<BatchReply> reply = request.reply.get_future();
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(request));
+        stats_.requests++;
+        // The batcher only cares about the first row and a full batch
+        wake = queue_.size() == 1 || queue_.size() >= config_.batch_size;
+    }
+    if (wake)
+        cv_.notify_one();
+
+    return reply;
+}
+
+void BatchServer::batcher()
+{
+    uint8_t *input = static_cast<uint8_t *>(config_.input);
+    uint8_t *output = static_cast<uint8_t *>(config_.output);
+    std::vector<Request> batch;
+    batch.reserve(config_.batch_size);
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]
+                     { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;
+
+            // Deadline runs from the oldest row, not from when the batcher woke up
+            auto deadline = std::chrono::steady_clock::time_point(
+                std::chrono::nanoseconds(queue_.front().submit_ns + config_.max_wait_us * 1000ull));
+            cv_.wait_until(lock, deadline, [this]
+                           { return stopping_ || queue_.size() >= config_.batch_size; });
+
+            uint32_t rows = static_cast<uint32_t>(std::min<size_t>(queue_.size(), config_.batch_size));
+            for (uint32_t i = 0; i < rows; i++)
+            {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        uint32_t rows = static_cast<uint32_t>(batch.size());
+        for (uint32_t i = 0; i < rows; i++)
+            memcpy(input + i * config_.input_row_bytes, batch[i].input.data(), config_.input_row_bytes);
+        if (rows < config_.batch_size)
+            memset(input + rows * config_.input_row_bytes, 0, (config_.batch_size - rows) * config_.input_row_bytes);
+
+        bool ok = execute_(rows);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.batches++;
+            stats_.padded_rows += config_.batch_size - rows;
+            if (rows == config_.batch_size)
+                stats_.full_batches++;
+            if (!ok)
+                stats_.failed_batches++;
+        }
+
+        uint64_t done = now_ns();
+        for (uint32_t i = 0; i < rows; i++)
+        {
+            BatchReply reply;
+            reply.ok = ok;
+            reply.batch_rows = rows;
+            reply.latency_ns = done - batch[i].submit_ns;
+            if (ok)
+            {
+                const uint8_t *row = output + i * config_.output_row_bytes;
+                reply.output.assign(row, row + config_.output_row_bytes);
+            }
+            batch[i].reply.set_value(std::move(reply));
+        }
+        batch.clear();
+    }
+}
+
+BatchServerStats BatchServer::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void BatchServer::print_stats()
+{
+    BatchServerStats stats = get_stats();
+    printf("BatchServer: %lu requests in %lu batches (%lu full, %.1f rows/batch), %lu padded rows, %lu failed batches\n",
+           stats.requests, stats.batches, stats.full_batches,
+           stats.batches ? static_cast<double>(stats.requests) / stats.batches : 0.0,
+           stats.padded_rows, stats.failed_batches);
+}
+
+BatchLoadResult run_batch_load(BatchServer &server, const BatchServerConfig &config,
+                               double rate, uint32_t num_requests,
+                               const std::function<void(uint32_t index, void *row)> &make_row)
+{
+    std::mt19937 rng(1234);
+    std::exponential_distribution<double> gap_s(rate);
+    std::vector<uint8_t> row(config.input_row_bytes);
+    std::vector<std::future<BatchReply>> replies;
+    replies.reserve(num_requests);
+
+    BatchServerStats before = server.get_stats();
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    for (uint32_t i = 0; i < num_requests; i++)
+    {
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(gap_s(rng)));
+        std::this_thread::sleep_until(next);
+
+        make_row(i, row.data());
+        replies.push_back(server.submit(row.data()));
+    }
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(num_requests);
+    BatchLoadResult result{};
+    for (auto &future : replies)
+    {
+        BatchReply reply = future.get();
+        if (!reply.ok)
+            result.failures++;
+        latencies.push_back(reply.latency_ns);
+    }
+    auto end = std::chrono::steady_clock::now();
+    BatchServerStats after = server.get_stats();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p)
+    {
+        size_t index = static_cast<size_t>(p * (latencies.size() - 1) + 0.5);
+        return latencies.empty() ? 0.0 : latencies[index] / 1e6;
+    };
+
+    uint64_t batches = after.batches - before.batches;
+    result.max_wait_us = config.max_wait_us;
+    result.offered_rate = rate;
+    result.throughput = num_requests / std::chrono::duration<double>(end - start).count();
+    result.p50_ms = percentile(0.50);
+    result.p99_ms = percentile(0.99);
+    result.avg_batch_rows = batches ? static_cast<double>(num_requests) / batches : 0.0;
+    return result;
+}
+
+void print_batch_load_header()
+{
+    printf("%10s %12s %12s %10s %10s %12s\n", "wait (us)", "offered/s", "rows/s", "p50 (ms)", "p99 (ms)", "rows/batch");
+}
+
+void print_batch_load_result(const BatchLoadResult &result)
+{
+    printf("%10u %12.1f %12.1f %10.3f %10.3f %12.1f%s\n",
+           result.max_wait_us, result.offered_rate, result.throughput,
+           result.p50_ms, result.p99_ms, result.avg_batch_rows,
+           result.failures ? " (failures)" : "");
+}
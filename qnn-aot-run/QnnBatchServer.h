@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct BatchServerConfig
+{
+    uint32_t batch_size{32};     // rows compiled into the graph
+    uint64_t input_row_bytes{0};
+    uint64_t output_row_bytes{0};
+    uint32_t max_wait_us{1000};  // oldest queued row waits at most this long for company
+    // Batch buffers, e.g. the registered graph I/O. Allocated by the server when null.
+    void *input{nullptr};
+    void *output{nullptr};
+};
+
+struct BatchReply
+{
+    bool ok;
+    std::vector<uint8_t> output; // output_row_bytes
+    uint64_t latency_ns;         // submit to scatter
+    uint32_t batch_rows;         // live rows in the batch that carried this request
+};
+
+struct BatchServerStats
+{
+    uint64_t requests;
+    uint64_t batches;
+    uint64_t padded_rows;
+    uint64_t full_batches;
+    uint64_t failed_batches;
+};
+
+/**
+ * Coalesces single-row requests into the fixed batch a graph was compiled
+ * for. A batch executes once it is full or once its oldest row has waited
+ * max_wait_us; missing rows are zero padded and each caller gets its own
+ * output row back through the future returned by submit().
+ */
+class BatchServer
+{
+public:
+    // Runs one batch already staged in config.input; `rows` of batch_size are live
+    using ExecuteFn = std::function<bool(uint32_t rows)>;
+
+    BatchServer(const BatchServerConfig &config, ExecuteFn execute);
+    BatchServer(const BatchServer &) = delete;
+    BatchServer &operator=(const BatchServer &) = delete;
+    // Flushes queued rows before returning
+    ~BatchServer();
+
+    // Copies `row` (input_row_bytes) into the queue
+    std::future<BatchReply> submit(const void *row);
+
+    BatchServerStats get_stats();
+    void print_stats();
+
+private:
+    struct Request
+    {
+        std::vector<uint8_t> input;
+        std::promise<BatchReply> reply;
+        uint64_t submit_ns;
+    };
+
+    void batcher();
+
+    BatchServerConfig config_;
+    ExecuteFn execute_;
+    std::vector<uint8_t> input_storage_;
+    std::vector<uint8_t> output_storage_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Request> queue_;
+    bool stopping_{false};
+    BatchServerStats stats_{};
+    std::thread thread_;
+};
+
+struct BatchLoadResult
+{
+    uint32_t max_wait_us;
+    double offered_rate;
+    double throughput; // completed rows per second
+    double p50_ms;
+    double p99_ms;
+    double avg_batch_rows;
+    uint64_t failures;
+};
+
+/**
+ * Open-loop load generator: `num_requests` rows with exponential
+ * inter-arrival times at `rate` rows/s. `make_row` fills each request's input.
+ */
+BatchLoadResult run_batch_load(BatchServer &server, const BatchServerConfig &config,
+                               double rate, uint32_t num_requests,
+                               const std::function<void(uint32_t index, void *row)> &make_row);
+
+void print_batch_load_header();
+void print_batch_load_result(const BatchLoadResult &result);
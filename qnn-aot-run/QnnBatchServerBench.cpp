@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "QnnBatchServer.h"
+
+// Throughput against p50/p99 latency of the BatchServer for a range of
+// max-wait deadlines. The stub graph takes --exec-us per batch no matter how
+// many rows are live, like a graph compiled for a fixed batch.
+
+static uint32_t batch_size = 32;
+static uint32_t row_elems = 4096;
+static uint32_t exec_us = 4000;
+static uint32_t num_requests = 2000;
+static double rate = 4000.0;
+static std::vector<uint32_t> waits = {0, 250, 1000, 2000, 4000, 8000};
+
+static void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+            batch_size = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--exec-us") && i + 1 < argc)
+            exec_us = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--requests") && i + 1 < argc)
+            num_requests = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+            rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--wait") && i + 1 < argc)
+            waits.assign(1, static_cast<uint32_t>(atoi(argv[++i])));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    parse_bench_arg(argc, argv);
+
+    printf("=======================================================\n");
+    printf("BatchServer: batch %u, %u us per batch (capacity %.1f rows/s), %u requests at %.1f rows/s\n",
+           batch_size, exec_us, batch_size * 1e6 / exec_us, num_requests, rate);
+    printf("=======================================================\n");
+
+    std::vector<uint16_t> input(batch_size * row_elems);
+    std::vector<uint16_t> output(batch_size * row_elems);
+
+    BatchServerConfig config;
+    config.batch_size = batch_size;
+    config.input_row_bytes = row_elems * sizeof(uint16_t);
+    config.output_row_bytes = row_elems * sizeof(uint16_t);
+    config.input = input.data();
+    config.output = output.data();
+
+    // Echo the input rows so every caller can check it got its own row back
+    auto execute = [&](uint32_t)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(exec_us));
+        output = input;
+        return true;
+    };
+
+    {
+        BatchServer server(config, execute);
+        std::vector<std::future<BatchReply>> replies;
+        std::vector<uint16_t> row(row_elems);
+        for (uint32_t i = 0; i < batch_size + batch_size / 2; i++)
+        {
+            std::fill(row.begin(), row.end(), static_cast<uint16_t>(i));
+            replies.push_back(server.submit(row.data()));
+        }
+
+        for (uint32_t i = 0; i < replies.size(); i++)
+        {
+            BatchReply reply = replies[i].get();
+            const uint16_t *data = reinterpret_cast<const uint16_t *>(reply.output.data());
+            if (!reply.ok || data[0] != i || data[row_elems - 1] != i)
+            {
+                printf("Scatter check failed for request %u\n", i);
+                return -1;
+            }
+        }
+        server.print_stats();
+    }
+
+    print_batch_load_header();
+    for (uint32_t wait : waits)
+    {
+        config.max_wait_us = wait;
+        BatchServer server(config, execute);
+
+        BatchLoadResult result = run_batch_load(server, config, rate, num_requests,
+                                                [](uint32_t index, void *row)
+                                                {
+                                                    uint16_t *data = static_cast<uint16_t *>(row);
+                                                    for (uint32_t i = 0; i < row_elems; i++)
+                                                        data[i] = static_cast<uint16_t>(index);
+                                                });
+        print_batch_load_result(result);
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "QnnBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+bool BenchHarness::run(const IterationFn &timed, const IterationFn &untimed)
+{
+    samples_.clear();
+    samples_.reserve(config_.iterations);
+
+    uint32_t total = config_.warmup + config_.iterations;
+    for (uint32_t i = 0; i < total; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = timed(i);
+        auto end = std::chrono::steady_clock::now();
+        if (!ok)
+            return false;
+
+        if (i >= config_.warmup)
+            samples_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+        if (untimed && !untimed(i))
+            return false;
+    }
+
+    return true;
+}
+
+// Linear interpolation between the closest ranks
+static double percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    double rank = p * (sorted.size() - 1);
+    size_t lower = static_cast<size_t>(rank);
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    double frac = rank - lower;
+    return sorted[lower] + (static_cast<double>(sorted[upper]) - sorted[lower]) * frac;
+}
+
+BenchStats BenchHarness::compute() const
+{
+    BenchStats stats{};
+    stats.iterations = samples_.size();
+    if (samples_.empty())
+        return stats;
+
+    std::vector<uint64_t> sorted(samples_);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (uint64_t sample : sorted)
+        sum += sample;
+    stats.mean_ns = sum / sorted.size();
+
+    double var = 0.0;
+    for (uint64_t sample : sorted)
+        var += (sample - stats.mean_ns) * (sample - stats.mean_ns);
+    stats.stddev_ns = sorted.size() > 1 ? std::sqrt(var / (sorted.size() - 1)) : 0.0;
+
+    stats.min_ns = sorted.front();
+    stats.max_ns = sorted.back();
+    stats.p50_ns = percentile(sorted, 0.50);
+    stats.p90_ns = percentile(sorted, 0.90);
+    stats.p99_ns = percentile(sorted, 0.99);
+
+    // flops / ns == GFLOP/s, bytes / ns == GB/s
+    stats.gflops = config_.flops / stats.mean_ns;
+    stats.weight_gbps = config_.weight_bytes / stats.mean_ns;
+    return stats;
+}
+
+void BenchHarness::print() const
+{
+    BenchStats stats = compute();
+    printf("Benchmark %s: %u warmup, %lu iterations\n", config_.label.c_str(), config_.warmup, stats.iterations);
+    printf("  latency (us): min %.3f  mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f  stddev %.3f\n",
+           stats.min_ns / 1e3, stats.mean_ns / 1e3, stats.p50_ns / 1e3, stats.p90_ns / 1e3,
+           stats.p99_ns / 1e3, stats.max_ns / 1e3, stats.stddev_ns / 1e3);
+    if (config_.flops > 0 || config_.weight_bytes > 0)
+        printf("  throughput: %.2f GFLOP/s, weights %.2f GB/s\n", stats.gflops, stats.weight_gbps);
+}
+
+bool BenchHarness::write_json(const std::string &path) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    BenchStats stats = compute();
+    fprintf(file, "{\n");
+    fprintf(file, "  \"label\": \"%s\",\n", config_.label.c_str());
+    fprintf(file, "  \"warmup\": %u,\n", config_.warmup);
+    fprintf(file, "  \"iterations\": %lu,\n", stats.iterations);
+    fprintf(file, "  \"latency_ns\": {\"min\": %.0f, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.0f, \"stddev\": %.1f},\n",
+            stats.min_ns, stats.mean_ns, stats.p50_ns, stats.p90_ns, stats.p99_ns, stats.max_ns, stats.stddev_ns);
+    fprintf(file, "  \"flops\": %.0f,\n", config_.flops);
+    fprintf(file, "  \"weight_bytes\": %.0f,\n", config_.weight_bytes);
+    fprintf(file, "  \"gflops\": %.3f,\n", stats.gflops);
+    fprintf(file, "  \"weight_gbps\": %.3f,\n", stats.weight_gbps);
+    fprintf(file, "  \"samples_ns\": [");
+    for (size_t i = 0; i < samples_.size(); i++)
+        fprintf(file, "%s%lu", i ? ", " : "", samples_[i]);
+    fprintf(file, "]\n}\n");
+    fclose(file);
+    return true;
+}
+
+bool BenchHarness::write_csv(const std::string &path) const
+{
+    FILE *file = fopen(path.c_str(), "a");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    // Header only for a new file so runs accumulate release over release
+    if (ftell(file) == 0)
+        fprintf(file, "label,warmup,iterations,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,max_ns,stddev_ns,gflops,weight_gbps\n");
+
+    BenchStats stats = compute();
+    fprintf(file, "%s,%u,%lu,%.0f,%.1f,%.1f,%.1f,%.1f,%.0f,%.1f,%.3f,%.3f\n",
+            config_.label.c_str(), config_.warmup, stats.iterations,
+            stats.min_ns, stats.mean_ns, stats.p50_ns, stats.p90_ns, stats.p99_ns, stats.max_ns, stats.stddev_ns,
+            stats.gflops, stats.weight_gbps);
+    fclose(file);
+    return true;
+}
+
+bool BenchHarness::report() const
+{
+    print();
+
+    bool ok = true;
+    if (!config_.json_path.empty())
+        ok &= write_json(config_.json_path);
+    if (!config_.csv_path.empty())
+        ok &= write_csv(config_.csv_path);
+    return ok;
+}
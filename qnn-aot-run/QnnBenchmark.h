@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchConfig
+{
+    std::string label;
+    uint32_t warmup{3};
+    uint32_t iterations{50};
+    // Work per iteration, 0 leaves the derived rate out
+    double flops{0.0};
+    double weight_bytes{0.0};
+    // Machine readable results; CSV appends one row per run
+    std::string json_path;
+    std::string csv_path;
+};
+
+struct BenchStats
+{
+    uint64_t iterations;
+    double min_ns;
+    double mean_ns;
+    double p50_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+    double stddev_ns;
+    double gflops;      // at the mean latency
+    double weight_gbps; // weight stream at the mean latency
+};
+
+/**
+ * Warmup + timed iterations with per-iteration nanosecond samples.
+ *
+ * `timed` is the measured region (the execute call); `untimed` runs after
+ * it on every iteration for readback or profile collection that must not
+ * count against the latency. Both get the iteration index, warmup included,
+ * and return false to stop the run.
+ */
+class BenchHarness
+{
+public:
+    using IterationFn = std::function<bool(uint32_t iter)>;
+
+    explicit BenchHarness(const BenchConfig &config) : config_(config) {}
+
+    bool run(const IterationFn &timed, const IterationFn &untimed = nullptr);
+
+    const std::vector<uint64_t> &samples() const { return samples_; }
+    BenchStats compute() const;
+
+    void print() const;
+    bool write_json(const std::string &path) const;
+    bool write_csv(const std::string &path) const;
+    // print() plus whichever outputs the config asks for
+    bool report() const;
+
+private:
+    BenchConfig config_;
+    std::vector<uint64_t> samples_;
+};
@@ -0,0 +1,85 @@
+/**
+ * Host-side stand-in for libcdsprpc.so.
+ * rpcmem_* is backed by malloc so SharedBuffer can be exercised on Linux:
+ *   LD_LIBRARY_PATH=<build dir> ./<app>
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+namespace
+{
+    struct RpcMemBlock
+    {
+        size_t size;
+        int fd;
+    };
+
+    std::mutex g_rpcmem_mutex;
+    int g_next_fd = 1000;
+
+    // Never destroyed: callers may still free blocks from their own static destructors
+    std::map<uintptr_t, RpcMemBlock> &rpcmem_blocks()
+    {
+        static auto *blocks = new std::map<uintptr_t, RpcMemBlock>();
+        return *blocks;
+    }
+}
+
+extern "C"
+{
+    void *rpcmem_alloc(int heapid, uint32_t flags, int size)
+    {
+        (void)heapid;
+        (void)flags;
+        if (size <= 0)
+            return nullptr;
+
+        void *buf = nullptr;
+        if (posix_memalign(&buf, 4096, static_cast<size_t>(size)) != 0)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(g_rpcmem_mutex);
+        rpcmem_blocks()[reinterpret_cast<uintptr_t>(buf)] = {static_cast<size_t>(size), g_next_fd++};
+        return buf;
+    }
+
+    void rpcmem_free(void *po)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_rpcmem_mutex);
+            if (rpcmem_blocks().erase(reinterpret_cast<uintptr_t>(po)) == 0)
+                return;
+        }
+        free(po);
+    }
+
+    int rpcmem_to_fd(void *po)
+    {
+        // Like the real library, any address inside a block resolves to its fd
+        uintptr_t addr = reinterpret_cast<uintptr_t>(po);
+
+        std::lock_guard<std::mutex> lock(g_rpcmem_mutex);
+        auto &blocks = rpcmem_blocks();
+        auto iter = blocks.upper_bound(addr);
+        if (iter == blocks.begin())
+            return -1;
+
+        --iter;
+        if (addr >= iter->first + iter->second.size)
+            return -1;
+
+        return iter->second.fd;
+    }
+
+    // Not part of libcdsprpc: lets the stub QNN backend map a registered fd back to its block
+    void *rpcmem_stub_fd_to_addr(int fd)
+    {
+        std::lock_guard<std::mutex> lock(g_rpcmem_mutex);
+        for (const auto &block : rpcmem_blocks())
+            if (block.second.fd == fd)
+                return reinterpret_cast<void *>(block.first);
+        return nullptr;
+    }
+}
@@ -0,0 +1,157 @@
+#include "QnnContextBinary.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ContextBinary::load(const std::string &path, bool use_mmap)
+{
+    release();
+
+    if (!use_mmap)
+    {
+        std::ifstream bin(path, std::ios::binary | std::ios::ate);
+        if (!bin.is_open())
+        {
+            printf("Failed to open context binary %s\n", path.c_str());
+            return false;
+        }
+
+        size_t binSize = bin.tellg();
+        bin.seekg(0);
+
+        buffer_.resize(binSize);
+        bin.read(reinterpret_cast<char *>(buffer_.data()), binSize);
+        bin.close();
+
+        data_ = buffer_.data();
+        size_ = binSize;
+
+        printf("Loaded context binary: %lu bytes\n", size_);
+        return true;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        printf("Failed to open context binary %s\n", path.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        printf("Failed to stat context binary %s\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    // Private + writable: QNN takes a non-const pointer, any write stays copy-on-write
+    void *addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        printf("Failed to mmap context binary %s\n", path.c_str());
+        return false;
+    }
+
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    madvise(addr, st.st_size, MADV_WILLNEED);
+
+    data_ = addr;
+    size_ = st.st_size;
+    mapped_ = true;
+
+    printf("Mapped context binary: %lu bytes\n", size_);
+    return true;
+}
+
+void ContextBinary::release()
+{
+    if (mapped_ && data_)
+        munmap(data_, size_);
+
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+bool ContextBinaryWriter::create(const std::string &path, uint64_t size)
+{
+    abort();
+
+    path_ = path;
+    tmp_path_ = path + ".tmp." + std::to_string(getpid());
+    fd_ = open(tmp_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+        printf("Failed to create %s: %s\n", tmp_path_.c_str(), strerror(errno));
+        return false;
+    }
+
+    // Reserve the blocks up front so a full disk fails here, not as SIGBUS inside contextGetBinary
+    int err = posix_fallocate(fd_, 0, size);
+    if (err == EOPNOTSUPP || err == EINVAL)
+        err = ftruncate(fd_, size) == 0 ? 0 : errno;
+    if (err != 0)
+    {
+        printf("Failed to size %s to %lu bytes: %s\n", tmp_path_.c_str(), size, strerror(err));
+        abort();
+        return false;
+    }
+
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED)
+    {
+        printf("Failed to mmap %s: %s\n", tmp_path_.c_str(), strerror(errno));
+        abort();
+        return false;
+    }
+
+    data_ = addr;
+    size_ = size;
+    return true;
+}
+
+bool ContextBinaryWriter::commit(uint64_t written)
+{
+    if (data_ == nullptr || written > size_)
+        return false;
+
+    munmap(data_, size_);
+    data_ = nullptr;
+
+    bool ok = (written == size_ || ftruncate(fd_, written) == 0) && fdatasync(fd_) == 0;
+    close(fd_);
+    fd_ = -1;
+    if (!ok || rename(tmp_path_.c_str(), path_.c_str()) != 0)
+    {
+        printf("Failed to publish %s: %s\n", path_.c_str(), strerror(errno));
+        unlink(tmp_path_.c_str());
+        return false;
+    }
+
+    tmp_path_.clear();
+    return true;
+}
+
+void ContextBinaryWriter::abort()
+{
+    if (data_)
+        munmap(data_, size_);
+    if (fd_ >= 0)
+        close(fd_);
+    if (!tmp_path_.empty())
+        unlink(tmp_path_.c_str());
+
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+    tmp_path_.clear();
+}
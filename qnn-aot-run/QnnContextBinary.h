@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Context binary image used by QnnGetGraphInfosFromBinary and
+ * contextCreateFromBinary.
+ *
+ * The mmap path maps the file copy-on-write and hints the kernel to read
+ * ahead, so the model is never duplicated into a heap buffer. The read path
+ * keeps the old ifstream behaviour for comparison.
+ */
+class ContextBinary
+{
+public:
+    ContextBinary() = default;
+    ContextBinary(const ContextBinary &) = delete;
+    ContextBinary &operator=(const ContextBinary &) = delete;
+    ~ContextBinary() { release(); }
+
+    bool load(const std::string &path, bool use_mmap);
+    // Drop the image once the context has been created from it
+    void release();
+
+    void *data() { return data_; }
+    uint64_t size() const { return size_; }
+    bool is_mapped() const { return mapped_; }
+
+private:
+    void *data_{nullptr};
+    uint64_t size_{0};
+    bool mapped_{false};
+    std::vector<uint8_t> buffer_;
+};
+
+/**
+ * Output side: the context binary is serialized straight into a file mapping.
+ *
+ * create() reserves the full size in a temporary file next to `path` and
+ * maps it shared, so contextGetBinary writes the page cache directly with no
+ * heap copy and no second write pass. commit() trims the file to the bytes
+ * actually written, flushes it and renames it over `path`, so readers never
+ * see a partial binary. Without a commit the temporary file is removed.
+ */
+class ContextBinaryWriter
+{
+public:
+    ContextBinaryWriter() = default;
+    ContextBinaryWriter(const ContextBinaryWriter &) = delete;
+    ContextBinaryWriter &operator=(const ContextBinaryWriter &) = delete;
+    ~ContextBinaryWriter() { abort(); }
+
+    bool create(const std::string &path, uint64_t size);
+    bool commit(uint64_t written);
+    void abort();
+
+    void *data() { return data_; }
+    uint64_t size() const { return size_; }
+
+private:
+    std::string path_;
+    std::string tmp_path_;
+    int fd_{-1};
+    void *data_{nullptr};
+    uint64_t size_{0};
+};
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "QnnSetup.h"
+#include "QnnUtils.h"
+#include "QnnContextBinary.h"
+
+// Context load cost of one binary packing N graphs against N separate binaries.
+// Run once per layout so peak RSS belongs to that layout only:
+//   QnnContextLoadBench --packed Multi.bin
+//   QnnContextLoadBench --split A.bin B.bin ...
+
+struct LoadedContext
+{
+    Qnn_ContextHandle_t context;
+    QnnSystemContext sys_context; // owns what the graphs' infos point to
+    QnnGraphTable graphs;
+};
+
+static bool load_context(const QnnInterface_t *interface,
+                         const QnnSystemInterface_t *sys_interface,
+                         Qnn_BackendHandle_t backend,
+                         Qnn_DeviceHandle_t device,
+                         const std::string &path, bool use_mmap,
+                         LoadedContext &out, uint64_t &out_bytes)
+{
+    ContextBinary bin;
+    if (!bin.load(path, use_mmap))
+        return false;
+
+    std::vector<QnnGraphInfo> graph_infos;
+    if (!QnnGetGraphInfosFromBinary(sys_interface, bin.data(), bin.size(), out.sys_context, graph_infos))
+        return false;
+
+    Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.contextCreateFromBinary(
+        backend,
+        device,
+        nullptr,
+        bin.data(),
+        (Qnn_ContextBinarySize_t)bin.size(),
+        &out.context,
+        nullptr);
+
+    if (err != QNN_SUCCESS)
+    {
+        printf("contextCreateFromBinary(%s) failed: %lu\n", path.c_str(), err);
+        return false;
+    }
+
+    out_bytes += bin.size();
+    return QnnRetrieveGraphs(interface, out.context, graph_infos, out.graphs);
+}
+
+int main(int argc, char **argv)
+{
+    RunOptions options;
+    parse_run_arg(argc, argv, options);
+
+    std::vector<std::string> bins;
+    bool packed = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--packed") && i + 1 < argc)
+        {
+            packed = true;
+            bins.assign(1, argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--split"))
+        {
+            packed = false;
+            bins.clear();
+            while (i + 1 < argc && strncmp(argv[i + 1], "--", 2))
+                bins.push_back(argv[++i]);
+        }
+    }
+
+    if (bins.empty())
+    {
+        printf("usage: %s --packed <bin> | --split <bin> <bin> ... [--load mmap|read]\n", argv[0]);
+        return -1;
+    }
+
+    void *handle;
+    void *sys_handle;
+    const QnnInterface_t *interface;
+    const QnnSystemInterface_t *sys_interface;
+    Qnn_LogHandle_t logger;
+    Qnn_DeviceHandle_t device;
+    Qnn_BackendHandle_t backend;
+    Qnn_ProfileHandle_t profile;
+
+    std::string backend_lib = options.backend_lib.empty() ? backend_library(options.backend) : options.backend_lib;
+    QnnInit(backend_lib.c_str(),
+            system_library(options.backend),
+            &handle,
+            &sys_handle,
+            &interface,
+            &sys_interface,
+            &logger,
+            &device, &backend,
+            nullptr, nullptr,
+            &profile, false, nullptr, ProfileMode::OFF, options.backend, options.htp_arch);
+
+    uint64_t rss_before = get_current_rss_kb();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<LoadedContext> contexts(bins.size());
+    uint64_t binary_bytes = 0;
+    size_t num_graphs = 0;
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        if (!load_context(interface, sys_interface, backend, device, bins[i], options.use_mmap, contexts[i], binary_bytes))
+            return -1;
+        num_graphs += contexts[i].graphs.size();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    uint64_t rss_after = get_current_rss_kb();
+
+    printf("=======================================================\n");
+    printf("Layout: %s (%s load)\n", packed ? "packed" : "split", options.use_mmap ? "mmap" : "read");
+    printf("  contexts        : %zu\n", contexts.size());
+    printf("  graphs          : %zu\n", num_graphs);
+    printf("  binary bytes    : %lu\n", binary_bytes);
+    printf("  load time       : %.3f ms\n", std::chrono::duration<double, std::milli>(end - start).count());
+    printf("  RSS delta       : %ld KiB\n", static_cast<int64_t>(rss_after) - static_cast<int64_t>(rss_before));
+    printf("  peak RSS        : %lu KiB\n", get_peak_rss_kb());
+    printf("=======================================================\n");
+
+    for (LoadedContext &loaded : contexts)
+        interface->QNN_INTERFACE_VER_NAME.contextFree(loaded.context, nullptr);
+    // System contexts go before the system library
+    contexts.clear();
+
+    QnnCleanup(handle, sys_handle);
+
+    return 0;
+}
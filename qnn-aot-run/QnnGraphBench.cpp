@@ -0,0 +1,78 @@
+#include "QnnGraphBench.h"
+#include "QnnProfileCollector.h"
+#include <cstdio>
+#include <string>
+
+bool run_graph_bench(const QnnInterface_t *interface, Qnn_GraphHandle_t graph,
+                     std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                     const BenchConfig &config, Qnn_ProfileHandle_t profile,
+                     PerfController &perf, TraceWriter &trace, const RunOptions &options,
+                     std::chrono::high_resolution_clock::time_point load_start)
+{
+    BenchHarness bench(config);
+    ProfileCollector profiler(interface, profile,
+                              options.profile_mode == ProfileMode::SAMPLED ? options.profile_every : 1);
+    double exec_start = 0.0;
+    double exec_end = 0.0;
+    auto execute = [&](uint32_t i)
+    {
+        if (trace.enabled())
+            exec_start = trace.now();
+
+        Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+            graph,
+            inputs.data(),       // input tensors
+            inputs.size(),       // number of inputs
+            outputs.data(),      // output tensors
+            outputs.size(),      // number of outputs
+            profiler.handle(i),  // profile, nullptr when off or not sampled
+            nullptr              // const QnnExecution_Config_t** executionConfig
+        );
+
+        if (err != QNN_SUCCESS)
+        {
+            printf("graphExecute failed: %lu\n", err);
+            return false;
+        }
+
+        if (trace.enabled())
+            exec_end = trace.now();
+        return true;
+    };
+
+    auto collect = [&](uint32_t i)
+    {
+        if (i == 0)
+        {
+            auto ttfi = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - load_start).count();
+            printf("Load path: %s, time-to-first-inference: %.3f ms, peak RSS: %lu KiB\n",
+                   options.use_mmap ? "mmap" : "read", ttfi, get_peak_rss_kb());
+        }
+
+        if (!profiler.collect(i))
+            return false;
+
+        if (trace.enabled())
+        {
+            // iteration > execute (+ its profile events) and profile collection
+            double end = trace.now();
+            std::string iteration = (i < config.warmup ? "warmup " : "iteration ") + std::to_string(i);
+            trace.add_span(iteration, exec_start, end);
+            trace.add_span("execute", exec_start, exec_end);
+            trace.add_span("profile", exec_end, end);
+            trace.add_profile_events(interface, profiler.last_events(), exec_start, exec_end);
+        }
+        return true;
+    };
+
+    {
+        PerfBurst burst(perf);
+        if (!bench.run(execute, collect) || !bench.report())
+            return false;
+    }
+
+    profiler.print_summary();
+    if (profile)
+        profiler.write_summary("qnn_profile_data.txt");
+    return trace.write(options.trace_path);
+}
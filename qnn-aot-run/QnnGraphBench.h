@@ -0,0 +1,24 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include "QnnBenchmark.h"
+#include "QnnPerfMode.h"
+#include "QnnTraceWriter.h"
+#include "QnnUtils.h"
+#include <chrono>
+#include <vector>
+
+/**
+ * The runners' main measurement of one graph on registered tensors.
+ *
+ * BenchHarness times graphExecute alone; after every execute the profile
+ * events of a sampled iteration are collected and, with --trace, the
+ * iteration/execute/profile spans go on the timeline. Iteration 0 prints the
+ * time to first inference since `load_start`. The run holds a perf burst,
+ * then the profile summary and the trace are written out.
+ */
+bool run_graph_bench(const QnnInterface_t *interface, Qnn_GraphHandle_t graph,
+                     std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                     const BenchConfig &config, Qnn_ProfileHandle_t profile,
+                     PerfController &perf, TraceWriter &trace, const RunOptions &options,
+                     std::chrono::high_resolution_clock::time_point load_start);
@@ -0,0 +1,256 @@
+#include "QnnGraphConfig.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+std::string HtpGraphConfig::tag() const
+{
+    std::string tag;
+    auto add = [&tag](const std::string &part)
+    {
+        tag += (tag.empty() ? "" : "-") + part;
+    };
+
+    if (optimization_level)
+        add("o" + std::to_string(optimization_level));
+    if (vtcm_mb)
+        add("vtcm" + std::to_string(vtcm_mb));
+    if (precision != HtpPrecision::DEFAULT)
+        add(htp_precision_name(precision));
+    if (hvx_threads)
+        add("hvx" + std::to_string(hvx_threads));
+    if (dlbc >= 0)
+        add("dlbc" + std::to_string(dlbc));
+    return tag.empty() ? "default" : tag;
+}
+
+const char *htp_precision_name(HtpPrecision precision)
+{
+    switch (precision)
+    {
+    case HtpPrecision::DEFAULT:
+        return "default";
+    case HtpPrecision::FP16:
+        return "fp16";
+    case HtpPrecision::FP32:
+        return "fp32";
+    }
+    return "";
+}
+
+void parse_graph_config_arg(int argc, char **argv, HtpGraphConfig &config, bool &sweep)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--opt-level") && i + 1 < argc)
+        {
+            config.optimization_level = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--vtcm") && i + 1 < argc)
+        {
+            config.vtcm_mb = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--precision") && i + 1 < argc)
+        {
+            i++;
+            if (!strcmp(argv[i], "fp16"))
+                config.precision = HtpPrecision::FP16;
+            else if (!strcmp(argv[i], "fp32"))
+                config.precision = HtpPrecision::FP32;
+            else
+                printf("Unknown precision: %s\n", argv[i]);
+        }
+        else if (!strcmp(argv[i], "--hvx-threads") && i + 1 < argc)
+        {
+            config.hvx_threads = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--dlbc") && i + 1 < argc)
+        {
+            i++;
+            if (!strcmp(argv[i], "on"))
+                config.dlbc = 1;
+            else if (!strcmp(argv[i], "off"))
+                config.dlbc = 0;
+            else
+                printf("Unknown DLBC setting: %s\n", argv[i]);
+        }
+        else if (!strcmp(argv[i], "--sweep"))
+        {
+            sweep = true;
+        }
+    }
+}
+
+std::vector<HtpGraphConfig> graph_config_sweep(const HtpGraphConfig &base)
+{
+    std::vector<uint32_t> levels = {1, 2, 3};
+    std::vector<uint32_t> vtcm = {0, 2, 4, 8};
+    std::vector<int32_t> dlbc = {0, 1};
+    if (base.optimization_level)
+        levels = {base.optimization_level};
+    if (base.vtcm_mb)
+        vtcm = {base.vtcm_mb};
+    if (base.dlbc >= 0)
+        dlbc = {base.dlbc};
+
+    std::vector<HtpGraphConfig> configs;
+    for (uint32_t level : levels)
+    {
+        for (uint32_t mb : vtcm)
+        {
+            for (int32_t enable : dlbc)
+            {
+                HtpGraphConfig config = base;
+                config.optimization_level = level;
+                config.vtcm_mb = mb;
+                config.dlbc = enable;
+                configs.push_back(config);
+            }
+        }
+    }
+    return configs;
+}
+
+HtpGraphConfigList::HtpGraphConfigList(const HtpGraphConfig &config)
+{
+    QnnHtpGraph_CustomConfig_t custom = QNN_HTP_GRAPH_CUSTOM_CONFIG_INIT;
+    if (config.optimization_level)
+    {
+        custom.option = QNN_HTP_GRAPH_CONFIG_OPTION_OPTIMIZATION;
+        custom.optimizationOption.type = QNN_HTP_GRAPH_OPTIMIZATION_TYPE_FINALIZE_OPTIMIZATION_FLAG;
+        custom.optimizationOption.floatValue = static_cast<float>(config.optimization_level);
+        custom_.push_back(custom);
+    }
+    if (config.dlbc >= 0)
+    {
+        custom.option = QNN_HTP_GRAPH_CONFIG_OPTION_OPTIMIZATION;
+        custom.optimizationOption.type = QNN_HTP_GRAPH_OPTIMIZATION_TYPE_ENABLE_DLBC;
+        custom.optimizationOption.floatValue = static_cast<float>(config.dlbc);
+        custom_.push_back(custom);
+    }
+    if (config.vtcm_mb)
+    {
+        custom.option = QNN_HTP_GRAPH_CONFIG_OPTION_VTCM_SIZE;
+        custom.vtcmSizeInMB = config.vtcm_mb;
+        custom_.push_back(custom);
+    }
+    if (config.precision != HtpPrecision::DEFAULT)
+    {
+        custom.option = QNN_HTP_GRAPH_CONFIG_OPTION_PRECISION;
+        custom.precision = config.precision == HtpPrecision::FP16 ? QNN_PRECISION_FLOAT16 : QNN_PRECISION_FLOAT32;
+        custom_.push_back(custom);
+    }
+    if (config.hvx_threads)
+    {
+        custom.option = QNN_HTP_GRAPH_CONFIG_OPTION_NUM_HVX_THREADS;
+        custom.numHvxThreads = config.hvx_threads;
+        custom_.push_back(custom);
+    }
+
+    // Sized up front, the pointers below must not move
+    configs_.resize(custom_.size());
+    for (size_t i = 0; i < custom_.size(); i++)
+    {
+        configs_[i].option = QNN_GRAPH_CONFIG_OPTION_CUSTOM;
+        configs_[i].customConfig = &custom_[i];
+        pointers_.push_back(&configs_[i]);
+    }
+    pointers_.push_back(nullptr);
+}
+
+std::string context_metadata_path(const std::string &bin_path)
+{
+    return bin_path + ".json";
+}
+
+bool write_context_metadata(const std::string &bin_path, const ContextMetadata &metadata)
+{
+    std::string path = context_metadata_path(bin_path);
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == nullptr)
+    {
+        printf("Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    std::string buckets;
+    for (uint32_t batch : metadata.buckets)
+        buckets += (buckets.empty() ? "" : ", ") + std::to_string(batch);
+
+    const HtpGraphConfig &config = metadata.graph_config;
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"layer\": \"%s\",\n", metadata.layer.c_str());
+    fprintf(fp, "  \"in_features\": %u,\n", metadata.in_features);
+    fprintf(fp, "  \"out_features\": %u,\n", metadata.out_features);
+    fprintf(fp, "  \"buckets\": [%s],\n", buckets.c_str());
+    fprintf(fp, "  \"weights\": \"%s\",\n", metadata.weights.c_str());
+    fprintf(fp, "  \"col_shards\": %u,\n", metadata.col_shards);
+    fprintf(fp, "  \"k_tiles\": %u,\n", metadata.k_tiles);
+    fprintf(fp, "  \"graph_config\": {\n");
+    fprintf(fp, "    \"tag\": \"%s\",\n", config.tag().c_str());
+    fprintf(fp, "    \"optimization_level\": %u,\n", config.optimization_level);
+    fprintf(fp, "    \"vtcm_mb\": %u,\n", config.vtcm_mb);
+    fprintf(fp, "    \"precision\": \"%s\",\n", htp_precision_name(config.precision));
+    fprintf(fp, "    \"hvx_threads\": %u,\n", config.hvx_threads);
+    fprintf(fp, "    \"dlbc\": %d\n", config.dlbc);
+    fprintf(fp, "  }\n");
+    fprintf(fp, "}\n");
+    fclose(fp);
+    return true;
+}
+
+// Value text after "key": in our own flat output, empty when missing
+static std::string metadata_value(const std::string &text, const std::string &key)
+{
+    size_t pos = text.find("\"" + key + "\":");
+    if (pos == std::string::npos)
+        return "";
+
+    pos = text.find_first_not_of(" ", pos + key.size() + 3);
+    size_t end = text.find_first_of(",\n}", pos);
+    std::string value = text.substr(pos, end - pos);
+    if (value.size() >= 2 && value.front() == '"')
+        value = value.substr(1, value.size() - 2);
+    return value;
+}
+
+bool read_context_metadata(const std::string &bin_path, ContextMetadata &metadata)
+{
+    std::ifstream file(context_metadata_path(bin_path));
+    if (!file.is_open())
+        return false;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    metadata.layer = metadata_value(text, "layer");
+    metadata.in_features = static_cast<uint32_t>(atoi(metadata_value(text, "in_features").c_str()));
+    metadata.out_features = static_cast<uint32_t>(atoi(metadata_value(text, "out_features").c_str()));
+    metadata.weights = metadata_value(text, "weights");
+    metadata.col_shards = static_cast<uint32_t>(atoi(metadata_value(text, "col_shards").c_str()));
+    metadata.k_tiles = static_cast<uint32_t>(atoi(metadata_value(text, "k_tiles").c_str()));
+
+    metadata.buckets.clear();
+    size_t list = text.find("\"buckets\": [");
+    if (list != std::string::npos)
+    {
+        std::stringstream items(text.substr(list + 12, text.find(']', list) - list - 12));
+        std::string item;
+        while (std::getline(items, item, ','))
+            metadata.buckets.push_back(static_cast<uint32_t>(atoi(item.c_str())));
+    }
+
+    HtpGraphConfig &config = metadata.graph_config;
+    config.optimization_level = static_cast<uint32_t>(atoi(metadata_value(text, "optimization_level").c_str()));
+    config.vtcm_mb = static_cast<uint32_t>(atoi(metadata_value(text, "vtcm_mb").c_str()));
+    std::string precision = metadata_value(text, "precision");
+    config.precision = precision == "fp16"   ? HtpPrecision::FP16
+                       : precision == "fp32" ? HtpPrecision::FP32
+                                             : HtpPrecision::DEFAULT;
+    config.hvx_threads = static_cast<uint32_t>(atoi(metadata_value(text, "hvx_threads").c_str()));
+    config.dlbc = atoi(metadata_value(text, "dlbc").c_str());
+    return true;
+}
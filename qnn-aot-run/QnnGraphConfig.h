@@ -0,0 +1,83 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include "HTP/QnnHtpGraph.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class HtpPrecision
+{
+    DEFAULT,
+    FP16, // FP32 ops may run in FP16 (relaxed precision)
+    FP32,
+};
+
+/**
+ * HTP graph options of the AOT tools. Zero (or -1, DEFAULT) leaves an
+ * option to the backend, which is also what a sweep varies.
+ */
+struct HtpGraphConfig
+{
+    uint32_t optimization_level{0};                // --opt-level 1..3
+    uint32_t vtcm_mb{0};                           // --vtcm <MB>
+    HtpPrecision precision{HtpPrecision::DEFAULT}; // --precision fp16|fp32
+    uint32_t hvx_threads{0};                       // --hvx-threads N
+    int32_t dlbc{-1};                              // --dlbc on|off
+
+    // Short name for file names and bench labels, e.g. o3-vtcm8-dlbc1, "default" when nothing is set
+    std::string tag() const;
+};
+
+const char *htp_precision_name(HtpPrecision precision);
+
+// --opt-level, --vtcm, --precision, --hvx-threads, --dlbc and --sweep; leaves the outputs untouched when absent
+void parse_graph_config_arg(int argc, char **argv, HtpGraphConfig &config, bool &sweep);
+
+/**
+ * Every combination of the sweep values for the options `base` leaves at
+ * the default: optimization level 1..3, VTCM 2/4/8 MB or the default, DLBC
+ * off/on. Options set in `base` stay fixed.
+ */
+std::vector<HtpGraphConfig> graph_config_sweep(const HtpGraphConfig &base);
+
+/**
+ * Null terminated QnnGraph_Config_t list for graphCreate. The list points
+ * into this object, which must outlive graphCreate.
+ */
+class HtpGraphConfigList
+{
+public:
+    explicit HtpGraphConfigList(const HtpGraphConfig &config);
+    HtpGraphConfigList(const HtpGraphConfigList &) = delete;
+    HtpGraphConfigList &operator=(const HtpGraphConfigList &) = delete;
+
+    const QnnGraph_Config_t **get() { return pointers_.data(); }
+
+private:
+    std::vector<QnnHtpGraph_CustomConfig_t> custom_;
+    std::vector<QnnGraph_Config_t> configs_;
+    std::vector<const QnnGraph_Config_t *> pointers_;
+};
+
+/**
+ * What a context binary was built from, kept next to it as <binary>.json.
+ * The binary format has no room for it, and the runner needs the graph
+ * options to label sweep results.
+ */
+struct ContextMetadata
+{
+    std::string layer; // linear or matmul
+    uint32_t in_features{0};
+    uint32_t out_features{0};
+    std::vector<uint32_t> buckets;
+    std::string weights;
+    uint32_t col_shards{1};
+    uint32_t k_tiles{1};
+    HtpGraphConfig graph_config;
+};
+
+std::string context_metadata_path(const std::string &bin_path);
+bool write_context_metadata(const std::string &bin_path, const ContextMetadata &metadata);
+// Reads back what write_context_metadata wrote; false when there is no sidecar
+bool read_context_metadata(const std::string &bin_path, ContextMetadata &metadata);
@@ -0,0 +1,164 @@
+#include "QnnHalf.h"
+#include "QnnUtils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QNN_HALF_F16C 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define QNN_HALF_NEON 1
+#endif
+
+void fp32_to_fp16_array_scalar(const float *src, uint16_t *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = fp32_to_fp16(src[i]);
+}
+
+void fp16_to_fp32_array_scalar(const uint16_t *src, float *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = fp16_to_fp32(src[i]);
+}
+
+void accumulate_fp16_to_fp32_scalar(const uint16_t *src, float *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] += fp16_to_fp32(src[i]);
+}
+
+#if QNN_HALF_F16C
+// Built for F16C only here, the rest of the binary stays baseline x86-64
+__attribute__((target("avx,f16c"))) static void fp32_to_fp16_f16c(const float *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i lo = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m128i hi = _mm256_cvtps_ph(_mm256_loadu_ps(src + i + 8), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), hi);
+    }
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    fp32_to_fp16_array_scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx,f16c"))) static void fp16_to_fp32_f16c(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 lo = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        __m256 hi = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)));
+        _mm256_storeu_ps(dst + i, lo);
+        _mm256_storeu_ps(dst + i + 8, hi);
+    }
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+    fp16_to_fp32_array_scalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx,f16c"))) static void accumulate_f16c(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 lo = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        __m256 hi = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), lo));
+        _mm256_storeu_ps(dst + i + 8, _mm256_add_ps(_mm256_loadu_ps(dst + i + 8), hi));
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 v = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), v));
+    }
+    accumulate_fp16_to_fp32_scalar(src + i, dst + i, n - i);
+}
+#endif
+
+#if QNN_HALF_NEON
+// FCVTN/FCVTL are part of base ARMv8, round to nearest even with the default FPCR
+static void fp32_to_fp16_neon(const float *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        float16x8_t h = vcombine_f16(vcvt_f16_f32(vld1q_f32(src + i)), vcvt_f16_f32(vld1q_f32(src + i + 4)));
+        vst1q_u16(dst + i, vreinterpretq_u16_f16(h));
+    }
+    fp32_to_fp16_array_scalar(src + i, dst + i, n - i);
+}
+
+static void fp16_to_fp32_neon(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+        vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+    }
+    fp16_to_fp32_array_scalar(src + i, dst + i, n - i);
+}
+
+static void accumulate_neon(const uint16_t *src, float *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vcvt_f32_f16(vget_low_f16(h))));
+        vst1q_f32(dst + i + 4, vaddq_f32(vld1q_f32(dst + i + 4), vcvt_high_f32_f16(h)));
+    }
+    accumulate_fp16_to_fp32_scalar(src + i, dst + i, n - i);
+}
+#endif
+
+struct HalfConverter
+{
+    const char *path;
+    void (*to_fp16)(const float *, uint16_t *, size_t);
+    void (*to_fp32)(const uint16_t *, float *, size_t);
+    void (*accumulate)(const uint16_t *, float *, size_t);
+};
+
+static HalfConverter select_converter()
+{
+#if QNN_HALF_F16C
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c"))
+        return {"f16c", fp32_to_fp16_f16c, fp16_to_fp32_f16c, accumulate_f16c};
+#elif QNN_HALF_NEON
+    return {"neon", fp32_to_fp16_neon, fp16_to_fp32_neon, accumulate_neon};
+#endif
+    return {"scalar", fp32_to_fp16_array_scalar, fp16_to_fp32_array_scalar, accumulate_fp16_to_fp32_scalar};
+}
+
+static const HalfConverter &converter()
+{
+    static const HalfConverter selected = select_converter();
+    return selected;
+}
+
+void fp32_to_fp16_array(const float *src, uint16_t *dst, size_t n)
+{
+    converter().to_fp16(src, dst, n);
+}
+
+void fp16_to_fp32_array(const uint16_t *src, float *dst, size_t n)
+{
+    converter().to_fp32(src, dst, n);
+}
+
+void accumulate_fp16_to_fp32(const uint16_t *src, float *dst, size_t n)
+{
+    converter().accumulate(src, dst, n);
+}
+
+const char *fp16_convert_path()
+{
+    return converter().path;
+}
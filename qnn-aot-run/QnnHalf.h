@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bulk FP32 <-> FP16 conversion for filling inputs and reading outputs.
+ *
+ * Same IEEE semantics as the scalar fp32_to_fp16/fp16_to_fp32 in QnnUtils
+ * (round to nearest even, subnormals kept, overflow to inf, NaN quieted
+ * with the top payload bits kept), so every path gives bit-identical
+ * results. The path is picked once per process: F16C on x86 CPUs that
+ * have it, NEON on aarch64, the scalar loop otherwise.
+ */
+void fp32_to_fp16_array(const float *src, uint16_t *dst, size_t n);
+void fp16_to_fp32_array(const uint16_t *src, float *dst, size_t n);
+// dst[i] += src[i], widened to FP32 (K tile partial sums)
+void accumulate_fp16_to_fp32(const uint16_t *src, float *dst, size_t n);
+
+// Always the scalar loop, for comparison against the dispatched path
+void fp32_to_fp16_array_scalar(const float *src, uint16_t *dst, size_t n);
+void fp16_to_fp32_array_scalar(const uint16_t *src, float *dst, size_t n);
+void accumulate_fp16_to_fp32_scalar(const uint16_t *src, float *dst, size_t n);
+
+// "f16c", "neon" or "scalar"
+const char *fp16_convert_path();
@@ -0,0 +1,223 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "QnnHalf.h"
+#include "QnnUtils.h"
+
+// FP32 <-> FP16 conversion: exhaustive correctness of the scalar and the
+// dispatched path over every FP16 and every FP32 bit pattern, then the
+// conversion rate of both on a runner-sized buffer.
+
+static uint32_t num_elems = 32 * 4096 * 8; // batch_size * input_shape of the linear runner
+static uint32_t num_iters = 50;
+static bool run_check = true;
+
+static void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--elems") && i + 1 < argc)
+            num_elems = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc)
+            num_iters = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--no-check"))
+            run_check = false;
+    }
+}
+
+static uint32_t float_bits(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+static float bits_float(uint32_t x)
+{
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// Exact value of a finite half, computed independently of the converters
+static double half_value(uint16_t h)
+{
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    double value = exp ? std::ldexp(1024.0 + mant, static_cast<int>(exp) - 25) : std::ldexp(mant, -24);
+    return (h & 0x8000) ? -value : value;
+}
+
+// Every half: scalar against the exact value, dispatched against scalar
+static uint64_t check_fp16_to_fp32()
+{
+    std::vector<uint16_t> halves(65536);
+    std::vector<float> scalar(65536);
+    std::vector<float> simd(65536);
+    for (uint32_t i = 0; i < 65536; i++)
+        halves[i] = static_cast<uint16_t>(i);
+
+    fp16_to_fp32_array_scalar(halves.data(), scalar.data(), halves.size());
+    fp16_to_fp32_array(halves.data(), simd.data(), halves.size());
+
+    uint64_t errors = 0;
+    for (uint32_t i = 0; i < 65536; i++)
+    {
+        uint32_t got = float_bits(scalar[i]);
+        uint32_t want;
+        if ((i & 0x7c00) == 0x7c00)
+        {
+            uint32_t mant = i & 0x3ff;
+            want = ((i & 0x8000) << 16) | 0x7f800000 | (mant << 13) | (mant ? 0x00400000 : 0);
+        }
+        else
+        {
+            want = float_bits(static_cast<float>(half_value(static_cast<uint16_t>(i))));
+        }
+
+        if (got != want || float_bits(simd[i]) != got)
+        {
+            if (errors++ < 8)
+                printf("  fp16 0x%04x: scalar 0x%08x, %s 0x%08x, expected 0x%08x\n",
+                       i, got, fp16_convert_path(), float_bits(simd[i]), want);
+        }
+    }
+    return errors;
+}
+
+// Round to nearest even: no neighbour of the result is closer, ties land on an even mantissa
+static bool is_nearest_even(uint32_t x, uint16_t h)
+{
+    if (((x >> 16) & 0x8000) != (h & 0x8000u))
+        return false;
+
+    uint32_t abs = x & 0x7fffffff;
+    uint16_t mag = h & 0x7fff;
+    if (abs > 0x7f800000)
+        return mag == (0x7e00 | ((abs >> 13) & 0x3ff));
+    if (abs == 0x7f800000)
+        return mag == 0x7c00;
+
+    double a = bits_float(abs);
+    if (mag == 0x7c00)
+        return a >= 65520.0; // halfway between 65504 and the next step, ties to inf (even)
+    if (mag > 0x7c00)
+        return false;
+
+    double d = a - half_value(mag);
+    d = d < 0 ? -d : d;
+    if (mag > 0)
+    {
+        double below = a - half_value(mag - 1);
+        if (below < d || (below == d && (mag & 1)))
+            return false;
+    }
+
+    double above = mag < 0x7bff ? half_value(mag + 1) - a : 65536.0 - a;
+    return !(above < d || (above == d && (mag & 1)));
+}
+
+// Every float bit pattern, split over the hardware threads
+static uint64_t check_fp32_to_fp16()
+{
+    uint32_t num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+        num_threads = 1;
+
+    const uint64_t chunk = 1u << 20;
+    const uint64_t num_chunks = (1ull << 32) / chunk;
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint32_t> reported{0};
+
+    auto worker = [&]()
+    {
+        std::vector<float> src(chunk);
+        std::vector<uint16_t> scalar(chunk);
+        std::vector<uint16_t> simd(chunk);
+        for (uint64_t c = next++; c < num_chunks; c = next++)
+        {
+            uint32_t base = static_cast<uint32_t>(c * chunk);
+            for (uint32_t i = 0; i < chunk; i++)
+                src[i] = bits_float(base + i);
+
+            fp32_to_fp16_array_scalar(src.data(), scalar.data(), chunk);
+            fp32_to_fp16_array(src.data(), simd.data(), chunk);
+
+            for (uint32_t i = 0; i < chunk; i++)
+            {
+                if (simd[i] == scalar[i] && is_nearest_even(base + i, scalar[i]))
+                    continue;
+
+                errors++;
+                if (reported++ < 8)
+                    printf("  fp32 0x%08x: scalar 0x%04x, %s 0x%04x\n", base + i, scalar[i], fp16_convert_path(), simd[i]);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; t++)
+        threads.emplace_back(worker);
+    for (auto &thread : threads)
+        thread.join();
+    return errors;
+}
+
+template <typename FN>
+static double elems_per_sec(FN convert)
+{
+    convert(); // warm up caches and page in the buffers
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iters; i++)
+        convert();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(num_elems) * num_iters / sec;
+}
+
+int main(int argc, char **argv)
+{
+    parse_bench_arg(argc, argv);
+
+    printf("=======================================================\n");
+    printf("FP16 conversion: %s path, %u elements x %u iterations\n", fp16_convert_path(), num_elems, num_iters);
+    printf("=======================================================\n");
+
+    if (run_check)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t errors16 = check_fp16_to_fp32();
+        printf("fp16 -> fp32: 65536 patterns, %lu mismatches\n", errors16);
+        uint64_t errors32 = check_fp32_to_fp16();
+        printf("fp32 -> fp16: 4294967296 patterns, %lu mismatches\n", errors32);
+        printf("Exhaustive check: %.1f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        if (errors16 || errors32)
+            return -1;
+    }
+
+    std::vector<float> fp32(num_elems);
+    std::vector<uint16_t> fp16(num_elems);
+    for (uint32_t i = 0; i < num_elems; i++)
+        fp32[i] = std::sin(static_cast<float>(i)) * 100.0f;
+
+    double scalar_to16 = elems_per_sec([&]()
+                                       { fp32_to_fp16_array_scalar(fp32.data(), fp16.data(), num_elems); });
+    double simd_to16 = elems_per_sec([&]()
+                                     { fp32_to_fp16_array(fp32.data(), fp16.data(), num_elems); });
+    double scalar_to32 = elems_per_sec([&]()
+                                       { fp16_to_fp32_array_scalar(fp16.data(), fp32.data(), num_elems); });
+    double simd_to32 = elems_per_sec([&]()
+                                     { fp16_to_fp32_array(fp16.data(), fp32.data(), num_elems); });
+
+    printf("%-14s %18s %18s %10s\n", "direction", "scalar (Melem/s)", "dispatch (Melem/s)", "speedup");
+    printf("%-14s %18.1f %18.1f %9.2fx\n", "fp32 -> fp16", scalar_to16 / 1e6, simd_to16 / 1e6, simd_to16 / scalar_to16);
+    printf("%-14s %18.1f %18.1f %9.2fx\n", "fp16 -> fp32", scalar_to32 / 1e6, simd_to32 / 1e6, simd_to32 / scalar_to32);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "QnnIOPipeline.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+static uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void IOPipeline::SlotQueue::push(Item item)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.push_back(item);
+    }
+    cv_.notify_one();
+}
+
+bool IOPipeline::SlotQueue::pop(Item &out)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]
+             { return closed_ || !items_.empty(); });
+    if (items_.empty())
+        return false;
+
+    out = items_.front();
+    items_.pop_front();
+    return true;
+}
+
+void IOPipeline::SlotQueue::close(bool discard)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        if (discard)
+            items_.clear();
+    }
+    cv_.notify_all();
+}
+
+void IOPipeline::SlotQueue::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.clear();
+    closed_ = false;
+}
+
+IOPipeline::IOPipeline(uint32_t depth, StageFn fill, StageFn execute, StageFn drain)
+    : depth_(depth ? depth : 1),
+      fill_(std::move(fill)),
+      execute_(std::move(execute)),
+      drain_(std::move(drain))
+{
+}
+
+void IOPipeline::abort()
+{
+    failed_ = true;
+    free_.close(true);
+    filled_.close(true);
+    executed_.close(true);
+}
+
+bool IOPipeline::run(uint64_t num_items)
+{
+    free_.reset();
+    filled_.reset();
+    executed_.reset();
+    stats_ = PipelineStats{};
+    stats_.depth = depth_;
+    failed_ = false;
+
+    for (uint32_t slot = 0; slot < depth_; slot++)
+        free_.push({slot, 0});
+
+    uint64_t start = now_ns();
+
+    std::thread filler([this, num_items]
+                       {
+        PipelineStageStats &stats = stats_.fill;
+        for (uint64_t seq = 0; seq < num_items; seq++)
+        {
+            Item item;
+            uint64_t wait_start = now_ns();
+            if (!free_.pop(item))
+                break;
+
+            uint64_t busy_start = now_ns();
+            stats.starved_ns += busy_start - wait_start;
+            if (!fill_(item.slot, seq))
+            {
+                printf("IOPipeline: fill of item %lu failed\n", seq);
+                abort();
+                break;
+            }
+            stats.busy_ns += now_ns() - busy_start;
+            stats.items++;
+
+            item.seq = seq;
+            filled_.push(item);
+        }
+        filled_.close(); });
+
+    std::thread drainer([this]
+                        {
+        PipelineStageStats &stats = stats_.drain;
+        Item item;
+        for (;;)
+        {
+            uint64_t wait_start = now_ns();
+            if (!executed_.pop(item))
+                break;
+
+            uint64_t busy_start = now_ns();
+            stats.starved_ns += busy_start - wait_start;
+            if (!drain_(item.slot, item.seq))
+            {
+                printf("IOPipeline: drain of item %lu failed\n", item.seq);
+                abort();
+                break;
+            }
+            stats.busy_ns += now_ns() - busy_start;
+            stats.items++;
+
+            free_.push(item);
+        } });
+
+    // Execute stays on the caller so the device is fed from one thread, back to back
+    PipelineStageStats &stats = stats_.execute;
+    Item item;
+    for (;;)
+    {
+        uint64_t wait_start = now_ns();
+        if (!filled_.pop(item))
+            break;
+
+        uint64_t busy_start = now_ns();
+        stats.starved_ns += busy_start - wait_start;
+        if (!execute_(item.slot, item.seq))
+        {
+            printf("IOPipeline: execute of item %lu failed\n", item.seq);
+            abort();
+            break;
+        }
+        stats.busy_ns += now_ns() - busy_start;
+        stats.items++;
+
+        executed_.push(item);
+    }
+    executed_.close();
+
+    filler.join();
+    drainer.join();
+
+    stats_.wall_ns = now_ns() - start;
+    return !failed_;
+}
+
+void IOPipeline::print_stats() const
+{
+    const PipelineStats &stats = stats_;
+    double wall_ms = stats.wall_ns / 1e6;
+
+    printf("IOPipeline: depth %u, %lu items in %.3f ms (%.1f items/s)\n",
+           stats.depth, stats.drain.items, wall_ms,
+           wall_ms > 0 ? stats.drain.items / (wall_ms / 1e3) : 0.0);
+    printf("  %-8s %8s %12s %10s %12s\n", "stage", "items", "busy (ms)", "occupancy", "starved (ms)");
+
+    const char *names[] = {"fill", "execute", "drain"};
+    const PipelineStageStats *stages[] = {&stats.fill, &stats.execute, &stats.drain};
+    const char *bottleneck = names[0];
+    uint64_t bottleneck_ns = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        printf("  %-8s %8lu %12.3f %9.1f%% %12.3f\n",
+               names[i], stages[i]->items,
+               stages[i]->busy_ns / 1e6,
+               stats.wall_ns ? 100.0 * stages[i]->busy_ns / stats.wall_ns : 0.0,
+               stages[i]->starved_ns / 1e6);
+        if (stages[i]->busy_ns > bottleneck_ns)
+        {
+            bottleneck_ns = stages[i]->busy_ns;
+            bottleneck = names[i];
+        }
+    }
+    printf("  bottleneck: %s\n", bottleneck);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+struct PipelineStageStats
+{
+    uint64_t items;
+    uint64_t busy_ns;    // inside the stage callback
+    uint64_t starved_ns; // waiting for a slot from the previous stage
+};
+
+struct PipelineStats
+{
+    PipelineStageStats fill;
+    PipelineStageStats execute;
+    PipelineStageStats drain;
+    uint64_t wall_ns;
+    uint32_t depth;
+};
+
+/**
+ * Ring of `depth` pre-registered I/O sets cycling through fill -> execute ->
+ * drain. The fill and drain stages run on their own threads and execute runs
+ * on the caller, so while slot k executes, slot k+1 is being filled and slot
+ * k-1 drained. Depth 1 degenerates to the plain sequential loop.
+ *
+ * Each stage callback gets the slot index and the item sequence number and
+ * returns false to abort the run.
+ */
+class IOPipeline
+{
+public:
+    using StageFn = std::function<bool(uint32_t slot, uint64_t seq)>;
+
+    IOPipeline(uint32_t depth, StageFn fill, StageFn execute, StageFn drain);
+
+    bool run(uint64_t num_items);
+
+    const PipelineStats &get_stats() const { return stats_; }
+    void print_stats() const;
+
+private:
+    struct Item
+    {
+        uint32_t slot;
+        uint64_t seq;
+    };
+
+    // Slots handed from one stage to the next
+    class SlotQueue
+    {
+    public:
+        void push(Item item);
+        // false once closed and empty
+        bool pop(Item &out);
+        // discard drops queued slots, used on abort
+        void close(bool discard = false);
+        void reset();
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Item> items_;
+        bool closed_{false};
+    };
+
+    void abort();
+
+    uint32_t depth_;
+    StageFn fill_;
+    StageFn execute_;
+    StageFn drain_;
+
+    SlotQueue free_;
+    SlotQueue filled_;
+    SlotQueue executed_;
+    PipelineStats stats_{};
+    std::atomic<bool> failed_{false};
+};
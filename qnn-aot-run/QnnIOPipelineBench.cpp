@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "QnnIOPipeline.h"
+
+// IOPipeline overlap on the host: each stage sleeps for its configured time,
+// so depth 1 costs fill + execute + drain per item and depth >= 3 should
+// approach the slowest stage alone.
+
+static uint32_t fill_us = 800;
+static uint32_t execute_us = 2000;
+static uint32_t drain_us = 600;
+static uint32_t num_items = 100;
+static uint32_t max_depth = 4;
+
+static void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--fill-us") && i + 1 < argc)
+            fill_us = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--execute-us") && i + 1 < argc)
+            execute_us = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--drain-us") && i + 1 < argc)
+            drain_us = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--items") && i + 1 < argc)
+            num_items = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+            max_depth = static_cast<uint32_t>(atoi(argv[++i]));
+    }
+}
+
+static IOPipeline::StageFn sleep_stage(uint32_t us)
+{
+    return [us](uint32_t, uint64_t)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+        return true;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    parse_bench_arg(argc, argv);
+
+    printf("=======================================================\n");
+    printf("IOPipeline: %u items, fill %u us, execute %u us, drain %u us\n", num_items, fill_us, execute_us, drain_us);
+    printf("=======================================================\n");
+
+    for (uint32_t depth = 1; depth <= max_depth; depth++)
+    {
+        IOPipeline pipeline(depth, sleep_stage(fill_us), sleep_stage(execute_us), sleep_stage(drain_us));
+        if (!pipeline.run(num_items))
+            return -1;
+        pipeline.print_stats();
+    }
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "QnnIOPlanner.h"
+#include "QnnSharedBuffer.h"
+#include <cstdio>
+#include <cstdlib>
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t qnn_datatype_bits(Qnn_DataType_t type)
+{
+    switch (type)
+    {
+    case QNN_DATATYPE_SFIXED_POINT_4:
+    case QNN_DATATYPE_UFIXED_POINT_4:
+        return 4;
+    case QNN_DATATYPE_INT_8:
+    case QNN_DATATYPE_UINT_8:
+    case QNN_DATATYPE_SFIXED_POINT_8:
+    case QNN_DATATYPE_UFIXED_POINT_8:
+    case QNN_DATATYPE_BOOL_8:
+        return 8;
+    case QNN_DATATYPE_INT_16:
+    case QNN_DATATYPE_UINT_16:
+    case QNN_DATATYPE_FLOAT_16:
+    case QNN_DATATYPE_SFIXED_POINT_16:
+    case QNN_DATATYPE_UFIXED_POINT_16:
+        return 16;
+    case QNN_DATATYPE_INT_32:
+    case QNN_DATATYPE_UINT_32:
+    case QNN_DATATYPE_FLOAT_32:
+    case QNN_DATATYPE_SFIXED_POINT_32:
+    case QNN_DATATYPE_UFIXED_POINT_32:
+        return 32;
+    case QNN_DATATYPE_INT_64:
+    case QNN_DATATYPE_UINT_64:
+    case QNN_DATATYPE_FLOAT_64:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+uint64_t qnn_tensor_elements(const Qnn_Tensor_t &tensor)
+{
+    uint32_t rank = qnn_tensor_rank(tensor);
+    const uint32_t *dims = qnn_tensor_dims(tensor);
+
+    uint64_t elements = 1;
+    for (uint32_t i = 0; i < rank; i++)
+        elements *= dims[i];
+    return elements;
+}
+
+uint64_t qnn_tensor_bytes(const Qnn_Tensor_t &tensor)
+{
+    uint32_t bits = qnn_datatype_bits(qnn_tensor_dtype(tensor));
+    if (bits == 0)
+    {
+        printf("Unsupported tensor data type: 0x%x\n", qnn_tensor_dtype(tensor));
+        return 0;
+    }
+
+    return (qnn_tensor_elements(tensor) * bits + 7) / 8;
+}
+
+IOPlan plan_io_buffers(const Qnn_Tensor_t *inputs, uint32_t num_inputs,
+                       const Qnn_Tensor_t *outputs, uint32_t num_outputs,
+                       uint32_t alignment)
+{
+    IOPlan plan;
+    plan.alignment = alignment;
+
+    uint64_t offset = 0;
+    auto place = [&](const Qnn_Tensor_t &tensor, std::vector<IOTensorSlot> &slots)
+    {
+        uint64_t bytes = qnn_tensor_bytes(tensor);
+        if (bytes == 0)
+            plan.valid = false;
+        slots.push_back({offset, bytes});
+        offset = align_up(offset + bytes, alignment);
+    };
+
+    for (uint32_t i = 0; i < num_inputs; i++)
+        place(inputs[i], plan.inputs);
+    for (uint32_t i = 0; i < num_outputs; i++)
+        place(outputs[i], plan.outputs);
+
+    plan.total_bytes = offset;
+    return plan;
+}
+
+bool IOArena::allocate(const IOPlan &plan, IOMemory memory)
+{
+    release();
+
+    if (!plan.valid)
+    {
+        printf("I/O plan has a tensor of unknown size, not allocating\n");
+        return false;
+    }
+
+    plan_ = plan;
+    memory_ = memory;
+
+    std::vector<IOTensorSlot> slots(plan_.inputs);
+    slots.insert(slots.end(), plan_.outputs.begin(), plan_.outputs.end());
+    tensor_ptrs_.assign(slots.size(), nullptr);
+
+    if (memory_ == IOMemory::SHARED_ION)
+    {
+        SharedBuffer &manager = SharedBuffer::get_shared_buffer_manager();
+        // ION registration covers a whole fd, so each tensor needs its own buffer
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            tensor_ptrs_[i] = manager.allocmem(static_cast<uint32_t>(slots[i].bytes), plan_.alignment);
+            if (tensor_ptrs_[i] == nullptr)
+            {
+                release();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t total = plan_.total_bytes ? plan_.total_bytes : plan_.alignment;
+    if (memory_ == IOMemory::SHARED_CUSTOM)
+        base_ = total <= UINT32_MAX ? SharedBuffer::get_shared_buffer_manager().allocmem(static_cast<uint32_t>(total), plan_.alignment) : nullptr;
+    else
+        base_ = aligned_alloc(plan_.alignment, align_up(total, plan_.alignment));
+
+    if (base_ == nullptr)
+    {
+        printf("Failed to allocate %lu byte I/O arena\n", total);
+        return false;
+    }
+
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        tensor_ptrs_[i] = reinterpret_cast<uint8_t *>(base_) + slots[i].offset;
+        if (memory_ == IOMemory::SHARED_CUSTOM)
+            SharedBuffer::get_shared_buffer_manager().add_custom_memory_tensor_addr(tensor_ptrs_[i], base_);
+    }
+
+    printf("I/O arena: %zu inputs, %zu outputs, %lu bytes\n", plan_.inputs.size(), plan_.outputs.size(), total);
+    return true;
+}
+
+void IOArena::release()
+{
+    if (memory_ == IOMemory::SHARED_ION)
+    {
+        for (void *buf : tensor_ptrs_)
+            if (buf)
+                SharedBuffer::get_shared_buffer_manager().freemem(buf);
+    }
+    else if (base_)
+    {
+        if (memory_ == IOMemory::SHARED_CUSTOM)
+            SharedBuffer::get_shared_buffer_manager().freemem(base_);
+        else
+            free(base_);
+    }
+
+    base_ = nullptr;
+    tensor_ptrs_.clear();
+}
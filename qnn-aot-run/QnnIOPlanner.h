@@ -0,0 +1,93 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include <cstdint>
+#include <vector>
+
+// Version independent views of a graph tensor
+inline uint32_t qnn_tensor_rank(const Qnn_Tensor_t &tensor)
+{
+    return tensor.version == QNN_TENSOR_VERSION_1 ? tensor.v1.rank : tensor.v2.rank;
+}
+
+inline const uint32_t *qnn_tensor_dims(const Qnn_Tensor_t &tensor)
+{
+    return tensor.version == QNN_TENSOR_VERSION_1 ? tensor.v1.dimensions : tensor.v2.dimensions;
+}
+
+inline Qnn_DataType_t qnn_tensor_dtype(const Qnn_Tensor_t &tensor)
+{
+    return tensor.version == QNN_TENSOR_VERSION_1 ? tensor.v1.dataType : tensor.v2.dataType;
+}
+
+// Bits per element, 0 for unknown types
+uint32_t qnn_datatype_bits(Qnn_DataType_t type);
+uint64_t qnn_tensor_elements(const Qnn_Tensor_t &tensor);
+uint64_t qnn_tensor_bytes(const Qnn_Tensor_t &tensor);
+
+struct IOTensorSlot
+{
+    uint64_t offset; // from the arena base
+    uint64_t bytes;
+};
+
+/**
+ * Placement of every graph input/output in one contiguous arena.
+ * Inputs come first, then outputs, each slot aligned to `alignment`.
+ * A plan with an unsized tensor is marked invalid and IOArena refuses it.
+ */
+struct IOPlan
+{
+    std::vector<IOTensorSlot> inputs;
+    std::vector<IOTensorSlot> outputs;
+    uint64_t total_bytes{0};
+    uint32_t alignment{64};
+    bool valid{true}; // false when a tensor sized to 0 bytes, the slots would alias
+};
+
+IOPlan plan_io_buffers(const Qnn_Tensor_t *inputs, uint32_t num_inputs,
+                       const Qnn_Tensor_t *outputs, uint32_t num_outputs,
+                       uint32_t alignment);
+
+template <typename INFO>
+IOPlan plan_io_buffers(const INFO &info, uint32_t alignment)
+{
+    return plan_io_buffers(info.graphInputs, info.numGraphInputs,
+                           info.graphOutputs, info.numGraphOutputs, alignment);
+}
+
+enum class IOMemory
+{
+    HOST,          // one aligned host allocation
+    SHARED_ION,    // one rpcmem buffer per tensor, registered as ION
+    SHARED_CUSTOM, // one rpcmem buffer for the graph, tensors registered at offsets
+};
+
+// Memory backing one IOPlan
+class IOArena
+{
+public:
+    IOArena() = default;
+    IOArena(const IOArena &) = delete;
+    IOArena &operator=(const IOArena &) = delete;
+    ~IOArena() { release(); }
+
+    bool allocate(const IOPlan &plan, IOMemory memory);
+    void release();
+
+    void *input(uint32_t i) const { return tensor_ptrs_[i]; }
+    void *output(uint32_t i) const { return tensor_ptrs_[plan_.inputs.size() + i]; }
+    uint64_t input_bytes(uint32_t i) const { return plan_.inputs[i].bytes; }
+    uint64_t output_bytes(uint32_t i) const { return plan_.outputs[i].bytes; }
+
+    // Base of the single allocation (nullptr for SHARED_ION)
+    void *base() const { return base_; }
+    IOMemory memory() const { return memory_; }
+    const IOPlan &plan() const { return plan_; }
+
+private:
+    IOPlan plan_;
+    IOMemory memory_{IOMemory::HOST};
+    void *base_{nullptr};
+    std::vector<void *> tensor_ptrs_;
+};
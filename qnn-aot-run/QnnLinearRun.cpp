@@ -4,89 +4,128 @@
 #include <vector>
 #include <cstring>
 #include <chrono>
+#include <memory>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <map>
+#include <thread>
 
 #include "QnnSetup.h"
 #include "QnnUtils.h"
+#include "QnnHalf.h"
+#include "QnnStagingPool.h"
 #include "QnnSharedBuffer.h"
+#include "QnnMemHandleCache.h"
+#include "QnnIOPlanner.h"
+#include "QnnContextBinary.h"
+#include "QnnAsyncExecutor.h"
+#include "QnnBatchBuckets.h"
+#include "QnnShard.h"
+#include "QnnGraphConfig.h"
+#include "QnnPerfMode.h"
+#include "QnnBenchmark.h"
+#include "QnnGraphBench.h"
+#include "QnnProfileCollector.h"
+#include "QnnTraceWriter.h"
+#include "QnnIOPipeline.h"
+#include "QnnBatchServer.h"
+#include "HTP/QnnHtpMem.h"
 
 uint32_t batch_size = 32;
 uint32_t input_shape = 4096 * 8;
 uint32_t output_shape = 4096 * 8;
 uint32_t num_iter = 10;
 
-static constexpr uint32_t DEFAULT_ALIGNMENT = 8;
-static constexpr bool USE_SHARED_BUFFER = true;
-static constexpr bool USE_CUSTOM_BUFFER = false;
+static constexpr uint32_t IO_ALIGNMENT = 64;
+// --ion registers every tensor as its own ION buffer instead of offsets into one custom buffer
+static bool use_custom_buffer = true;
+// rpcmem only exists next to a real HTP (or the host libcdsprpc stub the stub backend reads),
+// the simulator and CPU backends read client buffers
+static bool use_shared_buffer = true;
 
-std::string backend_lib_file = "libQnnHtp.so";
-std::string system_lib_file = "libQnnSystem.so";
 std::string context_bin_file = "LinearHtpContext.bin";
 
-void load_context_binary(std::vector<uint8_t> &out_binary, uint32_t &out_binsize)
+/**
+ * Registrations of pooled rpcmem blocks outlive the arena of a pass: the block
+ * keeps its handles while it waits in the pool, so the next pass that gets it
+ * back with the same layout hits the cache. They are dropped only when the pool
+ * trims the block back to rpcmem.
+ */
+class PooledRegistrations
 {
-    std::ifstream bin(context_bin_file, std::ios::binary | std::ios::ate);
-    assert(bin.is_open());
+public:
+    explicit PooledRegistrations(MemHandleCache &mem_cache)
+    {
+        SharedBuffer::get_shared_buffer_manager().set_release_hook([&mem_cache](void *block)
+                                                                   { mem_cache.release_buffer(block); });
+    }
+    PooledRegistrations(const PooledRegistrations &) = delete;
+    PooledRegistrations &operator=(const PooledRegistrations &) = delete;
+    ~PooledRegistrations() { SharedBuffer::get_shared_buffer_manager().set_release_hook(nullptr); }
+};
 
-    size_t binSize = bin.tellg();
-    bin.seekg(0);
+/**
+ * Bind a tensor to an offset inside one rpcmem block (QNN_MEM_TYPE_CUSTOM).
+ * Every tensor of the block shares the same fd, so the backend maps the
+ * block once and each tensor only adds a lightweight handle.
+ */
+template <typename T>
+bool register_custom(T &tensor, Qnn_Tensor_t &out_tessor,
+                     MemHandleCache &mem_cache,
+                     Qnn_ContextHandle_t context, void *data, void *base)
+{
+    SharedBuffer &manager = SharedBuffer::get_shared_buffer_manager();
 
-    out_binary.resize(binSize);
-    bin.read(reinterpret_cast<char *>(out_binary.data()), binSize);
-    bin.close();
+    // fd and offset are relative to the rpcmem block, not the aligned base
+    void *unaligned_base = manager.get_unaligned_addr(base);
+    uint32_t total_size = manager.get_allocated_size(unaligned_base);
+    int32_t memfd = manager.mem2fd(unaligned_base);
+    if (unaligned_base == nullptr || total_size == 0 || memfd < 0)
+    {
+        printf("register_custom: %p is not a shared buffer\n", base);
+        return false;
+    }
 
-    out_binsize = binSize;
+    uint64_t offset = reinterpret_cast<uint8_t *>(data) - reinterpret_cast<uint8_t *>(unaligned_base);
 
-    printf("Loaded context binary: %zu bytes\n", binSize);
-}
+    QnnMemHtp_Descriptor_t htp_descriptor;
+    htp_descriptor.type = QNN_HTP_MEM_SHARED_BUFFER;
+    htp_descriptor.size = total_size;
+    htp_descriptor.sharedBufferConfig = {memfd, offset};
 
-void export_profile_data(const std::string &OutputPath,
-                         const QnnProfile_EventId_t &Event,
-                         const QnnProfile_EventData_t &EventData)
-{
-    auto getUnit = [](QnnProfile_EventUnit_t Unit)
-    {
-        switch (Unit)
+    Qnn_MemDescriptor_t descriptor =
         {
-        case QNN_PROFILE_EVENTUNIT_MICROSEC:
-            return " (us)";
-        case QNN_PROFILE_EVENTUNIT_BYTES:
-            return " (bytes)";
-        case QNN_PROFILE_EVENTUNIT_COUNT:
-            return " (count)";
-        case QNN_PROFILE_EVENTUNIT_BACKEND:
-        case QNN_PROFILE_EVENTUNIT_CYCLES:
-        default:
-            return "";
-        }
-    };
-
-    FILE *file = fopen(OutputPath.c_str(), "a+");
-
-    std::string Identifier = std::string(EventData.identifier) + " " +
-                             std::to_string(EventData.value) +
-                             getUnit(EventData.unit);
+            {tensor.v2.rank, tensor.v2.dimensions, nullptr},
+            tensor.v2.dataType,
+            QNN_MEM_TYPE_CUSTOM,
+            {{memfd}}};
+    descriptor.customInfo = &htp_descriptor;
 
-    fprintf(file, "%s \n", Identifier.c_str());
+    Qnn_MemHandle_t mem_handle = mem_cache.acquire(context, descriptor, unaligned_base, memfd, offset);
+    if (mem_handle == nullptr)
+        return false;
 
-    fclose(file);
-}
+    printf("Registered custom memhandle: %p (fd %d, offset %lu)\n", mem_handle, memfd, offset);
 
-template <typename INFO>
-void register_custom(INFO &info, Qnn_Tensor_t &out_tessor,
-                     const QnnInterface_t *interface,
-                     Qnn_ContextHandle_t context, void *data, void *base)
-{
-    // TODO
+    out_tessor = tensor;
+    out_tessor.v2.memHandle = mem_handle;
+    out_tessor.v2.memType = QNN_TENSORMEMTYPE_MEMHANDLE;
+    return true;
 }
 
 template <typename T>
-void register_ion(T &tensor, Qnn_Tensor_t &out_tessor,
-                  const QnnInterface_t *interface,
+bool register_ion(T &tensor, Qnn_Tensor_t &out_tessor,
+                  MemHandleCache &mem_cache,
                   Qnn_ContextHandle_t context, void *data)
 {
-    Qnn_ErrorHandle_t err = QNN_SUCCESS;
-    int32_t memfd = SharedBuffer::get_shared_buffer_manager().mem2fd(data);
+    SharedBuffer &manager = SharedBuffer::get_shared_buffer_manager();
+    int32_t memfd = manager.mem2fd(data);
+    if (memfd < 0)
+    {
+        printf("register_ion: %p is not a shared buffer\n", data);
+        return false;
+    }
     Qnn_MemDescriptor_t descriptor =
         {
             {tensor.v2.rank, tensor.v2.dimensions, nullptr},
@@ -94,18 +133,9 @@ void register_ion(T &tensor, Qnn_Tensor_t &out_tessor,
             QNN_MEM_TYPE_ION,
             {{memfd}}};
 
-    Qnn_MemHandle_t mem_handle = nullptr;
-    err = interface->QNN_INTERFACE_VER_NAME.memRegister(
-        context,
-        &descriptor,
-        1,
-        &mem_handle);
-
-    if (err != QNN_SUCCESS)
-    {
-        printf("memRegister failed: %lu\n", err);
-        return;
-    }
+    Qnn_MemHandle_t mem_handle = mem_cache.acquire(context, descriptor, manager.get_unaligned_addr(data), memfd, 0);
+    if (mem_handle == nullptr)
+        return false;
 
     printf("Tensor rank: %u\n", tensor.v2.rank);
     printf("Tensor dimensions: %u x %u\n", tensor.v2.dimensions[0], tensor.v2.dimensions[1]);
@@ -114,58 +144,678 @@ void register_ion(T &tensor, Qnn_Tensor_t &out_tessor,
     out_tessor = tensor;
     out_tessor.v2.memHandle = mem_handle;
     out_tessor.v2.memType = QNN_TENSORMEMTYPE_MEMHANDLE;
+    return true;
+}
+
+// False when the tensor could not be registered (or its size overflows a client buffer)
+template <typename T>
+bool bind_tensor(T &tensor, Qnn_Tensor_t &out_tessor,
+                 MemHandleCache &mem_cache,
+                 Qnn_ContextHandle_t context, void *data, uint64_t bytes)
+{
+    if (use_shared_buffer)
+    {
+        void *custom_mem_base = SharedBuffer::get_shared_buffer_manager().get_custom_memory_base(data);
+        if (custom_mem_base && use_custom_buffer)
+            return register_custom(tensor, out_tessor, mem_cache, context, data, custom_mem_base);
+        return register_ion(tensor, out_tessor, mem_cache, context, data);
+    }
+
+    if (bytes > UINT32_MAX)
+    {
+        printf("bind_tensor: %lu bytes do not fit a client buffer\n", bytes);
+        return false;
+    }
+
+    out_tessor = tensor;
+    out_tessor.v2.memType = QNN_TENSORMEMTYPE_RAW;
+    out_tessor.v2.clientBuf.data = data;
+    out_tessor.v2.clientBuf.dataSize = static_cast<uint32_t>(bytes);
+    return true;
+}
+
+/**
+ * Give back the handle references bind_tensor took for one I/O set. The
+ * registrations stay cached with their blocks; free the arena afterwards.
+ */
+static void release_tensors(MemHandleCache &mem_cache,
+                            const std::vector<Qnn_Tensor_t> &inputs, const std::vector<Qnn_Tensor_t> &outputs)
+{
+    for (const auto &tensor : inputs)
+        if (tensor.v2.memType == QNN_TENSORMEMTYPE_MEMHANDLE)
+            mem_cache.release(tensor.v2.memHandle);
+    for (const auto &tensor : outputs)
+        if (tensor.v2.memType == QNN_TENSORMEMTYPE_MEMHANDLE)
+            mem_cache.release(tensor.v2.memHandle);
 }
 
+/**
+ * Size every graph input/output from its own rank/dims/dataType, place them
+ * in one arena and bind the tensors to their slots.
+ */
 template <typename INFO>
-void prepare_tensors(INFO &info, std::vector<Qnn_Tensor_t> &out_input_tensors, std::vector<Qnn_Tensor_t> &out_output_tensors,
-                     const QnnInterface_t *interface,
-                     Qnn_ContextHandle_t context,
-                     void *input_data,
-                     void *output_data)
+bool prepare_tensors(INFO &info, IOArena &arena,
+                     std::vector<Qnn_Tensor_t> &out_input_tensors, std::vector<Qnn_Tensor_t> &out_output_tensors,
+                     MemHandleCache &mem_cache,
+                     Qnn_ContextHandle_t context)
 {
-    Qnn_ErrorHandle_t err = QNN_SUCCESS;
+    IOMemory memory = !use_shared_buffer ? IOMemory::HOST
+                      : use_custom_buffer ? IOMemory::SHARED_CUSTOM
+                                          : IOMemory::SHARED_ION;
+    if (!arena.allocate(plan_io_buffers(info, IO_ALIGNMENT), memory))
+        return false;
 
     out_input_tensors.resize(info.numGraphInputs);
     out_output_tensors.resize(info.numGraphOutputs);
 
-    for (uint32_t i = 0; i < info.numGraphInputs; i++)
+    bool bound = true;
+    for (uint32_t i = 0; i < info.numGraphInputs && bound; i++)
+        bound = bind_tensor(info.graphInputs[i], out_input_tensors[i], mem_cache, context, arena.input(i), arena.input_bytes(i));
+
+    for (uint32_t i = 0; i < info.numGraphOutputs && bound; i++)
+        bound = bind_tensor(info.graphOutputs[i], out_output_tensors[i], mem_cache, context, arena.output(i), arena.output_bytes(i));
+
+    if (!bound)
+    {
+        // Hand back what was registered so callers have nothing to release
+        release_tensors(mem_cache, out_input_tensors, out_output_tensors);
+        out_input_tensors.clear();
+        out_output_tensors.clear();
+        arena.release();
+    }
+    return bound;
+}
+
+/**
+ * Run `num_items` inferences through a ring of `depth` I/O sets, each with
+ * its own arena and registered tensors, overlapping fill and readback of
+ * neighbouring sets with execution.
+ */
+static bool run_pipeline(const QnnInterface_t *interface, QnnGraph &graph,
+                         MemHandleCache &mem_cache, Qnn_ContextHandle_t context,
+                         uint32_t depth, uint64_t num_items)
+{
+    std::vector<std::unique_ptr<IOArena>> arenas;
+    std::vector<std::vector<Qnn_Tensor_t>> inputs(depth);
+    std::vector<std::vector<Qnn_Tensor_t>> outputs(depth);
+    bool prepared = true;
+    for (uint32_t slot = 0; slot < depth && prepared; slot++)
+    {
+        arenas.emplace_back(new IOArena());
+        prepared = prepare_tensors(graph.info, *arenas[slot], inputs[slot], outputs[slot], mem_cache, context);
+    }
+
+    std::vector<float> checksums(depth, 0.0f);
+    std::vector<std::vector<float>> readback(depth);
+    auto fill = [&](uint32_t slot, uint64_t)
     {
-        uint16_t *data_ptr = reinterpret_cast<uint16_t *>(input_data) + i;
+        IOArena &arena = *arenas[slot];
+        for (uint32_t t = 0; t < inputs[slot].size(); t++)
+        {
+            uint16_t *data = reinterpret_cast<uint16_t *>(arena.input(t));
+            std::fill_n(data, arena.input_bytes(t) / sizeof(uint16_t), fp32_to_fp16(1.0f));
+        }
+        return true;
+    };
 
-        if (USE_SHARED_BUFFER)
+    auto execute = [&](uint32_t slot, uint64_t)
+    {
+        Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+            graph.handle,
+            inputs[slot].data(), inputs[slot].size(),
+            outputs[slot].data(), outputs[slot].size(),
+            nullptr, nullptr);
+        if (err != QNN_SUCCESS)
         {
-            void *custom_mem_base = SharedBuffer::get_shared_buffer_manager().get_custom_memory_base(data_ptr);
-            if (custom_mem_base && USE_CUSTOM_BUFFER)
-                register_custom(info.graphInputs[i], out_input_tensors[i], interface, context, custom_mem_base);
-            else
-                register_ion(info.graphInputs[i], out_input_tensors[i], interface, context, data_ptr);
+            printf("graphExecute failed: %lu\n", err);
+            return false;
         }
-        else
+        return true;
+    };
+
+    auto drain = [&](uint32_t slot, uint64_t)
+    {
+        IOArena &arena = *arenas[slot];
+        float sum = 0.0f;
+        for (uint32_t t = 0; t < outputs[slot].size(); t++)
         {
-            out_input_tensors[i] = info.graphInputs[i];
-            out_input_tensors[i].v2.memType = QNN_TENSORMEMTYPE_RAW;
-            out_input_tensors[i].v2.clientBuf.data = reinterpret_cast<uint16_t *>(input_data) + i;
-            out_input_tensors[i].v2.clientBuf.dataSize = batch_size * input_shape * sizeof(uint16_t);
+            size_t elems = arena.output_bytes(t) / sizeof(uint16_t);
+            readback[slot].resize(elems);
+            fp16_to_fp32_array(reinterpret_cast<const uint16_t *>(arena.output(t)), readback[slot].data(), elems);
+            for (float value : readback[slot])
+                sum += value;
         }
+        checksums[slot] = sum;
+        return true;
+    };
+
+    bool ok = prepared;
+    if (ok)
+    {
+        IOPipeline pipeline(depth, fill, execute, drain);
+        ok = pipeline.run(num_items);
+        pipeline.print_stats();
+        printf("Pipeline output checksum: %f\n", checksums[(num_items - 1) % depth]);
+    }
+    else
+    {
+        printf("Failed to prepare pipeline I/O sets\n");
+    }
+
+    for (uint32_t slot = 0; slot < arenas.size(); slot++)
+    {
+        release_tensors(mem_cache, inputs[slot], outputs[slot]);
+        arenas[slot]->release();
     }
 
-    for (uint32_t i = 0; i < info.numGraphOutputs; i++)
+    return ok;
+}
+
+/**
+ * Serve single rows through the registered batch buffers and report
+ * throughput and latency for the given deadline.
+ */
+static bool run_batch_server(const QnnInterface_t *interface, Qnn_GraphHandle_t graph,
+                             std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                             IOArena &arena, uint32_t max_wait_us, double rate)
+{
+    // Rows are the outermost dimension the graph was compiled with
+    uint32_t rows = qnn_tensor_dims(inputs[0])[0];
+
+    BatchServerConfig config;
+    config.batch_size = rows;
+    config.input_row_bytes = arena.input_bytes(0) / rows;
+    config.output_row_bytes = arena.output_bytes(0) / rows;
+    config.max_wait_us = max_wait_us;
+    config.input = arena.input(0);
+    config.output = arena.output(0);
+
+    BatchServer server(config, [&](uint32_t)
+                       {
+        Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+            graph,
+            inputs.data(), inputs.size(),
+            outputs.data(), outputs.size(),
+            nullptr, nullptr);
+        if (err != QNN_SUCCESS)
+        {
+            printf("graphExecute failed: %lu\n", err);
+            return false;
+        }
+        return true; });
+
+    uint32_t elems = static_cast<uint32_t>(config.input_row_bytes / sizeof(uint16_t));
+    BatchLoadResult result = run_batch_load(server, config, rate, num_iter * rows,
+                                            [elems](uint32_t, void *row)
+                                            {
+                                                std::fill_n(static_cast<uint16_t *>(row), elems, fp32_to_fp16(1.0f));
+                                            });
+
+    print_batch_load_header();
+    print_batch_load_result(result);
+    server.print_stats();
+    return result.failures == 0;
+}
+
+// Mean execute latency of every bucket, then the saving of bucket selection
+static bool run_bucket_bench(const QnnInterface_t *interface, const BatchBuckets &buckets,
+                             MemHandleCache &mem_cache, Qnn_ContextHandle_t context)
+{
+    std::vector<double> latency_ms;
+    for (const BatchBucket &bucket : buckets.buckets())
     {
-        if (USE_SHARED_BUFFER)
+        IOArena arena;
+        std::vector<Qnn_Tensor_t> inputs;
+        std::vector<Qnn_Tensor_t> outputs;
+        if (!prepare_tensors(bucket.graph->info, arena, inputs, outputs, mem_cache, context))
+            return false;
+
+        for (uint32_t t = 0; t < inputs.size(); t++)
         {
-            if (USE_CUSTOM_BUFFER)
-                register_custom(info.graphOutputs[i], out_output_tensors[i], interface, context, reinterpret_cast<uint16_t *>(output_data) + i);
-            else
-                register_ion(info.graphOutputs[i], out_output_tensors[i], interface, context, reinterpret_cast<uint16_t *>(output_data) + i);
+            uint16_t *data = reinterpret_cast<uint16_t *>(arena.input(t));
+            std::fill_n(data, arena.input_bytes(t) / sizeof(uint16_t), fp32_to_fp16(1.0f));
         }
-        else
+
+        double total_ms = 0.0;
+        // First execution warms up and is not counted
+        for (uint32_t i = 0; i <= num_iter; i++)
         {
-            out_output_tensors[i] = info.graphOutputs[i];
-            out_output_tensors[i].v2.memType = QNN_TENSORMEMTYPE_RAW;
-            out_output_tensors[i].v2.clientBuf.data = reinterpret_cast<uint16_t *>(output_data) + i;
-            out_output_tensors[i].v2.clientBuf.dataSize = batch_size * output_shape * sizeof(uint16_t);
+            auto start = std::chrono::high_resolution_clock::now();
+            Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+                bucket.graph->handle,
+                inputs.data(), inputs.size(),
+                outputs.data(), outputs.size(),
+                nullptr, nullptr);
+            auto end = std::chrono::high_resolution_clock::now();
+            if (err != QNN_SUCCESS)
+            {
+                printf("graphExecute(%s) failed: %lu\n", bucket.graph->info.graphName, err);
+                release_tensors(mem_cache, inputs, outputs);
+                return false;
+            }
+            if (i > 0)
+                total_ms += std::chrono::duration<double, std::milli>(end - start).count();
         }
+        latency_ms.push_back(num_iter ? total_ms / num_iter : 0.0);
+
+        release_tensors(mem_cache, inputs, outputs);
     }
+
+    print_bucket_savings(buckets, latency_ms, batch_size);
+    return true;
+}
+
+/**
+ * The layer through its shard graphs against the monolithic graph. Each
+ * iteration gathers every shard's K tile of the FP16 input, submits the
+ * shard right away and combines outputs on the host as they complete:
+ * column shards are converted straight into their columns of the FP32
+ * output, K tiles are summed in FP32. The monolithic pass does the same
+ * host work (input copy, FP32 readback) so the two are comparable; it is
+ * skipped when the selected graph has a different shape.
+ */
+static bool run_shard_bench(const QnnInterface_t *interface, QnnGraphTable &graphs,
+                            Qnn_GraphHandle_t graph, std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                            IOArena &io_arena, MemHandleCache &mem_cache, Qnn_ContextHandle_t context,
+                            const RunOptions &options)
+{
+    ShardedLayer layer;
+    if (!layer.build(graphs, options.rows ? options.rows : batch_size))
+    {
+        printf("No shard graphs in %s (build with --col-shards/--k-tiles)\n", options.context_bin.c_str());
+        return false;
+    }
+
+    const std::vector<LayerShard> &shards = layer.shards();
+    uint32_t rows = layer.batch();
+    uint32_t in_features = layer.in_features();
+    uint32_t out_features = layer.out_features();
+    printf("Sharded layer %s: %u column shard(s) x %u K tile(s), [%u, %u] -> [%u, %u], reduce path %s\n",
+           layer.name().c_str(), layer.col_shards(), layer.k_tiles(), rows, in_features, rows, out_features,
+           fp16_convert_path());
+
+    uint64_t rss_before = get_current_rss_kb();
+    std::vector<std::unique_ptr<IOArena>> arenas;
+    std::vector<std::vector<Qnn_Tensor_t>> shard_inputs(shards.size());
+    std::vector<std::vector<Qnn_Tensor_t>> shard_outputs(shards.size());
+    uint64_t shard_io_bytes = 0;
+    bool ok = true;
+    for (size_t i = 0; i < shards.size() && ok; i++)
+    {
+        arenas.emplace_back(new IOArena());
+        ok = prepare_tensors(shards[i].graph->info, *arenas[i], shard_inputs[i], shard_outputs[i], mem_cache, context);
+        if (ok)
+            shard_io_bytes += arenas[i]->input_bytes(0) + arenas[i]->output_bytes(0);
+    }
+
+    std::vector<uint16_t> host_input(static_cast<size_t>(rows) * in_features, fp32_to_fp16(1.0f));
+    std::vector<float> sharded_output(static_cast<size_t>(rows) * out_features);
+    std::vector<float> monolithic_output(sharded_output.size());
+
+    BenchConfig config;
+    config.warmup = options.warmup;
+    config.iterations = options.iterations ? options.iterations : num_iter;
+    config.flops = 2.0 * rows * in_features * out_features;
+    config.weight_bytes = 2.0 * in_features * out_features;
+
+    // Every shard may be in flight at once
+    AsyncExecutor executor(interface, static_cast<uint32_t>(shards.size()));
+    std::vector<uint32_t> tiles_done(layer.col_shards());
+    config.label = "sharded-" + std::to_string(layer.col_shards()) + "x" + std::to_string(layer.k_tiles());
+    BenchHarness sharded(config);
+    ok = ok && sharded.run(
+                   [&](uint32_t)
+                   {
+                       for (size_t i = 0; i < shards.size(); i++)
+                       {
+                           gather_columns(host_input.data(), rows, in_features, shards[i].k0, shards[i].kn,
+                                          reinterpret_cast<uint16_t *>(arenas[i]->input(0)));
+                           executor.submit(shards[i].graph->handle,
+                                           shard_inputs[i].data(), shard_inputs[i].size(),
+                                           shard_outputs[i].data(), shard_outputs[i].size(),
+                                           reinterpret_cast<void *>(i));
+                       }
+
+                       std::fill(tiles_done.begin(), tiles_done.end(), 0);
+                       AsyncCompletion done;
+                       for (size_t remaining = shards.size(); remaining > 0 && executor.wait(done); remaining--)
+                       {
+                           if (done.error != QNN_SUCCESS)
+                           {
+                               printf("graphExecute(shard) failed: %lu\n", done.error);
+                               executor.drain();
+                               return false;
+                           }
+                           size_t i = reinterpret_cast<size_t>(done.user_data);
+                           const LayerShard &shard = shards[i];
+                           combine_shard_output(reinterpret_cast<const uint16_t *>(arenas[i]->output(0)), rows, shard.nn,
+                                                sharded_output.data(), out_features, shard.n0, tiles_done[shard.col]++ > 0);
+                       }
+                       return true;
+                   });
+    if (ok)
+        sharded.print();
+    uint64_t rss_sharded = get_current_rss_kb();
+
+    // Monolithic graph of the same shape, with the same host work around it
+    const uint32_t *in_dims = qnn_tensor_dims(inputs[0]);
+    const uint32_t *out_dims = qnn_tensor_dims(outputs[0]);
+    bool comparable = in_dims[0] == rows && in_dims[1] == in_features && out_dims[1] == out_features;
+    if (ok && comparable)
+    {
+        config.label = "monolithic";
+        BenchHarness monolithic(config);
+        ok = monolithic.run(
+            [&](uint32_t)
+            {
+                memcpy(io_arena.input(0), host_input.data(), host_input.size() * sizeof(uint16_t));
+                Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+                    graph,
+                    inputs.data(), inputs.size(),
+                    outputs.data(), outputs.size(),
+                    nullptr, nullptr);
+                if (err != QNN_SUCCESS)
+                {
+                    printf("graphExecute failed: %lu\n", err);
+                    return false;
+                }
+                fp16_to_fp32_array(reinterpret_cast<const uint16_t *>(io_arena.output(0)), monolithic_output.data(),
+                                   monolithic_output.size());
+                return true;
+            });
+        if (ok)
+        {
+            monolithic.print();
+            BenchStats s = sharded.compute();
+            BenchStats m = monolithic.compute();
+            float max_diff = 0.0f;
+            for (size_t i = 0; i < sharded_output.size(); i++)
+                max_diff = std::max(max_diff, std::fabs(sharded_output[i] - monolithic_output[i]));
+            printf("Sharded vs monolithic: %.3f ms vs %.3f ms (%.2fx), max |diff| %g\n",
+                   s.mean_ns / 1e6, m.mean_ns / 1e6, s.mean_ns > 0 ? m.mean_ns / s.mean_ns : 0.0, max_diff);
+        }
+    }
+    else if (ok)
+    {
+        printf("Selected graph is not [%u, %u] -> [%u, %u], no monolithic comparison (AOT --with-monolithic)\n",
+               rows, in_features, rows, out_features);
+    }
+
+    printf("Sharded I/O: %lu bytes in %zu arenas (monolithic %lu), RSS +%ld KiB, peak RSS %lu KiB\n",
+           shard_io_bytes, arenas.size(), io_arena.input_bytes(0) + io_arena.output_bytes(0),
+           static_cast<long>(rss_sharded) - static_cast<long>(rss_before), get_peak_rss_kb());
+
+    for (size_t i = 0; i < arenas.size(); i++)
+    {
+        release_tensors(mem_cache, shard_inputs[i], shard_outputs[i]);
+        arenas[i]->release();
+    }
+
+    return ok;
+}
+
+/**
+ * Execute latency with each profiling mode on the same tensors. Every mode
+ * gets its own profile handle so the levels do not leak into each other;
+ * event collection runs outside the timed region and is reported apart.
+ */
+static bool run_profile_bench(const QnnInterface_t *interface, Qnn_BackendHandle_t backend, Qnn_GraphHandle_t graph,
+                              std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                              const RunOptions &options)
+{
+    uint32_t every = options.profile_every > 1 ? options.profile_every : 10;
+    const ProfileMode modes[] = {ProfileMode::OFF, ProfileMode::BASIC, ProfileMode::DETAILED, ProfileMode::SAMPLED};
+
+    printf("Profiling overhead (sampled every %u):\n", every);
+    printf("  %-10s %12s %12s %12s %10s %14s\n", "mode", "mean (us)", "p50 (us)", "p99 (us)", "overhead", "collect (us)");
+
+    double off_mean_ns = 0.0;
+    for (ProfileMode mode : modes)
+    {
+        Qnn_ProfileHandle_t profile = QnnCreateProfile(interface, backend, mode);
+        if (mode != ProfileMode::OFF && profile == nullptr)
+            return false;
+
+        BenchConfig config;
+        config.label = std::string("profile-") + profile_mode_name(mode);
+        config.warmup = options.warmup;
+        config.iterations = options.iterations ? options.iterations : num_iter;
+
+        BenchHarness bench(config);
+        ProfileCollector profiler(interface, profile, mode == ProfileMode::SAMPLED ? every : 1);
+        double collect_ns = 0.0;
+        bool ok = bench.run(
+            [&](uint32_t i)
+            {
+                Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+                    graph,
+                    inputs.data(), inputs.size(),
+                    outputs.data(), outputs.size(),
+                    profiler.handle(i), nullptr);
+                if (err != QNN_SUCCESS)
+                {
+                    printf("graphExecute failed: %lu\n", err);
+                    return false;
+                }
+                return true;
+            },
+            [&](uint32_t i)
+            {
+                auto start = std::chrono::steady_clock::now();
+                bool collected = profiler.collect(i);
+                collect_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                return collected;
+            });
+
+        if (profile)
+            interface->QNN_INTERFACE_VER_NAME.profileFree(profile);
+        if (!ok)
+            return false;
+
+        BenchStats stats = bench.compute();
+        if (mode == ProfileMode::OFF)
+            off_mean_ns = stats.mean_ns;
+
+        uint32_t runs = config.warmup + config.iterations;
+        printf("  %-10s %12.3f %12.3f %12.3f %9.1f%% %14.3f\n", profile_mode_name(mode),
+               stats.mean_ns / 1e3, stats.p50_ns / 1e3, stats.p99_ns / 1e3,
+               off_mean_ns > 0 ? 100.0 * (stats.mean_ns / off_mean_ns - 1.0) : 0.0,
+               runs ? collect_ns / runs / 1e3 : 0.0);
+    }
+
+    return true;
+}
+
+/**
+ * Execute latency under each perf mode on the same tensors. Every mode
+ * starts after an idle gap, so the first execution shows the wake-up and
+ * clock ramp a vote is meant to hide; the timed runs are the steady state.
+ */
+static bool run_perf_bench(const QnnInterface_t *interface, PerfController &perf, Qnn_GraphHandle_t graph,
+                           std::vector<Qnn_Tensor_t> &inputs, std::vector<Qnn_Tensor_t> &outputs,
+                           const RunOptions &options)
+{
+    if (!perf.available())
+    {
+        printf("Perf bench skipped, the backend has no HTP perf infrastructure\n");
+        return true;
+    }
+
+    const uint32_t idle_ms = 200;
+    const PerfMode modes[] = {PerfMode::DEFAULT, PerfMode::POWER_SAVER, PerfMode::BALANCED,
+                              PerfMode::SUSTAINED, PerfMode::BURST};
+
+    auto execute = [&](uint32_t)
+    {
+        Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+            graph,
+            inputs.data(), inputs.size(),
+            outputs.data(), outputs.size(),
+            nullptr, nullptr);
+        if (err != QNN_SUCCESS)
+        {
+            printf("graphExecute failed: %lu\n", err);
+            return false;
+        }
+        return true;
+    };
+
+    printf("Perf modes (%u ms idle before each):\n", idle_ms);
+    printf("  %-12s %12s %12s %12s %12s\n", "mode", "first (us)", "mean (us)", "p50 (us)", "p99 (us)");
+    for (PerfMode mode : modes)
+    {
+        PerfModeScope scope(perf, mode);
+        std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+
+        PerfBurst burst(perf);
+        auto start = std::chrono::steady_clock::now();
+        if (!execute(0))
+            return false;
+        double first_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        BenchConfig config;
+        config.label = std::string("perf-") + perf_mode_name(mode);
+        config.warmup = options.warmup;
+        config.iterations = options.iterations ? options.iterations : num_iter;
+        BenchHarness bench(config);
+        if (!bench.run(execute))
+            return false;
+
+        BenchStats stats = bench.compute();
+        printf("  %-12s %12.3f %12.3f %12.3f %12.3f\n", perf_mode_name(mode),
+               first_us, stats.mean_ns / 1e3, stats.p50_ns / 1e3, stats.p99_ns / 1e3);
+    }
+
+    PerfVoteStats votes = perf.get_stats();
+    printf("  %lu votes, %lu relaxes, %lu failed\n", votes.votes, votes.relaxes, votes.failed);
+    return true;
+}
+
+/**
+ * Every binary of an AOT --sweep list: load it, time each graph in it and
+ * report the fastest graph configuration per graph (shape). Results also
+ * go to --csv, one row per binary and graph.
+ */
+static bool run_config_sweep(const QnnInterface_t *interface, const QnnSystemInterface_t *sys_interface,
+                             Qnn_BackendHandle_t backend, Qnn_DeviceHandle_t device, PerfController &perf,
+                             const RunOptions &options)
+{
+    std::ifstream list(options.sweep_list);
+    if (!list.is_open())
+    {
+        printf("Failed to open sweep list %s\n", options.sweep_list.c_str());
+        return false;
+    }
+
+    struct SweepResult
+    {
+        std::string tag;
+        double mean_ns;
+    };
+    std::map<std::string, std::vector<SweepResult>> results;
+
+    std::string bin_path;
+    while (std::getline(list, bin_path))
+    {
+        if (bin_path.empty())
+            continue;
+
+        ContextMetadata metadata;
+        std::string tag = read_context_metadata(bin_path, metadata) ? metadata.graph_config.tag() : bin_path;
+        printf("Sweep: %s (%s)\n", bin_path.c_str(), tag.c_str());
+
+        ContextBinary bin;
+        QnnSystemContext sys_context;
+        std::vector<QnnGraphInfo> graph_infos;
+        if (!bin.load(bin_path, options.use_mmap) ||
+            !QnnGetGraphInfosFromBinary(sys_interface, bin.data(), bin.size(), sys_context, graph_infos))
+            return false;
+
+        Qnn_ContextHandle_t context;
+        Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.contextCreateFromBinary(
+            backend, device, nullptr, bin.data(), (Qnn_ContextBinarySize_t)bin.size(), &context, nullptr);
+        if (err != QNN_SUCCESS)
+        {
+            printf("contextCreateFromBinary(%s) failed: %lu\n", bin_path.c_str(), err);
+            return false;
+        }
+        bin.release();
+
+        QnnGraphTable graphs;
+        if (!QnnRetrieveGraphs(interface, context, graph_infos, graphs))
+            return false;
+
+        MemHandleCache mem_cache(interface);
+        PooledRegistrations pooled(mem_cache);
+        bool ok = true;
+        for (auto &entry : graphs)
+        {
+            IOArena arena;
+            std::vector<Qnn_Tensor_t> inputs;
+            std::vector<Qnn_Tensor_t> outputs;
+            if (!prepare_tensors(entry.second.info, arena, inputs, outputs, mem_cache, context))
+            {
+                ok = false;
+                break;
+            }
+            for (uint32_t t = 0; t < inputs.size(); t++)
+                std::fill_n(reinterpret_cast<uint16_t *>(arena.input(t)), arena.input_bytes(t) / sizeof(uint16_t),
+                            fp32_to_fp16(1.0f));
+
+            BenchConfig config;
+            const uint32_t *in_dims = qnn_tensor_dims(inputs[0]);
+            const uint32_t *out_dims = qnn_tensor_dims(outputs[0]);
+            config.label = tag + "/" + entry.first;
+            config.warmup = options.warmup;
+            config.iterations = options.iterations ? options.iterations : num_iter;
+            config.flops = 2.0 * in_dims[0] * in_dims[1] * out_dims[1];
+            config.weight_bytes = 2.0 * in_dims[1] * out_dims[1];
+            config.csv_path = options.csv_path;
+            BenchHarness bench(config);
+            PerfBurst burst(perf);
+            ok = bench.run(
+                [&](uint32_t)
+                {
+                    Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
+                        entry.second.handle,
+                        inputs.data(), inputs.size(),
+                        outputs.data(), outputs.size(),
+                        nullptr, nullptr);
+                    if (err != QNN_SUCCESS)
+                    {
+                        printf("graphExecute(%s) failed: %lu\n", entry.first.c_str(), err);
+                        return false;
+                    }
+                    return true;
+                });
+            ok = ok && bench.report();
+            if (ok)
+                results[entry.first].push_back({tag, bench.compute().mean_ns});
+
+            release_tensors(mem_cache, inputs, outputs);
+            if (!ok)
+                break;
+        }
+
+        mem_cache.release_context(context);
+        interface->QNN_INTERFACE_VER_NAME.contextFree(context, nullptr);
+        if (!ok)
+            return false;
+    }
+
+    printf("Fastest graph configuration per graph:\n");
+    printf("  %-20s %-24s %12s %-24s %12s %8s\n", "graph", "best", "mean (us)", "worst", "mean (us)", "speedup");
+    for (auto &entry : results)
+    {
+        auto by_mean = [](const SweepResult &a, const SweepResult &b)
+        { return a.mean_ns < b.mean_ns; };
+        const SweepResult &best = *std::min_element(entry.second.begin(), entry.second.end(), by_mean);
+        const SweepResult &worst = *std::max_element(entry.second.begin(), entry.second.end(), by_mean);
+        printf("  %-20s %-24s %12.3f %-24s %12.3f %7.2fx\n", entry.first.c_str(),
+               best.tag.c_str(), best.mean_ns / 1e3, worst.tag.c_str(), worst.mean_ns / 1e3,
+               best.mean_ns > 0 ? worst.mean_ns / best.mean_ns : 0.0);
+    }
+    return true;
 }
 
 int main(int argc, char **argv)
@@ -174,7 +824,10 @@ int main(int argc, char **argv)
     printf("Qnn Linear Load Smoke Test\n");
     printf("=======================================================\n");
 
-    // parse_arg(argc, argv);
+    // parse_arg(argc, argv, input_shape, output_shape);
+    RunOptions options;
+    options.context_bin = context_bin_file;
+    parse_run_arg(argc, argv, options);
 
     void *handle;
     void *sys_handle;
@@ -187,8 +840,12 @@ int main(int argc, char **argv)
     Qnn_GraphHandle_t graph;
     Qnn_ProfileHandle_t profile;
 
-    QnnInit(backend_lib_file.c_str(),
-            system_lib_file.c_str(),
+    std::string backend_lib = options.backend_lib.empty() ? backend_library(options.backend) : options.backend_lib;
+    use_shared_buffer = options.backend == BackendType::HTP || options.backend == BackendType::STUB;
+    use_custom_buffer = !options.ion_buffers;
+
+    QnnInit(backend_lib.c_str(),
+            system_library(options.backend),
             &handle,
             &sys_handle,
             &interface,
@@ -196,25 +853,46 @@ int main(int argc, char **argv)
             &logger,
             &device, &backend,
             nullptr, nullptr,
-            &profile, false);
+            &profile, false, nullptr, options.profile_mode, options.backend, options.htp_arch);
+
+    // Voted before any context loads; dropped before the backend is unloaded
+    std::unique_ptr<PerfController> perf(new PerfController(interface, options.perf_relax_ms));
+    if (perf->available() && perf->set_mode(options.perf_mode))
+        printf("Perf mode: %s\n", perf_mode_name(options.perf_mode));
+
+    if (!options.sweep_list.empty())
+    {
+        bool ok = run_config_sweep(interface, sys_interface, backend, device, *perf, options);
+        perf.reset();
+        QnnCleanup(handle, sys_handle);
+        return ok ? 0 : -1;
+    }
     {
-        std::vector<uint8_t> bin_data;
-        uint32_t bin_size = 0;
-        load_context_binary(bin_data, bin_size);
+        TraceWriter trace(!options.trace_path.empty());
+        double load_begin = trace.now();
+        auto load_start = std::chrono::high_resolution_clock::now();
+        ContextBinary bin;
+        if (!bin.load(options.context_bin, options.use_mmap))
+            return -1;
+
+        ContextMetadata metadata;
+        if (read_context_metadata(options.context_bin, metadata))
+            printf("Built as %s [%u -> %u], %s weights, %u x %u shards, graph config %s\n",
+                   metadata.layer.c_str(), metadata.in_features, metadata.out_features, metadata.weights.c_str(),
+                   metadata.col_shards, metadata.k_tiles, metadata.graph_config.tag().c_str());
 
         // Graph Info 를 Binary 로 부터 Load
-        uint32_t num_graph = 0;
-        QnnSystemContext_GraphInfo_t *graph_info = nullptr;
-        const QnnSystemContext_BinaryInfo_t *binary_info = nullptr;
-        std::string graph_name;
-        QnnGetGraphInfoFromBinary(sys_interface, bin_data.data(), bin_size, &num_graph, &graph_info, &binary_info, graph_name);
+        QnnSystemContext sys_context;
+        std::vector<QnnGraphInfo> graph_infos;
+        if (!QnnGetGraphInfosFromBinary(sys_interface, bin.data(), bin.size(), sys_context, graph_infos))
+            return -1;
 
         Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.contextCreateFromBinary(
             backend,
             device,
             nullptr,         // const QnnContext_Config_t** config
-            bin_data.data(), // binaryBuffer
-            (Qnn_ContextBinarySize_t)bin_size,
+            bin.data(),      // binaryBuffer
+            (Qnn_ContextBinarySize_t)bin.size(),
             &context,
             nullptr // Qnn_ProfileHandle_t profile
         );
@@ -226,15 +904,41 @@ int main(int argc, char **argv)
         }
 
         printf("Context created from binary\n");
-        Qnn_GraphHandle_t graph;
-        err = interface->QNN_INTERFACE_VER_NAME.graphRetrieve(context, graph_name.c_str(), &graph);
-        if (err != QNN_SUCCESS)
+        bin.release();
+
+        // Every graph of the context shares this load and its weights
+        QnnGraphTable graphs;
+        if (!QnnRetrieveGraphs(interface, context, graph_infos, graphs))
+            return -1;
+        trace.add_span("load", load_begin, trace.now());
+
+        printf("%zu graph(s) retrieved from context:\n", graph_infos.size());
+        for (const QnnGraphInfo &info : graph_infos)
+            printf("  %s (%u inputs, %u outputs)\n", info.graphName, info.numGraphInputs, info.numGraphOutputs);
+
+        // --graph wins, otherwise the smallest batch bucket holding the requested rows
+        BatchBuckets buckets;
+        buckets.build(graphs);
+        std::string graph_name = options.graph_name;
+        if (graph_name.empty())
         {
-            printf("graphRetrieve failed: %lu\n", err);
+            uint32_t rows = options.rows ? options.rows : batch_size;
+            const BatchBucket *bucket = buckets.select(rows);
+            graph_name = bucket ? bucket->graph->info.graphName : graph_infos[0].graphName;
+            if (bucket)
+                printf("%u rows -> batch %u bucket\n", rows, bucket->batch);
+        }
+
+        auto graph_iter = graphs.find(graph_name);
+        if (graph_iter == graphs.end())
+        {
+            printf("Graph %s not found in %s\n", graph_name.c_str(), options.context_bin.c_str());
             return -1;
         }
 
-        printf("Graph retrieved from context\n");
+        Qnn_GraphHandle_t graph = graph_iter->second.handle;
+        printf("Running graph %s\n", graph_name.c_str());
+
         QnnGraph_Property_t *graph_property = nullptr;
         err = interface->QNN_INTERFACE_VER_NAME.graphGetProperty(graph, &graph_property);
         if (err != QNN_SUCCESS)
@@ -244,126 +948,117 @@ int main(int argc, char **argv)
         }
 
         printf("Graph properties from graph\n");
-        void *input_data = nullptr;
-        void *output_data = nullptr;
-
-        if (USE_SHARED_BUFFER)
-        {
-            input_data = SharedBuffer::get_shared_buffer_manager().allocmem(batch_size * input_shape * sizeof(uint16_t), DEFAULT_ALIGNMENT);
-            output_data = SharedBuffer::get_shared_buffer_manager().allocmem(batch_size * output_shape * sizeof(uint16_t), DEFAULT_ALIGNMENT);
-        }
-        else
-        {
-            input_data = aligned_alloc(DEFAULT_ALIGNMENT, batch_size * input_shape * sizeof(uint16_t));
-            output_data = aligned_alloc(DEFAULT_ALIGNMENT, batch_size * output_shape * sizeof(uint16_t));
-        }
-
-        printf("Fill input data\n");
-        uint16_t *input_data_uint16 = reinterpret_cast<uint16_t *>(input_data);
-        for (uint32_t i = 0; i < batch_size * input_shape; i++)
-        {
-            input_data_uint16[i] = fp32_to_fp16(1.0f);
-        }
+        MemHandleCache mem_cache(interface);
+        PooledRegistrations pooled(mem_cache);
+        IOArena io_arena;
 
         printf("Prepare input/output tensors\n");
         std::vector<Qnn_Tensor_t> inputTensors;
         std::vector<Qnn_Tensor_t> outputTensors;
-
-        if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_1)
+        bool prepared;
         {
-            printf("Using GRAPH_INFO_VERSION_1\n");
-            prepare_tensors(graph_info->graphInfoV1, inputTensors, outputTensors,
-                            interface, context, input_data, output_data);
+            TraceSpan span(trace, "register");
+            prepared = prepare_tensors(graph_iter->second.info, io_arena, inputTensors, outputTensors,
+                                   mem_cache, context);
         }
-        else if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_2)
+
+        if (!prepared)
         {
-            printf("Using GRAPH_INFO_VERSION_2\n");
-            prepare_tensors(graph_info->graphInfoV2, inputTensors, outputTensors,
-                            interface, context, input_data, output_data);
+            printf("Failed to prepare input/output tensors\n");
+            return -1;
         }
-#if (QNN_API_VERSION_MAJOR >= 2 && QNN_API_VERSION_MINOR >= 21)
-        else if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_3)
+
+        // FP32 host inputs converted straight into the registered buffers
+        StagingPool staging(options.staging_threads);
+        printf("Fill input data (%u staging threads)\n", staging.num_threads());
         {
-            printf("Using GRAPH_INFO_VERSION_3\n");
-            prepare_tensors(graph_info->graphInfoV3, inputTensors, outputTensors,
-                            interface, context, input_data, output_data);
+            TraceSpan span(trace, "fill");
+            for (uint32_t t = 0; t < inputTensors.size(); t++)
+            {
+                uint16_t *input_data_uint16 = reinterpret_cast<uint16_t *>(io_arena.input(t));
+                std::vector<float> input_data(io_arena.input_bytes(t) / sizeof(uint16_t), 1.0f);
+                stage_fp32_to_fp16(staging, input_data.data(), input_data_uint16, input_data.size());
+            }
         }
-#endif
 
         // Execute graph
-        for (uint32_t i = 0; i < num_iter; i++)
+        // FC/MatMul: [rows, K] x [K, N], FP16 weights streamed once per execute
+        const uint32_t *in_dims = qnn_tensor_dims(inputTensors[0]);
+        const uint32_t *out_dims = qnn_tensor_dims(outputTensors[0]);
+
+        BenchConfig bench_config;
+        bench_config.label = graph_name;
+        bench_config.warmup = options.warmup;
+        bench_config.iterations = options.iterations ? options.iterations : num_iter;
+        bench_config.flops = 2.0 * in_dims[0] * in_dims[1] * out_dims[1];
+        bench_config.weight_bytes = 2.0 * in_dims[1] * out_dims[1];
+        bench_config.json_path = options.json_path;
+        bench_config.csv_path = options.csv_path;
+
+        if (!run_graph_bench(interface, graph, inputTensors, outputTensors, bench_config, profile,
+                             *perf, trace, options, load_start))
+            return -1;
+
         {
-            auto start = std::chrono::high_resolution_clock::now();
-            err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
-                graph,
-                inputTensors.data(),  // input tensors
-                inputTensors.size(),  // number of inputs
-                outputTensors.data(), // output tensors
-                outputTensors.size(), // number of outputs
-                profile,              // profile
-                nullptr               // const QnnExecution_Config_t** executionConfig
-            );
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-            printf("Graph executed successfully\n");
-            printf("Graph executed in %lld ms\n", duration);
+            // Back-to-back passes, one burst keeps the vote between them
+            PerfBurst burst(*perf);
 
-            if (err != QNN_SUCCESS)
+            // Same tensors again with several requests in flight
+            if (options.async_depth > 0)
             {
-                printf("graphExecute failed: %lu\n", err);
-                return -1;
+                AsyncExecutor executor(interface, options.async_depth);
+                if (!run_async_throughput(executor, graph, inputTensors, outputTensors, num_iter))
+                    return -1;
             }
 
-            // profile
-            const QnnProfile_EventId_t *events = nullptr;
-            const QnnProfile_EventId_t *subEvents = nullptr;
-            uint32_t numEvents = 0;
-            uint32_t numSubEvents = 0;
-            err = interface->QNN_INTERFACE_VER_NAME.profileGetEvents(profile, &events, &numEvents);
+            if (options.pipeline_depth > 0 &&
+                !run_pipeline(interface, graph_iter->second, mem_cache, context, options.pipeline_depth, num_iter))
+                return -1;
 
-            if (err != QNN_SUCCESS)
-            {
-                printf("profileGetEvents failed: %lu\n", err);
+            if (options.bucket_bench && !run_bucket_bench(interface, buckets, mem_cache, context))
                 return -1;
-            }
 
-            QnnProfile_EventData_t eventData;
-            for (uint32_t i = 0; i < numEvents; i++)
-            {
-                err = interface->QNN_INTERFACE_VER_NAME.profileGetEventData(events[i], &eventData);
-                if (err != QNN_SUCCESS)
-                {
-                    printf("profileGetEventData failed: %lu\n", err);
-                    return -1;
-                }
+            if (options.shard_bench &&
+                !run_shard_bench(interface, graphs, graph, inputTensors, outputTensors, io_arena, mem_cache, context, options))
+                return -1;
 
-                export_profile_data("qnn_profile_data.txt", events[i], eventData);
-            }
+            if (options.profile_bench && !run_profile_bench(interface, backend, graph, inputTensors, outputTensors, options))
+                return -1;
         }
 
-        // Print output
-        printf("Output values:\n");
-        uint16_t *output_data_uint16 = reinterpret_cast<uint16_t *>(output_data);
-        for (uint32_t i = 0; i < batch_size * output_shape; i++)
-        {
-            printf("  [%u]: %f\n", i, fp16_to_fp32(output_data_uint16[i]));
-        }
+        if (options.perf_bench && !run_perf_bench(interface, *perf, graph, inputTensors, outputTensors, options))
+            return -1;
 
-        if (USE_SHARED_BUFFER)
+        // Rows trickle in at --rate, a request class of its own
+        if (options.serve_wait_us >= 0)
         {
-            SharedBuffer::get_shared_buffer_manager().freemem(input_data);
-            SharedBuffer::get_shared_buffer_manager().freemem(output_data);
+            PerfModeScope scope(*perf, options.serve_perf_mode);
+            PerfBurst burst(*perf);
+            if (!run_batch_server(interface, graph, inputTensors, outputTensors, io_arena,
+                                  static_cast<uint32_t>(options.serve_wait_us), options.serve_rate))
+                return -1;
         }
-        else
+
+        // Print output
+        printf("Output values:\n");
+        std::vector<float> output_data(io_arena.output_bytes(0) / sizeof(uint16_t));
+        stage_fp16_to_fp32(staging, reinterpret_cast<const uint16_t *>(io_arena.output(0)), output_data.data(), output_data.size());
+        for (uint64_t i = 0; i < output_data.size(); i++)
         {
-            free(input_data);
-            free(output_data);
+            printf("  [%lu]: %f\n", i, output_data[i]);
         }
 
-        input_data = nullptr;
-        output_data = nullptr;
+        release_tensors(mem_cache, inputTensors, outputTensors);
+
+        mem_cache.print_stats();
+
+        io_arena.release();
+
+        mem_cache.release_context(context);
+        interface->QNN_INTERFACE_VER_NAME.contextFree(context, nullptr);
     }
 
+    perf.reset();
     QnnCleanup(handle, sys_handle);
 
     return 0;
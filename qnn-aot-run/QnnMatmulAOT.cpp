@@ -7,18 +7,197 @@
 
 #include "QnnSetup.h"
 #include "QnnUtils.h"
+#include "QnnBatchBuckets.h"
+#include "QnnWeightQuant.h"
+#include "QnnWeightSource.h"
+#include "QnnContextBinary.h"
+#include "QnnShard.h"
+#include "QnnGraphConfig.h"
+#include "HTP/QnnHtpContext.h"
 
-uint32_t batch_size = 16;
 uint32_t input_shape = 4096 * 8;
 uint32_t output_shape = 4096 * 8;
 
+// One MatMul graph for `batch` rows of [in_features] -> [out_features], static weight
+// shared by name (plus the shard's `tensor_suffix`) across buckets, quantized when
+// `quant_weight` is given
+static bool build_matmul_graph(const QnnInterface_t *interface, Qnn_ContextHandle_t context,
+                               const QnnGraph_Config_t **graph_configs, const std::string &graph_name, uint32_t batch,
+                               uint32_t in_features, uint32_t out_features, const std::string &tensor_suffix,
+                               const uint16_t *weight_data, QuantizedWeight *quant_weight)
+{
+    Qnn_GraphHandle_t graph;
+    Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphCreate(context, graph_name.c_str(), graph_configs, &graph);
+    if (err != QNN_SUCCESS)
+    {
+        printf("graphCreate(%s) failed: %lu\n", graph_name.c_str(), err);
+        return false;
+    }
+
+    Qnn_Tensor_t input = QNN_TENSOR_INIT;
+    Qnn_Tensor_t weight = QNN_TENSOR_INIT;
+    Qnn_Tensor_t output = QNN_TENSOR_INIT;
+
+    uint32_t in_dims[] = {batch, in_features};
+    uint32_t w_dims[] = {in_features, out_features};
+    uint32_t out_dims[] = {batch, out_features};
+    std::string weight_name = "weight" + tensor_suffix;
+
+    input.v1.id = 1;
+    input.v1.name = "input";
+    input.v1.type = QNN_TENSOR_TYPE_APP_WRITE;
+    input.v1.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
+    input.v1.dataType = QNN_DATATYPE_FLOAT_16;
+    input.v1.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
+    input.v1.rank = 2;
+    input.v1.dimensions = in_dims;
+    input.v1.memType = QNN_TENSORMEMTYPE_RAW;
+    input.v1.clientBuf.data = nullptr;
+    input.v1.clientBuf.dataSize = 0;
+    interface->QNN_INTERFACE_VER_NAME.tensorCreateGraphTensor(graph, &input);
+
+    weight.v1.id = 2;
+    weight.v1.name = weight_name.c_str();
+    weight.v1.type = QNN_TENSOR_TYPE_STATIC;
+    weight.v1.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
+    weight.v1.dataType = QNN_DATATYPE_FLOAT_16;
+    weight.v1.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
+    weight.v1.rank = 2;
+    weight.v1.dimensions = w_dims;
+    weight.v1.memType = QNN_TENSORMEMTYPE_RAW;
+    weight.v1.clientBuf.data = const_cast<uint16_t *>(weight_data);
+    weight.v1.clientBuf.dataSize = in_features * out_features * sizeof(uint16_t);
+    if (quant_weight)
+    {
+        // W8A16/W4A16: quantized static weight against FP16 activations
+        weight.v1.dataType = quant_weight->data_type();
+        weight.v1.quantizeParams = quant_weight->quantize_params();
+        weight.v1.clientBuf.data = quant_weight->data.data();
+        weight.v1.clientBuf.dataSize = static_cast<uint32_t>(quant_weight->data.size());
+    }
+    interface->QNN_INTERFACE_VER_NAME.tensorCreateGraphTensor(graph, &weight);
+
+    output.v1.id = 3;
+    output.v1.name = "output";
+    output.v1.type = QNN_TENSOR_TYPE_APP_READ;
+    output.v1.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
+    output.v1.dataType = QNN_DATATYPE_FLOAT_16;
+    output.v1.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
+    output.v1.rank = 2;
+    output.v1.dimensions = out_dims;
+    output.v1.memType = QNN_TENSORMEMTYPE_RAW;
+    output.v1.clientBuf.data = nullptr;
+    output.v1.clientBuf.dataSize = 0;
+    interface->QNN_INTERFACE_VER_NAME.tensorCreateGraphTensor(graph, &output);
+
+    // add op
+    Qnn_Tensor_t inputs[] = {input, weight};
+
+    Qnn_OpConfig_t matmul_op = QNN_OPCONFIG_INIT;
+    matmul_op.v1.packageName = QNN_OP_PACKAGE_NAME_QTI_AISW;
+    matmul_op.v1.typeName = QNN_OP_MAT_MUL;
+    matmul_op.v1.name = "matmul";
+    matmul_op.v1.inputTensors = inputs;
+    matmul_op.v1.numOfInputs = 2;
+    matmul_op.v1.outputTensors = &output;
+    matmul_op.v1.numOfOutputs = 1;
+    matmul_op.v1.params = nullptr;
+    matmul_op.v1.numOfParams = 0;
+    interface->QNN_INTERFACE_VER_NAME.graphAddNode(graph, matmul_op);
+
+    // finalize grap
+    err = interface->QNN_INTERFACE_VER_NAME.graphFinalize(graph, nullptr, nullptr);
+    if (err != QNN_SUCCESS)
+    {
+        printf("graphFinalize(%s) failed: %lu\n", graph_name.c_str(), err);
+        return false;
+    }
+
+    printf("Graph %s finalized\n", graph_name.c_str());
+    return true;
+}
+
+// The layer split into column shards and K tiles, one graph per shard and bucket,
+// holding one shard's slice of the weight at a time
+static bool build_matmul_shards(const QnnInterface_t *interface, Qnn_ContextHandle_t context,
+                                const QnnGraph_Config_t **graph_configs,
+                                const std::vector<uint32_t> &buckets, const ShardConfig &config,
+                                const WeightQuantConfig &quant_config, const uint16_t *weight_data,
+                                uint32_t &out_col_shards, uint32_t &out_k_tiles)
+{
+    std::vector<ShardRange> cols = split_dimension(output_shape, config.col_shards);
+    std::vector<ShardRange> tiles = split_dimension(input_shape, config.k_tiles);
+    printf("Splitting matmul [%u, %u] into %zu column shard(s) x %zu K tile(s)\n",
+           input_shape, output_shape, cols.size(), tiles.size());
+    // Rounding to SHARD_ALIGN can leave fewer parts than requested, record what was built
+    out_col_shards = static_cast<uint32_t>(cols.size());
+    out_k_tiles = static_cast<uint32_t>(tiles.size());
+
+    std::vector<uint16_t> shard_weight;
+    for (uint32_t c = 0; c < cols.size(); c++)
+    {
+        for (uint32_t t = 0; t < tiles.size(); t++)
+        {
+            // MatMul weight is [K, N]: rows of the K tile, columns of the column shard
+            shard_weight.resize(static_cast<size_t>(tiles[t].size) * cols[c].size);
+            gather_columns(weight_data + static_cast<size_t>(tiles[t].offset) * output_shape, tiles[t].size, output_shape,
+                           cols[c].offset, cols[c].size, shard_weight.data());
+
+            QuantizedWeight quant_weight;
+            if (quant_config.format != WeightFormat::FP16 &&
+                !quantize_weight(shard_weight.data(), tiles[t].size, cols[c].size, 1, quant_config, quant_weight))
+                return false;
+
+            std::string suffix = shard_graph_name("", c, t);
+            for (uint32_t batch : buckets)
+                if (!build_matmul_graph(interface, context, graph_configs, shard_graph_name(batch_bucket_graph_name("matmul", batch), c, t),
+                                        batch, tiles[t].size, cols[c].size, suffix, shard_weight.data(),
+                                        quant_config.format != WeightFormat::FP16 ? &quant_weight : nullptr))
+                    return false;
+        }
+    }
+
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     printf("=======================================================\n");
     printf("Qnn Linear Compile Smoke Test\n");
     printf("=======================================================\n");
 
-    // parse_arg(argc, argv);
+    // parse_arg(argc, argv, input_shape, output_shape);
+    std::vector<uint32_t> buckets = default_batch_buckets();
+    parse_bucket_arg(argc, argv, buckets);
+    WeightQuantConfig quant_config;
+    parse_weight_quant_arg(argc, argv, quant_config);
+    WeightSourceConfig source_config;
+    parse_weight_source_arg(argc, argv, source_config);
+    ShardConfig shard_config;
+    parse_shard_arg(argc, argv, shard_config);
+    HtpGraphConfig graph_config;
+    bool sweep = false;
+    parse_graph_config_arg(argc, argv, graph_config, sweep);
+    // Context binaries only run on the HTP arch they were built for
+    uint32_t htp_arch = 73;
+    parse_arch_arg(argc, argv, htp_arch);
+    // libQnnStub.so builds binaries for host-side runs of --backend stub
+    std::string backend_lib = backend_library(BackendType::HTP);
+    parse_backend_lib_arg(argc, argv, backend_lib);
+
+    // Weights from disk set the layer shape: MatMul weight is [K, N], a
+    // PyTorch Linear checkpoint ([N, K]) needs --weight-transposed
+    WeightFile weight_file;
+    if (!source_config.path.empty())
+    {
+        if (!weight_file.open(source_config.path) ||
+            !weight_file.matrix_shape(source_config.weight_name, source_config.transposed, input_shape, output_shape))
+        {
+            printf("No 2-D tensor %s in %s\n", source_config.weight_name.c_str(), source_config.path.c_str());
+            return -1;
+        }
+        printf("MatMul shape from %s: K=%u N=%u\n", source_config.path.c_str(), input_shape, output_shape);
+    }
 
     void *handle;
     const QnnInterface_t *interface;
@@ -26,116 +205,160 @@ int main(int argc, char **argv)
     Qnn_DeviceHandle_t device;
     Qnn_BackendHandle_t backend;
     Qnn_ContextHandle_t context;
-    Qnn_GraphHandle_t graph;
 
-    QnnInit("libQnnHtp.so", nullptr, &handle, nullptr, &interface, nullptr, &logger, &device, &backend, &context, &graph);
+    // Buckets share one set of static weights inside the context
+    QnnHtpContext_CustomConfig_t weight_sharing;
+    weight_sharing.option = QNN_HTP_CONTEXT_CONFIG_OPTION_WEIGHT_SHARING_ENABLED;
+    weight_sharing.weightSharingEnabled = buckets.size() > 1;
+
+    QnnContext_Config_t context_config;
+    context_config.option = QNN_CONTEXT_CONFIG_OPTION_CUSTOM;
+    context_config.customConfig = &weight_sharing;
+    const QnnContext_Config_t *context_configs[] = {&context_config, nullptr};
+
+    QnnInit(backend_lib.c_str(), nullptr, &handle, nullptr, &interface, nullptr, &logger, &device, &backend, &context, nullptr,
+            nullptr, true, context_configs, ProfileMode::OFF, BackendType::HTP, htp_arch);
     {
-        Qnn_Tensor_t input = QNN_TENSOR_INIT;
-        Qnn_Tensor_t weight = QNN_TENSOR_INIT;
-        Qnn_Tensor_t output = QNN_TENSOR_INIT;
-
-        uint32_t in_dims[] = {batch_size, input_shape};
-        uint32_t w_dims[] = {input_shape, output_shape};
-        uint32_t out_dims[] = {batch_size, output_shape};
-
-        input.v1.id = 1;
-        input.v1.name = "input";
-        input.v1.type = QNN_TENSOR_TYPE_APP_WRITE;
-        input.v1.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
-        input.v1.dataType = QNN_DATATYPE_FLOAT_16;
-        input.v1.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
-        input.v1.rank = 2;
-        input.v1.dimensions = in_dims;
-        input.v1.memType = QNN_TENSORMEMTYPE_RAW;
-        input.v1.clientBuf.data = nullptr;
-        input.v1.clientBuf.dataSize = 0;
-        interface->QNN_INTERFACE_VER_NAME.tensorCreateGraphTensor(graph, &input);
-
-        std::vector<uint16_t> weight_data(output_shape * input_shape, fp32_to_fp16(1.0f)); // FP16 = 1.0
-        weight.v1.id = 2;
-        weight.v1.name = "weight";
-        weight.v1.type = QNN_TENSOR_TYPE_STATIC;
-        weight.v1.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
-        weight.v1.dataType = QNN_DATATYPE_FLOAT_16;
-        weight.v1.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
-        weight.v1.rank = 2;
-        weight.v1.dimensions = w_dims;
-        weight.v1.memType = QNN_TENSORMEMTYPE_RAW;
-        weight.v1.clientBuf.data = weight_data.data();
-        weight.v1.clientBuf.dataSize = weight_data.size() * sizeof(uint16_t);
-        interface->QNN_INTERFACE_VER_NAME.tensorCreateGraphTensor(graph, &weight);
-
-        output.v1.id = 3;
-        output.v1.name = "output";
-        output.v1.type = QNN_TENSOR_TYPE_APP_READ;
-        output.v1.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
-        output.v1.dataType = QNN_DATATYPE_FLOAT_16;
-        output.v1.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
-        output.v1.rank = 2;
-        output.v1.dimensions = out_dims;
-        output.v1.memType = QNN_TENSORMEMTYPE_RAW;
-        output.v1.clientBuf.data = nullptr;
-        output.v1.clientBuf.dataSize = 0;
-        interface->QNN_INTERFACE_VER_NAME.tensorCreateGraphTensor(graph, &output);
-
-        // add op
-        Qnn_Tensor_t inputs[] = {input, weight};
-
-        Qnn_OpConfig_t matmul_op = QNN_OPCONFIG_INIT;
-        matmul_op.v1.packageName = QNN_OP_PACKAGE_NAME_QTI_AISW;
-        matmul_op.v1.typeName = QNN_OP_MAT_MUL;
-        matmul_op.v1.name = "matmul";
-        matmul_op.v1.inputTensors = inputs;
-        matmul_op.v1.numOfInputs = 2;
-        matmul_op.v1.outputTensors = &output;
-        matmul_op.v1.numOfOutputs = 1;
-        matmul_op.v1.params = nullptr;
-        matmul_op.v1.numOfParams = 0;
-        interface->QNN_INTERFACE_VER_NAME.graphAddNode(graph, matmul_op);
-
-        // finalize grap
-        interface->QNN_INTERFACE_VER_NAME.graphFinalize(graph, nullptr, nullptr);
-
-        // get binary size
-        uint64_t binarySize = 0;
-        Qnn_ErrorHandle_t err;
-
-        err = interface->QNN_INTERFACE_VER_NAME.contextGetBinarySize(
-            context,
-            &binarySize);
-
-        if (err != QNN_SUCCESS || binarySize == 0)
+        std::vector<uint16_t> weight_storage;
+        const uint16_t *weight_data;
+        if (!source_config.path.empty())
         {
-            printf("contextGetBinarySize failed (%lu), size=%lu\n", err, binarySize);
-            return -1;
+            weight_data = weight_file.fp16(source_config.weight_name, input_shape, output_shape,
+                                           source_config.transposed, weight_storage);
+            if (weight_data == nullptr)
+                return -1;
+        }
+        else
+        {
+            weight_storage.assign(output_shape * input_shape, fp32_to_fp16(1.0f)); // FP16 = 1.0
+            if (quant_config.random_weights)
+                fill_random_weights(weight_storage, input_shape);
+            weight_data = weight_storage.data();
         }
 
-        printf("Graph binary size: %lu bytes\n", binarySize);
-
-        // get binary
-        uint64_t writtenSize = 0;
-        std::vector<uint8_t> binary(binarySize);
+        // MatMul weight is [K, N], output channels along axis 1
+        QuantizedWeight quant_weight;
+        bool monolithic = !shard_config.sharded() || shard_config.monolithic;
+        if (monolithic && quant_config.format != WeightFormat::FP16)
+        {
+            auto quant_start = std::chrono::high_resolution_clock::now();
+            if (!quantize_weight(weight_data, input_shape, output_shape, 1, quant_config, quant_weight))
+                return -1;
+            auto quant_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - quant_start).count();
+            print_weight_quant_report(weight_data, quant_weight, quant_ms);
+        }
 
-        err = interface->QNN_INTERFACE_VER_NAME.contextGetBinary(
-            context,
-            binary.data(),
-            binarySize,
-            &writtenSize);
+        ContextMetadata metadata;
+        metadata.layer = "matmul";
+        metadata.in_features = input_shape;
+        metadata.out_features = output_shape;
+        metadata.buckets = buckets;
+        metadata.weights = weight_format_name(quant_config.format);
+        metadata.col_shards = shard_config.col_shards;
+        metadata.k_tiles = shard_config.k_tiles;
 
-        if (err != QNN_SUCCESS)
+        // One context per graph configuration, the first one comes from QnnInit
+        std::vector<HtpGraphConfig> sweep_configs = sweep ? graph_config_sweep(graph_config)
+                                                          : std::vector<HtpGraphConfig>{graph_config};
+        std::vector<std::string> sweep_bins;
+        for (size_t i = 0; i < sweep_configs.size(); i++)
         {
-            printf("contextGetBinary failed (%lu)\n", err);
-            return -1;
-        }
+            const HtpGraphConfig &config = sweep_configs[i];
+            std::string bin_path = sweep ? "MatmulHtpContext." + config.tag() + ".bin" : "MatmulHtpContext.bin";
+            printf("Graph config %s (%zu/%zu) -> %s\n", config.tag().c_str(), i + 1, sweep_configs.size(), bin_path.c_str());
+
+            Qnn_ErrorHandle_t err;
+            if (i > 0)
+            {
+                err = interface->QNN_INTERFACE_VER_NAME.contextCreate(backend, device, context_configs, &context);
+                if (err != QNN_SUCCESS)
+                {
+                    printf("contextCreate failed: %lu\n", err);
+                    return -1;
+                }
+            }
 
-        printf("Graph binary retrieved, written size: %lu bytes\n", writtenSize);
+            HtpGraphConfigList graph_configs(config);
+            if (monolithic)
+                for (uint32_t batch : buckets)
+                    if (!build_matmul_graph(interface, context, graph_configs.get(), batch_bucket_graph_name("matmul", batch), batch,
+                                            input_shape, output_shape, "", weight_data,
+                                            quant_config.format != WeightFormat::FP16 ? &quant_weight : nullptr))
+                        return -1;
 
-        FILE *fp = fopen("MatmulHtpContext.bin", "wb");
-        assert(fp != nullptr);
-        fwrite(binary.data(), 1, binarySize, fp);
-        fclose(fp);
+            if (shard_config.sharded() &&
+                !build_matmul_shards(interface, context, graph_configs.get(), buckets, shard_config, quant_config,
+                                     weight_data, metadata.col_shards, metadata.k_tiles))
+                return -1;
+            printf("Graphs finalized: RSS %lu KiB, peak %lu KiB\n", get_current_rss_kb(), get_peak_rss_kb());
 
-        printf("Complete context binary written\n");
+            // Finalized graphs own their static data, drop ours before the last binary is serialized
+            if (i + 1 == sweep_configs.size())
+            {
+                weight_file.release();
+                std::vector<uint16_t>().swap(weight_storage);
+                quant_weight = QuantizedWeight();
+                printf("Host weights released: RSS %lu KiB\n", get_current_rss_kb());
+            }
+
+            // get binary size
+            uint64_t binarySize = 0;
+
+            err = interface->QNN_INTERFACE_VER_NAME.contextGetBinarySize(
+                context,
+                &binarySize);
+
+            if (err != QNN_SUCCESS || binarySize == 0)
+            {
+                printf("contextGetBinarySize failed (%lu), size=%lu\n", err, binarySize);
+                return -1;
+            }
+
+            printf("Graph binary size: %lu bytes (%s weights)\n", binarySize, weight_format_name(quant_config.format));
+
+            // get binary, serialized straight into the mapped output file
+            uint64_t writtenSize = 0;
+            ContextBinaryWriter binary;
+            if (!binary.create(bin_path, binarySize))
+                return -1;
+
+            err = interface->QNN_INTERFACE_VER_NAME.contextGetBinary(
+                context,
+                binary.data(),
+                binarySize,
+                &writtenSize);
+
+            if (err != QNN_SUCCESS)
+            {
+                printf("contextGetBinary failed (%lu)\n", err);
+                return -1;
+            }
+
+            printf("Graph binary retrieved, written size: %lu bytes\n", writtenSize);
+
+            if (!binary.commit(writtenSize))
+                return -1;
+
+            metadata.graph_config = config;
+            if (!write_context_metadata(bin_path, metadata))
+                return -1;
+            interface->QNN_INTERFACE_VER_NAME.contextFree(context, nullptr);
+            sweep_bins.push_back(bin_path);
+
+            printf("Complete context binary written, peak RSS %lu KiB\n", get_peak_rss_kb());
+        }
+
+        // QnnRun --sweep reads this list and benchmarks every binary in it
+        if (sweep)
+        {
+            FILE *fp = fopen("MatmulHtpContext.sweep", "w");
+            if (fp == nullptr)
+                return -1;
+            for (const std::string &bin_path : sweep_bins)
+                fprintf(fp, "%s\n", bin_path.c_str());
+            fclose(fp);
+            printf("%zu configurations listed in MatmulHtpContext.sweep\n", sweep_bins.size());
+        }
     }
 
     QnnCleanup(handle, nullptr);
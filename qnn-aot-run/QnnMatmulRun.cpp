@@ -2,48 +2,71 @@
 #include <dlfcn.h>
 #include <cassert>
 #include <vector>
+#include <algorithm>
 #include <cstring>
 #include <chrono>
-#include <fstream>
+#include <memory>
 
 #include "QnnSetup.h"
 #include "QnnUtils.h"
+#include "QnnHalf.h"
+#include "QnnStagingPool.h"
+#include "QnnIOPlanner.h"
+#include "QnnContextBinary.h"
+#include "QnnAsyncExecutor.h"
+#include "QnnBatchBuckets.h"
+#include "QnnPerfMode.h"
+#include "QnnBenchmark.h"
+#include "QnnGraphBench.h"
+#include "QnnTraceWriter.h"
 
 uint32_t batch_size = 16;
 uint32_t input_shape = 4096 * 8;
 uint32_t output_shape = 4096 * 8;
 uint32_t num_iter = 10;
 
-void export_profile_data(const std::string &OutputPath,
-                         const QnnProfile_EventId_t &Event,
-                         const QnnProfile_EventData_t &EventData)
+static constexpr uint32_t IO_ALIGNMENT = 64;
+
+// Bind graph tensors to their slots of a host arena
+template <typename INFO>
+bool prepare_tensors(INFO &info, IOArena &arena,
+                     std::vector<Qnn_Tensor_t> &out_input_tensors, std::vector<Qnn_Tensor_t> &out_output_tensors)
 {
-    auto getUnit = [](QnnProfile_EventUnit_t Unit)
+    if (!arena.allocate(plan_io_buffers(info, IO_ALIGNMENT), IOMemory::HOST))
+        return false;
+
+    // clientBuf sizes are 32-bit
+    std::vector<IOTensorSlot> slots(arena.plan().inputs);
+    slots.insert(slots.end(), arena.plan().outputs.begin(), arena.plan().outputs.end());
+    for (const IOTensorSlot &slot : slots)
     {
-        switch (Unit)
+        if (slot.bytes > UINT32_MAX)
         {
-        case QNN_PROFILE_EVENTUNIT_MICROSEC:
-            return " (us)";
-        case QNN_PROFILE_EVENTUNIT_BYTES:
-            return " (bytes)";
-        case QNN_PROFILE_EVENTUNIT_COUNT:
-            return " (count)";
-        case QNN_PROFILE_EVENTUNIT_BACKEND:
-        case QNN_PROFILE_EVENTUNIT_CYCLES:
-        default:
-            return "";
+            printf("prepare_tensors: %lu bytes do not fit a client buffer\n", slot.bytes);
+            return false;
         }
-    };
+    }
 
-    FILE *file = fopen(OutputPath.c_str(), "a+");
+    out_input_tensors.resize(info.numGraphInputs);
+    out_output_tensors.resize(info.numGraphOutputs);
 
-    std::string Identifier = std::string(EventData.identifier) + " " +
-                             std::to_string(EventData.value) +
-                             getUnit(EventData.unit);
+    for (uint32_t i = 0; i < info.numGraphInputs; i++)
+    {
+        out_input_tensors[i] = info.graphInputs[i];
+        out_input_tensors[i].v2.memType = QNN_TENSORMEMTYPE_RAW;
+        out_input_tensors[i].v2.clientBuf.data = arena.input(i);
+        out_input_tensors[i].v2.clientBuf.dataSize = static_cast<uint32_t>(arena.input_bytes(i));
+    }
 
-    fprintf(file, "%s \n", Identifier.c_str());
+    for (uint32_t i = 0; i < info.numGraphOutputs; i++)
+    {
+        out_output_tensors[i] = info.graphOutputs[i];
+        out_output_tensors[i].v2.memType = QNN_TENSORMEMTYPE_RAW;
+        out_output_tensors[i].v2.clientBuf.data = arena.output(i);
+        out_output_tensors[i].v2.clientBuf.dataSize = static_cast<uint32_t>(arena.output_bytes(i));
+    }
 
-    fclose(file);
+    return true;
 }
 
 int main(int argc, char **argv)
@@ -52,7 +75,10 @@ int main(int argc, char **argv)
     printf("Qnn Linear Load Smoke Test\n");
     printf("=======================================================\n");
 
-    // parse_arg(argc, argv);
+    // parse_arg(argc, argv, input_shape, output_shape);
+    RunOptions options;
+    options.context_bin = "MatmulHtpContext.bin";
+    parse_run_arg(argc, argv, options);
 
     void *handle;
     void *sys_handle;
@@ -65,8 +91,9 @@ int main(int argc, char **argv)
     Qnn_GraphHandle_t graph;
     Qnn_ProfileHandle_t profile;
 
-    QnnInit("libQnnHtp.so",
-            "libQnnHtpSystem.so",
+    std::string backend_lib = options.backend_lib.empty() ? backend_library(options.backend) : options.backend_lib;
+    QnnInit(backend_lib.c_str(),
+            system_library(options.backend),
             &handle,
             &sys_handle,
             &interface,
@@ -74,34 +101,32 @@ int main(int argc, char **argv)
             &logger,
             &device, &backend,
             nullptr, nullptr,
-            &profile, false);
-    {
-        std::ifstream bin("MatmulHtpContext.bin", std::ios::binary | std::ios::ate);
-        assert(bin.is_open());
-
-        size_t binSize = bin.tellg();
-        bin.seekg(0);
-
-        std::vector<uint8_t> binData(binSize);
-        bin.read(reinterpret_cast<char *>(binData.data()), binSize);
-        bin.close();
-
-        printf("Loaded context binary: %zu bytes\n", binSize);
+            &profile, false, nullptr, options.profile_mode, options.backend, options.htp_arch);
 
-        uint32_t num_graph = 0;
-        QnnSystemContext_GraphInfo_t *graph_info = nullptr;
-        const QnnSystemContext_BinaryInfo_t *binary_info = nullptr;
-        QnnGetGraphInfoFromBinary(sys_interface, binData.data(), binSize, &num_graph, &graph_info, &binary_info);
+    // Voted before any context loads; dropped before the backend is unloaded
+    std::unique_ptr<PerfController> perf(new PerfController(interface, options.perf_relax_ms));
+    if (perf->available() && perf->set_mode(options.perf_mode))
+        printf("Perf mode: %s\n", perf_mode_name(options.perf_mode));
+    {
+        TraceWriter trace(!options.trace_path.empty());
+        double load_begin = trace.now();
+        auto load_start = std::chrono::high_resolution_clock::now();
+        ContextBinary bin;
+        if (!bin.load(options.context_bin, options.use_mmap))
+            return -1;
 
-        assert(num_graph);
+        QnnSystemContext sys_context;
+        std::vector<QnnGraphInfo> graph_infos;
+        if (!QnnGetGraphInfosFromBinary(sys_interface, bin.data(), bin.size(), sys_context, graph_infos))
+            return -1;
 
         Qnn_ErrorHandle_t err =
             interface->QNN_INTERFACE_VER_NAME.contextCreateFromBinary(
                 backend,
                 device,
                 nullptr,        // const QnnContext_Config_t** config
-                binData.data(), // binaryBuffer
-                (Qnn_ContextBinarySize_t)binSize,
+                bin.data(),     // binaryBuffer
+                (Qnn_ContextBinarySize_t)bin.size(),
                 &context,
                 nullptr // Qnn_ProfileHandle_t profile
             );
@@ -113,17 +138,36 @@ int main(int argc, char **argv)
         }
 
         printf("Context created from binary\n");
+        bin.release();
 
-        Qnn_GraphHandle_t graph;
+        QnnGraphTable graphs;
+        if (!QnnRetrieveGraphs(interface, context, graph_infos, graphs))
+            return -1;
+        trace.add_span("load", load_begin, trace.now());
 
-        err = interface->QNN_INTERFACE_VER_NAME.graphRetrieve(context, "NAME", &graph);
-        if (err != QNN_SUCCESS)
+        printf("%zu graph(s) retrieved from context\n", graph_infos.size());
+
+        // --graph wins, otherwise the smallest batch bucket holding the requested rows
+        BatchBuckets buckets;
+        buckets.build(graphs);
+        std::string graph_name = options.graph_name;
+        if (graph_name.empty())
         {
-            printf("graphRetrieve failed: %lu\n", err);
+            uint32_t rows = options.rows ? options.rows : batch_size;
+            const BatchBucket *bucket = buckets.select(rows);
+            graph_name = bucket ? bucket->graph->info.graphName : graph_infos[0].graphName;
+            if (bucket)
+                printf("%u rows -> batch %u bucket\n", rows, bucket->batch);
+        }
+
+        auto graph_iter = graphs.find(graph_name);
+        if (graph_iter == graphs.end())
+        {
+            printf("Graph %s not found in %s\n", graph_name.c_str(), options.context_bin.c_str());
             return -1;
         }
 
-        printf("Graph retrieved from context\n");
+        Qnn_GraphHandle_t graph = graph_iter->second.handle;
 
         QnnGraph_Property_t *graph_property = nullptr;
         err = interface->QNN_INTERFACE_VER_NAME.graphGetProperty(graph, &graph_property);
@@ -137,127 +181,71 @@ int main(int argc, char **argv)
         printf("Graph properties from grpah\n");
 
         // Prepare input/output tensors
-        std::vector<uint16_t> inputData(batch_size * input_shape, fp32_to_fp16(1.0f));
-        std::vector<uint16_t> outputData(batch_size * output_shape, fp32_to_fp16(0.0f));
-
+        IOArena io_arena;
         std::vector<Qnn_Tensor_t> inputTensors;
         std::vector<Qnn_Tensor_t> outputTensors;
-
-        if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_1)
+        bool prepared;
         {
-            inputTensors.resize(graph_info->graphInfoV1.numGraphInputs);
-            outputTensors.resize(graph_info->graphInfoV1.numGraphOutputs);
-            for (uint32_t i = 0; i < graph_info->graphInfoV1.numGraphInputs; i++)
-            {
-                inputTensors[i] = graph_info->graphInfoV1.graphInputs[i];
-            }
-            for (uint32_t i = 0; i < graph_info->graphInfoV1.numGraphOutputs; i++)
-            {
-                outputTensors[i] = graph_info->graphInfoV1.graphOutputs[i];
-            }
+            TraceSpan span(trace, "register");
+            prepared = prepare_tensors(graph_iter->second.info, io_arena, inputTensors, outputTensors);
         }
-        else if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_2)
-        {
-            inputTensors.resize(graph_info->graphInfoV2.numGraphInputs);
-            outputTensors.resize(graph_info->graphInfoV2.numGraphOutputs);
-            for (uint32_t i = 0; i < graph_info->graphInfoV2.numGraphInputs; i++)
-            {
-                inputTensors[i] = graph_info->graphInfoV2.graphInputs[i];
-            }
-            for (uint32_t i = 0; i < graph_info->graphInfoV2.numGraphOutputs; i++)
-            {
-                outputTensors[i] = graph_info->graphInfoV2.graphOutputs[i];
-            }
-        }
-#if (QNN_API_VERSION_MAJOR >= 2 && QNN_API_VERSION_MINOR >= 21)
-        else if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_3)
-        {
-            inputTensors.resize(graph_info->graphInfoV3.numGraphInputs);
-            outputTensors.resize(graph_info->graphInfoV3.numGraphOutputs);
-            for (uint32_t i = 0; i < graph_info->graphInfoV3.numGraphInputs; i++)
-            {
-                inputTensors[i] = graph_info->graphInfoV3.graphInputs[i];
-            }
-            for (uint32_t i = 0; i < graph_info->graphInfoV3.numGraphOutputs; i++)
-            {
-                outputTensors[i] = graph_info->graphInfoV3.graphOutputs[i];
-            }
-        }
-#endif
 
-        for (auto &tensor : inputTensors)
+        if (!prepared)
         {
-            tensor.version = QNN_TENSOR_VERSION_2;
-            tensor.v2.clientBuf.data = inputData.data();
-            tensor.v2.clientBuf.dataSize = (inputData.size() * sizeof(uint16_t));
+            printf("Failed to prepare input/output tensors\n");
+            return -1;
         }
 
-        for (auto &tensor : outputTensors)
+        // FP32 host inputs converted straight into the registered buffers
+        StagingPool staging(options.staging_threads);
         {
-            tensor.version = QNN_TENSOR_VERSION_2;
-            tensor.v2.clientBuf.data = outputData.data();
-            tensor.v2.clientBuf.dataSize = (outputData.size() * sizeof(uint16_t));
-        }
-
-        // Execute graph
-        for (uint32_t i = 0; i < num_iter; i++)
-        {
-            auto start = std::chrono::high_resolution_clock::now();
-            err = interface->QNN_INTERFACE_VER_NAME.graphExecute(
-                graph,
-                inputTensors.data(),  // input tensors
-                inputTensors.size(),  // number of inputs
-                outputTensors.data(), // output tensors
-                outputTensors.size(), // number of outputs
-                profile,              // profile
-                nullptr               // const QnnExecution_Config_t** executionConfig
-            );
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-            printf("Graph executed successfully\n");
-            printf("Graph executed in %lld ms\n", duration);
-
-            if (err != QNN_SUCCESS)
+            TraceSpan span(trace, "fill");
+            for (uint32_t t = 0; t < inputTensors.size(); t++)
             {
-                printf("graphExecute failed: %lu\n", err);
-                return -1;
+                uint16_t *input_data_uint16 = reinterpret_cast<uint16_t *>(io_arena.input(t));
+                std::vector<float> input_data(io_arena.input_bytes(t) / sizeof(uint16_t), 1.0f);
+                stage_fp32_to_fp16(staging, input_data.data(), input_data_uint16, input_data.size());
             }
+        }
 
-            // profile
-            const QnnProfile_EventId_t *events = nullptr;
-            const QnnProfile_EventId_t *subEvents = nullptr;
-            uint32_t numEvents = 0;
-            uint32_t numSubEvents = 0;
-            err = interface->QNN_INTERFACE_VER_NAME.profileGetEvents(profile, &events, &numEvents);
+        // Execute graph
+        // FC/MatMul: [rows, K] x [K, N], FP16 weights streamed once per execute
+        const uint32_t *in_dims = qnn_tensor_dims(inputTensors[0]);
+        const uint32_t *out_dims = qnn_tensor_dims(outputTensors[0]);
+
+        BenchConfig bench_config;
+        bench_config.label = graph_name;
+        bench_config.warmup = options.warmup;
+        bench_config.iterations = options.iterations ? options.iterations : num_iter;
+        bench_config.flops = 2.0 * in_dims[0] * in_dims[1] * out_dims[1];
+        bench_config.weight_bytes = 2.0 * in_dims[1] * out_dims[1];
+        bench_config.json_path = options.json_path;
+        bench_config.csv_path = options.csv_path;
+
+        if (!run_graph_bench(interface, graph, inputTensors, outputTensors, bench_config, profile,
+                             *perf, trace, options, load_start))
+            return -1;
 
-            if (err != QNN_SUCCESS)
-            {
-                printf("profileGetEvents failed: %lu\n", err);
+        // Same tensors again with several requests in flight
+        if (options.async_depth > 0)
+        {
+            PerfBurst burst(*perf);
+            AsyncExecutor executor(interface, options.async_depth);
+            if (!run_async_throughput(executor, graph, inputTensors, outputTensors, num_iter))
                 return -1;
-            }
-
-            QnnProfile_EventData_t eventData;
-            for (uint32_t i = 0; i < numEvents; i++)
-            {
-                err = interface->QNN_INTERFACE_VER_NAME.profileGetEventData(events[i], &eventData);
-                if (err != QNN_SUCCESS)
-                {
-                    printf("profileGetEventData failed: %lu\n", err);
-                    return -1;
-                }
-
-                export_profile_data("qnn_profile_data.txt", events[i], eventData);
-            }
         }
 
         // Print output
         printf("Output values:\n");
-        for (uint32_t i = 0; i < batch_size * output_shape; i++)
+        std::vector<float> output_data(io_arena.output_bytes(0) / sizeof(uint16_t));
+        stage_fp16_to_fp32(staging, reinterpret_cast<const uint16_t *>(io_arena.output(0)), output_data.data(), output_data.size());
+        for (uint64_t i = 0; i < output_data.size(); i++)
         {
-            printf("  [%u]: %f\n", i, fp16_to_fp32(outputData[i]));
+            printf("  [%lu]: %f\n", i, output_data[i]);
         }
     }
 
+    perf.reset();
     QnnCleanup(handle, sys_handle);
 
     return 0;
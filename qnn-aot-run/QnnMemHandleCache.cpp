@@ -0,0 +1,179 @@
+#include "QnnMemHandleCache.h"
+#include <chrono>
+#include <cstdio>
+
+bool MemHandleCache::Key::operator==(const Key &other) const
+{
+    return context == other.context && fd == other.fd && offset == other.offset &&
+           mem_type == other.mem_type && data_type == other.data_type && dims == other.dims;
+}
+
+size_t MemHandleCache::KeyHash::operator()(const Key &key) const
+{
+    auto combine = [](size_t seed, uint64_t value)
+    {
+        return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+    };
+
+    size_t seed = reinterpret_cast<uintptr_t>(key.context);
+    seed = combine(seed, static_cast<uint32_t>(key.fd));
+    seed = combine(seed, key.offset);
+    seed = combine(seed, key.mem_type);
+    seed = combine(seed, key.data_type);
+    for (uint32_t dim : key.dims)
+        seed = combine(seed, dim);
+    return seed;
+}
+
+template <typename PRED>
+void MemHandleCache::deregister_if(PRED pred)
+{
+    // Entries leave the maps under the lock; the backend call runs without it,
+    // so acquire() on other threads never waits behind memDeRegister
+    std::vector<Qnn_MemHandle_t> handles;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto iter = entries_.begin(); iter != entries_.end();)
+        {
+            if (!pred(iter->first, iter->second))
+            {
+                ++iter;
+                continue;
+            }
+
+            if (iter->second.ref_count != 0)
+                printf("Deregistering memhandle %p still referenced %u time(s)\n", iter->second.handle, iter->second.ref_count);
+
+            handles.push_back(iter->second.handle);
+            handle_to_key_.erase(iter->second.handle);
+            iter = entries_.erase(iter);
+        }
+
+        stats_.deregistrations += handles.size();
+        stats_.live_handles -= handles.size();
+    }
+
+    if (handles.empty())
+        return;
+
+    Qnn_ErrorHandle_t err = interface_->QNN_INTERFACE_VER_NAME.memDeRegister(handles.data(), handles.size());
+    if (err != QNN_SUCCESS)
+        printf("memDeRegister failed: %lu\n", err);
+}
+
+MemHandleCache::~MemHandleCache()
+{
+    deregister_if([](const Key &, const Entry &)
+                  { return true; });
+}
+
+Qnn_MemHandle_t MemHandleCache::acquire(Qnn_ContextHandle_t context, const Qnn_MemDescriptor_t &descriptor,
+                                        void *base, int32_t fd, uint64_t offset)
+{
+    Key key;
+    key.context = context;
+    key.fd = fd;
+    key.offset = offset;
+    key.mem_type = descriptor.memType;
+    key.data_type = descriptor.dataType;
+    key.dims.assign(descriptor.memShape.dimSize, descriptor.memShape.dimSize + descriptor.memShape.numDim);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = entries_.find(key);
+    if (iter != entries_.end())
+    {
+        iter->second.ref_count++;
+        stats_.hits++;
+        return iter->second.handle;
+    }
+
+    // A miss registers without the lock, so hits on other threads never wait behind memRegister
+    lock.unlock();
+
+    Qnn_MemHandle_t mem_handle = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    Qnn_ErrorHandle_t err = interface_->QNN_INTERFACE_VER_NAME.memRegister(
+        context,
+        &descriptor,
+        1,
+        &mem_handle);
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    lock.lock();
+    stats_.misses++;
+    stats_.register_ns += elapsed;
+    if (elapsed > stats_.register_ns_max)
+        stats_.register_ns_max = elapsed;
+
+    if (err != QNN_SUCCESS)
+    {
+        printf("memRegister failed: %lu\n", err);
+        stats_.failures++;
+        return nullptr;
+    }
+
+    auto inserted = entries_.insert({key, {mem_handle, base, 1}});
+    if (!inserted.second)
+    {
+        // Another thread registered the same key meanwhile: share its handle, drop ours
+        Entry &winner = inserted.first->second;
+        winner.ref_count++;
+        Qnn_MemHandle_t winner_handle = winner.handle;
+        stats_.deregistrations++;
+        lock.unlock();
+
+        err = interface_->QNN_INTERFACE_VER_NAME.memDeRegister(&mem_handle, 1);
+        if (err != QNN_SUCCESS)
+            printf("memDeRegister failed: %lu\n", err);
+        return winner_handle;
+    }
+
+    handle_to_key_.insert({mem_handle, std::move(key)});
+    stats_.live_handles++;
+    return mem_handle;
+}
+
+void MemHandleCache::release(Qnn_MemHandle_t handle)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto key_iter = handle_to_key_.find(handle);
+    if (key_iter == handle_to_key_.end())
+        return;
+
+    auto iter = entries_.find(key_iter->second);
+    if (iter != entries_.end() && iter->second.ref_count > 0)
+        iter->second.ref_count--;
+}
+
+void MemHandleCache::release_buffer(void *base)
+{
+    deregister_if([base](const Key &, const Entry &entry)
+                  { return entry.base == base; });
+}
+
+void MemHandleCache::release_context(Qnn_ContextHandle_t context)
+{
+    deregister_if([context](const Key &key, const Entry &)
+                  { return key.context == context; });
+}
+
+MemHandleCacheStats MemHandleCache::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void MemHandleCache::print_stats()
+{
+    MemHandleCacheStats stats = get_stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    printf("MemHandleCache: %lu lookups, hit rate %.1f%%, %lu registrations (avg %.1f us, max %.1f us), %lu deregistrations, %lu live\n",
+           lookups,
+           lookups ? 100.0 * stats.hits / lookups : 0.0,
+           stats.misses,
+           stats.misses ? stats.register_ns / 1e3 / stats.misses : 0.0,
+           stats.register_ns_max / 1e3,
+           stats.deregistrations,
+           stats.live_handles);
+}
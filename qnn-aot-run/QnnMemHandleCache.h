@@ -0,0 +1,80 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct MemHandleCacheStats
+{
+    uint64_t hits{0};            // acquire served from an existing registration
+    uint64_t misses{0};          // acquire had to call memRegister (a lost race is still a miss)
+    uint64_t failures{0};        // memRegister errors
+    uint64_t deregistrations{0}; // handles given back through memDeRegister
+    uint64_t register_ns{0};     // total time spent in memRegister
+    uint64_t register_ns_max{0};
+    uint64_t live_handles{0};
+};
+
+/**
+ * Cache of memRegister handles keyed by (context, fd, offset, shape, dtype).
+ * A registration stays alive while its buffer and context do: acquire/release
+ * only move the reference count, release_buffer/release_context deregister.
+ */
+class MemHandleCache
+{
+public:
+    explicit MemHandleCache(const QnnInterface_t *interface) : interface_(interface) {}
+    MemHandleCache(const MemHandleCache &) = delete;
+    MemHandleCache &operator=(const MemHandleCache &) = delete;
+    ~MemHandleCache();
+
+    // base: buffer the fd belongs to (used by release_buffer)
+    Qnn_MemHandle_t acquire(Qnn_ContextHandle_t context, const Qnn_MemDescriptor_t &descriptor,
+                            void *base, int32_t fd, uint64_t offset);
+    void release(Qnn_MemHandle_t handle);
+
+    // Deregister everything bound to a buffer; call before freeing it
+    void release_buffer(void *base);
+    // Deregister everything registered in a context; call before contextFree
+    void release_context(Qnn_ContextHandle_t context);
+
+    MemHandleCacheStats get_stats();
+    void print_stats();
+
+private:
+    struct Key
+    {
+        Qnn_ContextHandle_t context;
+        int32_t fd;
+        uint64_t offset;
+        Qnn_MemType_t mem_type;
+        Qnn_DataType_t data_type;
+        std::vector<uint32_t> dims;
+
+        bool operator==(const Key &other) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry
+    {
+        Qnn_MemHandle_t handle;
+        void *base;
+        uint32_t ref_count;
+    };
+
+    template <typename PRED>
+    void deregister_if(PRED pred);
+
+private:
+    const QnnInterface_t *interface_;
+    std::mutex mutex_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    std::unordered_map<Qnn_MemHandle_t, Key> handle_to_key_;
+    MemHandleCacheStats stats_;
+};
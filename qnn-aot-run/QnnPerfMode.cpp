@@ -0,0 +1,234 @@
+#include "QnnPerfMode.h"
+#include <cstdio>
+
+namespace
+{
+    struct PerfSettings
+    {
+        QnnHtpPerfInfrastructure_PowerMode_t power_mode;
+        uint32_t dcvs_enable;
+        uint32_t sleep_latency_us;
+        uint32_t sleep_disable;
+        QnnHtpPerfInfrastructure_VoltageCorner_t corner_min;
+        QnnHtpPerfInfrastructure_VoltageCorner_t corner_target;
+        QnnHtpPerfInfrastructure_VoltageCorner_t corner_max;
+        uint32_t rpc_control_latency_us; // 0 leaves it alone
+        uint32_t rpc_polling_us;         // 0 turns polling off
+    };
+
+    // Burst pins the clocks and busy-polls the RPC for the lowest latency, power saver lets DCVS run low
+    PerfSettings perf_settings(PerfMode mode)
+    {
+        switch (mode)
+        {
+        case PerfMode::BURST:
+            return {QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_PERFORMANCE_MODE, 0, 40, 1,
+                    DCVS_VOLTAGE_VCORNER_MAX_VOLTAGE_CORNER, DCVS_VOLTAGE_VCORNER_MAX_VOLTAGE_CORNER,
+                    DCVS_VOLTAGE_VCORNER_MAX_VOLTAGE_CORNER, 100, 9999};
+        case PerfMode::SUSTAINED:
+            return {QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_PERFORMANCE_MODE, 0, 100, 0,
+                    DCVS_VOLTAGE_VCORNER_TURBO, DCVS_VOLTAGE_VCORNER_TURBO,
+                    DCVS_VOLTAGE_VCORNER_TURBO, 100, 0};
+        case PerfMode::BALANCED:
+            return {QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_ADJUST_UP_DOWN, 1, 1000, 0,
+                    DCVS_VOLTAGE_VCORNER_NOM, DCVS_VOLTAGE_VCORNER_NOM_PLUS,
+                    DCVS_VOLTAGE_VCORNER_TURBO, 0, 0};
+        case PerfMode::POWER_SAVER:
+            return {QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_POWER_SAVER_MODE, 1, 1000, 0,
+                    DCVS_VOLTAGE_VCORNER_SVS2, DCVS_VOLTAGE_VCORNER_SVS,
+                    DCVS_VOLTAGE_VCORNER_SVS_PLUS, 0, 0};
+        case PerfMode::DEFAULT:
+            break;
+        }
+
+        // Relaxed vote: corner votes withdrawn, DCVS back in charge, sleep allowed
+        return {QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_ADJUST_UP_DOWN, 1, 1000, 0,
+                DCVS_VOLTAGE_CORNER_DISABLE, DCVS_VOLTAGE_CORNER_DISABLE,
+                DCVS_VOLTAGE_CORNER_DISABLE, 0, 0};
+    }
+}
+
+PerfController::PerfController(const QnnInterface_t *interface, uint32_t relax_after_ms,
+                               uint32_t device_id, uint32_t core_id)
+    : relax_after_(relax_after_ms)
+{
+    QnnDevice_Infrastructure_t infra = nullptr;
+    Qnn_ErrorHandle_t err = QNN_COMMON_ERROR_NOT_SUPPORTED;
+    if (interface->QNN_INTERFACE_VER_NAME.deviceGetInfrastructure)
+        err = interface->QNN_INTERFACE_VER_NAME.deviceGetInfrastructure(&infra);
+    if (err != QNN_SUCCESS || infra == nullptr)
+    {
+        printf("HTP perf infrastructure not available, perf mode ignored\n");
+        return;
+    }
+
+    auto *htp_infra = reinterpret_cast<QnnHtpDevice_Infrastructure_t *>(infra);
+    if (htp_infra->infraType != QNN_HTP_DEVICE_INFRASTRUCTURE_TYPE_PERF)
+    {
+        printf("Device infrastructure is not HTP perf, perf mode ignored\n");
+        return;
+    }
+
+    perf_ = htp_infra->perfInfra;
+    err = perf_.createPowerConfigId(device_id, core_id, &power_config_id_);
+    if (err != QNN_SUCCESS)
+    {
+        printf("createPowerConfigId failed: %lu\n", err);
+        return;
+    }
+    available_ = true;
+
+    last_activity_ = std::chrono::steady_clock::now();
+    if (relax_after_.count() > 0)
+        relax_thread_ = std::thread(&PerfController::relax_loop, this);
+}
+
+PerfController::~PerfController()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (relax_thread_.joinable())
+        relax_thread_.join();
+
+    if (!available_)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        relax_locked();
+    }
+    Qnn_ErrorHandle_t err = perf_.destroyPowerConfigId(power_config_id_);
+    if (err != QNN_SUCCESS)
+        printf("destroyPowerConfigId failed: %lu\n", err);
+}
+
+PerfMode PerfController::mode()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_;
+}
+
+bool PerfController::set_mode(PerfMode mode)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!available_ || (mode == mode_ && (voted_ || mode == PerfMode::DEFAULT)))
+    {
+        mode_ = mode;
+        return true;
+    }
+
+    mode_ = mode;
+    last_activity_ = std::chrono::steady_clock::now();
+    cv_.notify_all();
+    return mode == PerfMode::DEFAULT ? relax_locked() : vote_locked(mode);
+}
+
+void PerfController::begin_burst()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bursts_++;
+    // The idle timer may have dropped the vote since the last burst
+    if (available_ && !voted_ && mode_ != PerfMode::DEFAULT)
+        vote_locked(mode_);
+}
+
+void PerfController::end_burst()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bursts_ > 0)
+        bursts_--;
+    last_activity_ = std::chrono::steady_clock::now();
+    cv_.notify_all();
+}
+
+bool PerfController::relax()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !available_ || relax_locked();
+}
+
+PerfVoteStats PerfController::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool PerfController::vote_locked(PerfMode mode)
+{
+    PerfSettings settings = perf_settings(mode);
+
+    QnnHtpPerfInfrastructure_PowerConfig_t dcvs = {};
+    dcvs.option = QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_DCVS_V3;
+    QnnHtpPerfInfrastructure_DcvsV3_t &v3 = dcvs.dcvsV3Config;
+    v3.contextId = power_config_id_;
+    v3.setDcvsEnable = 1;
+    v3.dcvsEnable = settings.dcvs_enable;
+    v3.powerMode = settings.power_mode;
+    v3.setSleepLatency = 1;
+    v3.sleepLatency = settings.sleep_latency_us;
+    v3.setSleepDisable = 1;
+    v3.sleepDisable = settings.sleep_disable;
+    v3.setBusParams = 1;
+    v3.busVoltageCornerMin = settings.corner_min;
+    v3.busVoltageCornerTarget = settings.corner_target;
+    v3.busVoltageCornerMax = settings.corner_max;
+    v3.setCoreParams = 1;
+    v3.coreVoltageCornerMin = settings.corner_min;
+    v3.coreVoltageCornerTarget = settings.corner_target;
+    v3.coreVoltageCornerMax = settings.corner_max;
+
+    QnnHtpPerfInfrastructure_PowerConfig_t latency = {};
+    latency.option = QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_RPC_CONTROL_LATENCY;
+    latency.rpcControlLatencyConfig = settings.rpc_control_latency_us;
+
+    QnnHtpPerfInfrastructure_PowerConfig_t polling = {};
+    polling.option = QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_RPC_POLLING_TIME;
+    polling.rpcPollingTimeConfig = settings.rpc_polling_us;
+
+    // Polling is always sent so a relaxed vote stops a previous burst's busy-wait
+    const QnnHtpPerfInfrastructure_PowerConfig_t *configs[4] = {&dcvs, &polling, nullptr, nullptr};
+    if (settings.rpc_control_latency_us)
+        configs[2] = &latency;
+
+    Qnn_ErrorHandle_t err = perf_.setPowerConfig(power_config_id_, configs);
+    if (err != QNN_SUCCESS)
+    {
+        printf("setPowerConfig(%s) failed: %lu\n", perf_mode_name(mode), err);
+        stats_.failed++;
+        return false;
+    }
+
+    if (mode == PerfMode::DEFAULT)
+        stats_.relaxes++;
+    else
+        stats_.votes++;
+    voted_ = mode != PerfMode::DEFAULT;
+    return true;
+}
+
+bool PerfController::relax_locked()
+{
+    return !voted_ || vote_locked(PerfMode::DEFAULT);
+}
+
+void PerfController::relax_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_)
+    {
+        if (!voted_ || bursts_ > 0)
+        {
+            cv_.wait(lock);
+            continue;
+        }
+
+        auto deadline = last_activity_ + relax_after_;
+        if (std::chrono::steady_clock::now() >= deadline)
+            relax_locked();
+        else
+            cv_.wait_until(lock, deadline);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include "HTP/QnnHtpDevice.h"
+#include "HTP/QnnHtpPerfInfrastructure.h"
+#include "QnnUtils.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+struct PerfVoteStats
+{
+    uint64_t votes;   // mode votes sent to the HTP
+    uint64_t relaxes; // votes handing the clocks back to DCVS
+    uint64_t failed;
+};
+
+/**
+ * HTP power votes (DCVS V3 plus RPC control latency/polling) through the
+ * device perf infrastructure.
+ *
+ * set_mode() votes right away, so the runner applies it after device
+ * creation and the first executions already run at the voted clocks.
+ * Executions are wrapped in PerfBurst: a burst re-votes the mode when the
+ * vote was dropped, and with `relax_after_ms` a background thread hands
+ * the clocks back to DCVS once no burst ran for that long.
+ *
+ * Backends without the HTP perf infrastructure (CPU, simulators) leave the
+ * controller unavailable and every call is a no-op.
+ */
+class PerfController
+{
+public:
+    PerfController(const QnnInterface_t *interface, uint32_t relax_after_ms = 0,
+                   uint32_t device_id = 0, uint32_t core_id = 0);
+    PerfController(const PerfController &) = delete;
+    PerfController &operator=(const PerfController &) = delete;
+    // Drops the vote and destroys the power config id; must run before the backend is unloaded
+    ~PerfController();
+
+    bool available() const { return available_; }
+    PerfMode mode();
+    // Votes `mode` now (DEFAULT drops the vote), false when the vote failed
+    bool set_mode(PerfMode mode);
+
+    void begin_burst();
+    void end_burst();
+    // Hand the clocks back to DCVS until the next burst
+    bool relax();
+
+    PerfVoteStats get_stats();
+
+private:
+    bool vote_locked(PerfMode mode);
+    bool relax_locked();
+    void relax_loop();
+
+    QnnHtpDevice_PerfInfrastructure_t perf_{};
+    uint32_t power_config_id_{0};
+    bool available_{false};
+    std::chrono::milliseconds relax_after_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread relax_thread_;
+    bool stop_{false};
+    PerfMode mode_{PerfMode::DEFAULT};
+    bool voted_{false};
+    uint32_t bursts_{0};
+    std::chrono::steady_clock::time_point last_activity_;
+    PerfVoteStats stats_{};
+};
+
+// Keeps the mode voted for a burst of executions
+class PerfBurst
+{
+public:
+    explicit PerfBurst(PerfController &controller) : controller_(controller) { controller_.begin_burst(); }
+    ~PerfBurst() { controller_.end_burst(); }
+    PerfBurst(const PerfBurst &) = delete;
+    PerfBurst &operator=(const PerfBurst &) = delete;
+
+private:
+    PerfController &controller_;
+};
+
+// Switches the mode for one class of requests and restores the previous one
+class PerfModeScope
+{
+public:
+    PerfModeScope(PerfController &controller, PerfMode mode)
+        : controller_(controller), previous_(controller.mode())
+    {
+        controller_.set_mode(mode);
+    }
+    ~PerfModeScope() { controller_.set_mode(previous_); }
+    PerfModeScope(const PerfModeScope &) = delete;
+    PerfModeScope &operator=(const PerfModeScope &) = delete;
+
+private:
+    PerfController &controller_;
+    PerfMode previous_;
+};
@@ -0,0 +1,240 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "QnnPerfMode.h"
+
+// PerfController against a stub HTP perf infrastructure that records every
+// setPowerConfig call. Walks through device creation, per request class
+// mode switches, bursts longer than the idle timeout, the idle relax and
+// the re-vote of the next burst, then prints the recorded votes and the
+// cost of a burst that needs no vote. Latency per mode needs the real HTP,
+// see --perf-bench of the runner.
+
+static uint32_t relax_ms = 50;
+static uint32_t num_iters = 1000000;
+
+static void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--relax") && i + 1 < argc)
+            relax_ms = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc)
+            num_iters = static_cast<uint32_t>(atoi(argv[++i]));
+    }
+}
+
+struct RecordedVote
+{
+    double ms;
+    uint32_t dcvs_enable;
+    QnnHtpPerfInfrastructure_PowerMode_t power_mode;
+    uint32_t sleep_disable;
+    QnnHtpPerfInfrastructure_VoltageCorner_t corner_target;
+    int64_t rpc_latency_us; // -1 when not sent
+    int64_t rpc_polling_us;
+};
+
+namespace
+{
+    std::mutex g_mutex;
+    std::vector<RecordedVote> g_votes;
+    uint32_t g_created = 0;
+    uint32_t g_destroyed = 0;
+    bool g_available = true;
+    auto g_start = std::chrono::steady_clock::now();
+
+    Qnn_ErrorHandle_t stub_create_power_config_id(uint32_t, uint32_t, uint32_t *id)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        *id = ++g_created;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_destroy_power_config_id(uint32_t)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_destroyed++;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_set_power_config(uint32_t, const QnnHtpPerfInfrastructure_PowerConfig_t **configs)
+    {
+        RecordedVote vote = {};
+        vote.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_start).count();
+        vote.rpc_latency_us = -1;
+        vote.rpc_polling_us = -1;
+        for (; *configs; configs++)
+        {
+            const QnnHtpPerfInfrastructure_PowerConfig_t &config = **configs;
+            if (config.option == QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_DCVS_V3)
+            {
+                vote.dcvs_enable = config.dcvsV3Config.dcvsEnable;
+                vote.power_mode = config.dcvsV3Config.powerMode;
+                vote.sleep_disable = config.dcvsV3Config.sleepDisable;
+                vote.corner_target = config.dcvsV3Config.coreVoltageCornerTarget;
+            }
+            else if (config.option == QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_RPC_CONTROL_LATENCY)
+                vote.rpc_latency_us = config.rpcControlLatencyConfig;
+            else if (config.option == QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_RPC_POLLING_TIME)
+                vote.rpc_polling_us = config.rpcPollingTimeConfig;
+        }
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_votes.push_back(vote);
+        return QNN_SUCCESS;
+    }
+
+    QnnHtpDevice_Infrastructure_t g_infra;
+
+    Qnn_ErrorHandle_t stub_device_get_infrastructure(const QnnDevice_Infrastructure_t *infra)
+    {
+        if (!g_available)
+            return QNN_COMMON_ERROR_NOT_SUPPORTED;
+        *const_cast<QnnDevice_Infrastructure_t *>(infra) = reinterpret_cast<QnnDevice_Infrastructure_t>(&g_infra);
+        return QNN_SUCCESS;
+    }
+
+    size_t vote_count()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        return g_votes.size();
+    }
+
+    RecordedVote last_vote()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        return g_votes.empty() ? RecordedVote{} : g_votes.back();
+    }
+}
+
+static bool check(bool ok, const char *what)
+{
+    printf("  %-56s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static const char *power_mode_name(QnnHtpPerfInfrastructure_PowerMode_t mode)
+{
+    switch (mode)
+    {
+    case QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_ADJUST_UP_DOWN:
+        return "adjust-up-down";
+    case QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_ADJUST_ONLY_UP:
+        return "adjust-only-up";
+    case QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_POWER_SAVER_MODE:
+        return "power-saver";
+    case QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_POWER_SAVER_AGGRESSIVE_MODE:
+        return "power-saver-aggr";
+    case QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_PERFORMANCE_MODE:
+        return "performance";
+    }
+    return "?";
+}
+
+static bool is_mode_vote(const RecordedVote &vote, PerfMode mode)
+{
+    switch (mode)
+    {
+    case PerfMode::BURST:
+        return !vote.dcvs_enable && vote.sleep_disable && vote.rpc_polling_us > 0 &&
+               vote.corner_target == DCVS_VOLTAGE_VCORNER_MAX_VOLTAGE_CORNER;
+    case PerfMode::SUSTAINED:
+        return !vote.dcvs_enable && vote.rpc_polling_us == 0 && vote.corner_target == DCVS_VOLTAGE_VCORNER_TURBO;
+    case PerfMode::BALANCED:
+        return vote.dcvs_enable && vote.corner_target == DCVS_VOLTAGE_VCORNER_NOM_PLUS;
+    case PerfMode::POWER_SAVER:
+        return vote.dcvs_enable && vote.power_mode == QNN_HTP_PERF_INFRASTRUCTURE_POWERMODE_POWER_SAVER_MODE &&
+               vote.corner_target == DCVS_VOLTAGE_VCORNER_SVS;
+    case PerfMode::DEFAULT:
+        break;
+    }
+    // Relaxed: DCVS on, corner votes withdrawn, no polling
+    return vote.dcvs_enable && !vote.sleep_disable && vote.rpc_polling_us == 0 &&
+           vote.corner_target == DCVS_VOLTAGE_CORNER_DISABLE;
+}
+
+int main(int argc, char **argv)
+{
+    parse_bench_arg(argc, argv);
+
+    g_infra.infraType = QNN_HTP_DEVICE_INFRASTRUCTURE_TYPE_PERF;
+    g_infra.perfInfra.createPowerConfigId = stub_create_power_config_id;
+    g_infra.perfInfra.destroyPowerConfigId = stub_destroy_power_config_id;
+    g_infra.perfInfra.setPowerConfig = stub_set_power_config;
+
+    QnnInterface_t interface = {};
+    interface.QNN_INTERFACE_VER_NAME.deviceGetInfrastructure = stub_device_get_infrastructure;
+
+    printf("=======================================================\n");
+    printf("HTP perf votes against a recording stub, relax after %u ms\n", relax_ms);
+    printf("=======================================================\n");
+
+    bool ok = true;
+    {
+        PerfController perf(&interface, relax_ms);
+        ok &= check(perf.available() && g_created == 1, "power config id created with the device");
+
+        ok &= check(perf.set_mode(PerfMode::BURST) && vote_count() == 1 && is_mode_vote(last_vote(), PerfMode::BURST),
+                    "burst voted at device creation");
+        perf.set_mode(PerfMode::BURST);
+        ok &= check(vote_count() == 1, "same mode again sends nothing");
+
+        {
+            PerfModeScope scope(perf, PerfMode::POWER_SAVER);
+            ok &= check(vote_count() == 2 && is_mode_vote(last_vote(), PerfMode::POWER_SAVER),
+                        "request class switches to power saver");
+        }
+        ok &= check(vote_count() == 3 && is_mode_vote(last_vote(), PerfMode::BURST), "and back to burst after it");
+
+        {
+            PerfBurst burst(perf);
+            std::this_thread::sleep_for(std::chrono::milliseconds(relax_ms * 3));
+        }
+        ok &= check(vote_count() == 3, "no relax while a burst runs past the timeout");
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(relax_ms * 3));
+        ok &= check(vote_count() == 4 && is_mode_vote(last_vote(), PerfMode::DEFAULT), "idle device relaxed to DCVS");
+
+        {
+            PerfBurst burst(perf);
+            ok &= check(vote_count() == 5 && is_mode_vote(last_vote(), PerfMode::BURST), "next burst votes again first");
+        }
+
+        perf.set_mode(PerfMode::SUSTAINED);
+        ok &= check(vote_count() == 6 && is_mode_vote(last_vote(), PerfMode::SUSTAINED) && last_vote().rpc_latency_us == 100,
+                    "sustained keeps RPC latency, drops polling");
+        perf.set_mode(PerfMode::BALANCED);
+        ok &= check(vote_count() == 7 && is_mode_vote(last_vote(), PerfMode::BALANCED), "balanced leaves DCVS on");
+
+        // Cost of the burst guard on every execute once the vote is in place
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < num_iters; i++)
+            PerfBurst burst(perf);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        ok &= check(vote_count() == 7, "voted bursts send nothing");
+        printf("  burst without a vote: %.1f ns\n", ns / num_iters);
+    }
+    ok &= check(g_destroyed == 1 && vote_count() == 8 && is_mode_vote(last_vote(), PerfMode::DEFAULT),
+                "vote dropped and id destroyed with the controller");
+
+    g_available = false;
+    {
+        PerfController perf(&interface, relax_ms);
+        ok &= check(!perf.available() && perf.set_mode(PerfMode::BURST) && vote_count() == 8,
+                    "backend without perf infrastructure is a no-op");
+    }
+
+    printf("Recorded votes:\n");
+    printf("  %10s %6s %-18s %7s %8s %12s %12s\n", "ms", "dcvs", "power mode", "sleep", "corner", "rpc latency", "rpc polling");
+    for (const RecordedVote &vote : g_votes)
+        printf("  %10.1f %6u %-18s %7s %8x %12ld %12ld\n", vote.ms, vote.dcvs_enable, power_mode_name(vote.power_mode),
+               vote.sleep_disable ? "off" : "on", vote.corner_target, vote.rpc_latency_us, vote.rpc_polling_us);
+
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,169 @@
+#include "QnnProfileCollector.h"
+#include <algorithm>
+
+const char *profile_unit_name(QnnProfile_EventUnit_t unit)
+{
+    switch (unit)
+    {
+    case QNN_PROFILE_EVENTUNIT_MICROSEC:
+        return "us";
+    case QNN_PROFILE_EVENTUNIT_BYTES:
+        return "bytes";
+    case QNN_PROFILE_EVENTUNIT_CYCLES:
+        return "cycles";
+    case QNN_PROFILE_EVENTUNIT_COUNT:
+        return "count";
+    case QNN_PROFILE_EVENTUNIT_BACKEND:
+    default:
+        return "";
+    }
+}
+
+void ProfileCollector::record(const std::string &path, const char *identifier, uint32_t depth,
+                              QnnProfile_EventUnit_t unit, uint64_t value)
+{
+    auto iter = index_.find(path);
+    if (iter == index_.end())
+    {
+        index_.insert({path, events_.size()});
+        events_.push_back({path, identifier, depth, unit, 1, value, value, value});
+        return;
+    }
+
+    ProfileEventStats &stats = events_[iter->second];
+    stats.count++;
+    stats.total += value;
+    stats.min = std::min(stats.min, value);
+    stats.max = std::max(stats.max, value);
+}
+
+bool ProfileCollector::walk(QnnProfile_EventId_t event, const std::string &parent, uint32_t depth)
+{
+    QnnProfile_EventData_t data;
+    Qnn_ErrorHandle_t err = interface_->QNN_INTERFACE_VER_NAME.profileGetEventData(event, &data);
+    if (err != QNN_SUCCESS)
+    {
+        printf("profileGetEventData failed: %lu\n", err);
+        return false;
+    }
+
+    const char *identifier = data.identifier ? data.identifier : "(unnamed)";
+    std::string path = parent.empty() ? identifier : parent + "/" + identifier;
+    record(path, identifier, depth, data.unit, data.value);
+
+    const QnnProfile_EventId_t *sub_events = nullptr;
+    uint32_t num_sub_events = 0;
+    err = interface_->QNN_INTERFACE_VER_NAME.profileGetSubEvents(event, &sub_events, &num_sub_events);
+    if (err != QNN_SUCCESS)
+    {
+        printf("profileGetSubEvents failed: %lu\n", err);
+        return false;
+    }
+
+    if (num_sub_events)
+        parents_.insert(path);
+
+    for (uint32_t i = 0; i < num_sub_events; i++)
+        if (!walk(sub_events[i], path, depth + 1))
+            return false;
+
+    return true;
+}
+
+bool ProfileCollector::collect(uint64_t execution)
+{
+    last_events_.clear();
+    if (handle(execution) == nullptr)
+        return true;
+
+    const QnnProfile_EventId_t *events = nullptr;
+    uint32_t num_events = 0;
+    Qnn_ErrorHandle_t err = interface_->QNN_INTERFACE_VER_NAME.profileGetEvents(profile_, &events, &num_events);
+    if (err != QNN_SUCCESS)
+    {
+        printf("profileGetEvents failed: %lu\n", err);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < num_events; i++)
+    {
+        if (!seen_.insert(events[i]).second)
+            continue;
+        if (!walk(events[i], "", 0))
+            return false;
+        last_events_.push_back(events[i]);
+    }
+
+    collections_++;
+    return true;
+}
+
+void ProfileCollector::reset()
+{
+    events_.clear();
+    index_.clear();
+    seen_.clear();
+    parents_.clear();
+    last_events_.clear();
+    collections_ = 0;
+}
+
+void ProfileCollector::print_summary(FILE *file, uint32_t hotspots) const
+{
+    if (profile_ == nullptr)
+    {
+        fprintf(file, "Profile summary: profiling off\n");
+        return;
+    }
+
+    fprintf(file, "Profile summary (%u collections, %zu event paths)\n", collections_, events_.size());
+    fprintf(file, "%-48s %8s %14s %12s %12s %12s %7s\n", "event", "count", "total", "mean", "min", "max", "unit");
+
+    for (const ProfileEventStats &stats : events_)
+    {
+        std::string name = std::string(stats.depth * 2, ' ') + stats.identifier;
+        fprintf(file, "%-48s %8lu %14lu %12.1f %12lu %12lu %7s\n",
+                name.c_str(), stats.count, stats.total,
+                static_cast<double>(stats.total) / stats.count,
+                stats.min, stats.max, profile_unit_name(stats.unit));
+    }
+
+    // Hotspots among leaves only, parents already include their children
+    std::vector<const ProfileEventStats *> leaves;
+    for (const ProfileEventStats &stats : events_)
+        if (stats.depth > 0 && parents_.count(stats.path) == 0)
+            leaves.push_back(&stats);
+    if (leaves.empty() || hotspots == 0)
+        return;
+
+    std::sort(leaves.begin(), leaves.end(), [](const ProfileEventStats *a, const ProfileEventStats *b)
+              { return a->total > b->total; });
+
+    // Share within the same unit, cycles and microseconds do not add up
+    fprintf(file, "Top %u leaf events by total\n", std::min<uint32_t>(hotspots, leaves.size()));
+    for (uint32_t i = 0; i < leaves.size() && i < hotspots; i++)
+    {
+        uint64_t unit_total = 0;
+        for (const ProfileEventStats *leaf : leaves)
+            if (leaf->unit == leaves[i]->unit)
+                unit_total += leaf->total;
+
+        fprintf(file, "  %2u. %-60s %14lu %7s %6.1f%%\n", i + 1, leaves[i]->path.c_str(), leaves[i]->total,
+                profile_unit_name(leaves[i]->unit),
+                unit_total ? 100.0 * leaves[i]->total / unit_total : 0.0);
+    }
+}
+
+bool ProfileCollector::write_summary(const std::string &path) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    print_summary(file);
+    fclose(file);
+    return true;
+}
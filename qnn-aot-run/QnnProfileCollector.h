@@ -0,0 +1,76 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Aggregate of one profile event path across iterations
+struct ProfileEventStats
+{
+    std::string path;       // parent identifiers joined with '/'
+    std::string identifier; // leaf identifier
+    uint32_t depth;
+    QnnProfile_EventUnit_t unit;
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+const char *profile_unit_name(QnnProfile_EventUnit_t unit);
+
+/**
+ * Walks the events of a profile handle, sub-events included, after each
+ * execution and keeps per-event statistics in memory. Events are keyed by
+ * their identifier path, so the same op under different parents stays
+ * separate and the table keeps the op hierarchy.
+ *
+ * Event ids already collected are skipped, so calling collect() after every
+ * execute counts each event once whether the backend returns only the latest
+ * execution or everything recorded on the handle.
+ */
+class ProfileCollector
+{
+public:
+    // `sample_every` N profiles execution 0, N, 2N, ... and leaves the rest unprofiled
+    ProfileCollector(const QnnInterface_t *interface, Qnn_ProfileHandle_t profile, uint32_t sample_every = 1)
+        : interface_(interface), profile_(profile), sample_every_(sample_every ? sample_every : 1) {}
+
+    // Handle to pass to graphExecute for this execution, nullptr when not sampled
+    Qnn_ProfileHandle_t handle(uint64_t execution) const
+    {
+        return execution % sample_every_ == 0 ? profile_ : nullptr;
+    }
+
+    // Nothing to do for executions that ran without a handle
+    bool collect(uint64_t execution);
+    void reset();
+
+    // Events in first-seen (tree) order
+    const std::vector<ProfileEventStats> &events() const { return events_; }
+    // Top-level event ids new in the last collect()
+    const std::vector<QnnProfile_EventId_t> &last_events() const { return last_events_; }
+
+    // Tree table followed by the top `hotspots` leaf events by total
+    void print_summary(FILE *file = stdout, uint32_t hotspots = 10) const;
+    bool write_summary(const std::string &path) const;
+
+private:
+    bool walk(QnnProfile_EventId_t event, const std::string &parent, uint32_t depth);
+    void record(const std::string &path, const char *identifier, uint32_t depth,
+                QnnProfile_EventUnit_t unit, uint64_t value);
+
+    const QnnInterface_t *interface_;
+    Qnn_ProfileHandle_t profile_;
+    uint32_t sample_every_;
+    std::vector<ProfileEventStats> events_;
+    std::unordered_map<std::string, size_t> index_;
+    std::unordered_set<QnnProfile_EventId_t> seen_;
+    std::unordered_set<std::string> parents_;
+    std::vector<QnnProfile_EventId_t> last_events_;
+    uint32_t collections_{0};
+};
@@ -26,7 +26,11 @@ void QnnInit(const char *backend_path,
              Qnn_ContextHandle_t *out_context,
              Qnn_GraphHandle_t *out_graph,
              Qnn_ProfileHandle_t *out_profile,
-             bool is_aot)
+             bool is_aot,
+             const QnnContext_Config_t **context_config,
+             ProfileMode profile_mode,
+             BackendType backend_type,
+             uint32_t htp_arch)
 {
     void *handle = dlopen(backend_path, RTLD_NOW | RTLD_LOCAL);
 
@@ -96,13 +100,16 @@ void QnnInit(const char *backend_path,
     std::vector<const QnnDevice_Config_t *> result_config;
     std::vector<QnnDevice_Config_t> device_configs;
     std::vector<QnnDevice_CustomConfig_t> custom_device_configs = {};
-    QnnHtpDevice_CustomConfig_t *htp_config = nullptr;
 
-    htp_config = new QnnHtpDevice_CustomConfig_t;
-    htp_config->option = QNN_HTP_DEVICE_CONFIG_OPTION_ARCH;
-    htp_config->arch.deviceId = 0;
-    htp_config->arch.arch = QNN_HTP_DEVICE_ARCH_V73;
-    custom_device_configs.push_back(static_cast<QnnDevice_CustomConfig_t>(htp_config));
+    // deviceCreate copies the configs, so they only have to outlive the call
+    QnnHtpDevice_CustomConfig_t htp_config = {};
+    if (backend_type != BackendType::CPU && htp_arch != QNN_HTP_DEVICE_ARCH_NONE)
+    {
+        htp_config.option = QNN_HTP_DEVICE_CONFIG_OPTION_ARCH;
+        htp_config.arch.deviceId = 0;
+        htp_config.arch.arch = static_cast<QnnHtpDevice_Arch_t>(htp_arch);
+        custom_device_configs.push_back(static_cast<QnnDevice_CustomConfig_t>(&htp_config));
+    }
 
     device_configs.resize(custom_device_configs.size());
     for (size_t i = 0; i < custom_device_configs.size(); i++)
@@ -114,8 +121,16 @@ void QnnInit(const char *backend_path,
 
     result_config.push_back(nullptr);
 
+    printf("Backend %s (%s), HTP arch %u\n", backend_type_name(backend_type), backend_path, htp_arch);
+
     Qnn_DeviceHandle_t device = nullptr;
-    if (selected->QNN_INTERFACE_VER_NAME.deviceCreate(logger, result_config.data(), &device) != QNN_SUCCESS)
+    Qnn_ErrorHandle_t device_property =
+        selected->QNN_INTERFACE_VER_NAME.propertyHasCapability(QNN_PROPERTY_GROUP_DEVICE);
+    if (device_property == QNN_PROPERTY_NOT_SUPPORTED || device_property == QNN_PROPERTY_ERROR_UNKNOWN_KEY)
+    {
+        printf("Backend has no device API, running without a device\n");
+    }
+    else if (selected->QNN_INTERFACE_VER_NAME.deviceCreate(logger, result_config.data(), &device) != QNN_SUCCESS)
     {
         dlclose(handle);
         printf("error: QNN returned error\n");
@@ -124,18 +139,11 @@ void QnnInit(const char *backend_path,
     if (is_aot)
     {
         // create context
-        const QnnContext_Config_t *context_config = nullptr;
+        const QnnContext_Config_t *empty_context_config = nullptr;
         Qnn_ContextHandle_t context;
-        if (selected->QNN_INTERFACE_VER_NAME.contextCreate(backend, device, &context_config, &context) != QNN_SUCCESS)
-        {
-            dlclose(handle);
-            printf("error: QNN returned error\n");
-        }
-
-        // compose graph
-        const QnnGraph_Config_t *graph_config = nullptr;
-        Qnn_GraphHandle_t graph;
-        if (selected->QNN_INTERFACE_VER_NAME.graphCreate(context, "NAME", &graph_config, &graph) != QNN_SUCCESS)
+        if (selected->QNN_INTERFACE_VER_NAME.contextCreate(backend, device,
+                                                           context_config ? context_config : &empty_context_config,
+                                                           &context) != QNN_SUCCESS)
         {
             dlclose(handle);
             printf("error: QNN returned error\n");
@@ -143,7 +151,20 @@ void QnnInit(const char *backend_path,
 
         // Runner 의 경우 외부에서 생성함
         *out_context = context;
-        *out_graph = graph;
+
+        // compose graph, callers building several graphs create their own
+        if (out_graph)
+        {
+            const QnnGraph_Config_t *graph_config = nullptr;
+            Qnn_GraphHandle_t graph;
+            if (selected->QNN_INTERFACE_VER_NAME.graphCreate(context, "NAME", &graph_config, &graph) != QNN_SUCCESS)
+            {
+                dlclose(handle);
+                printf("error: QNN returned error\n");
+            }
+
+            *out_graph = graph;
+        }
         ////
     }
     else
@@ -175,30 +196,11 @@ void QnnInit(const char *backend_path,
         const QnnSystemInterface_t *sys_selected = nullptr;
         sys_selected = sys_providers[0];
 
-        Qnn_ProfileHandle_t profile;
-        QnnProfile_Level_t profileLevel = QNN_PROFILE_LEVEL_DETAILED;
-        if (selected->QNN_INTERFACE_VER_NAME.profileCreate(backend, profileLevel, &profile) != QNN_SUCCESS)
-        {
-            dlclose(handle);
-            printf("error: QNN returned error\n");
-        }
-
-        QnnProfile_Config_t profileConfig = QNN_PROFILE_CONFIG_INIT;
-        profileConfig.option = QNN_PROFILE_CONFIG_OPTION_ENABLE_OPTRACE;
-
-        std::array<const QnnProfile_Config_t *, 2> profileConfigs = {&profileConfig, nullptr};
-
-        if (selected->QNN_INTERFACE_VER_NAME.profileSetConfig(profile, profileConfigs.data()) != QNN_SUCCESS)
-        {
-            dlclose(handle);
-            printf("error: QNN returned error\n");
-        }
-
         *out_sys_handle = sys_handle;
         *out_sys_interface = sys_selected;
 
         // AOT 가 아닐 경우 profile 옵션 활설화
-        *out_profile = profile;
+        *out_profile = QnnCreateProfile(selected, backend, profile_mode);
     }
 
     *out_handle = handle;
@@ -208,31 +210,110 @@ void QnnInit(const char *backend_path,
     *out_backend = backend;
 }
 
-void QnnGetGraphInfoFromBinary(const QnnSystemInterface_t *sys_interface,
-                               void *buffer,
-                               uint32_t n_bytes,
-                               uint32_t *out_num_graphs,
-                               QnnSystemContext_GraphInfo_t **out_graph,
-                               const QnnSystemContext_BinaryInfo_t **out_binary_info,
-                               std::string &out_graph_name)
+Qnn_ProfileHandle_t QnnCreateProfile(const QnnInterface_t *interface,
+                                     Qnn_BackendHandle_t backend,
+                                     ProfileMode mode)
 {
-    QnnSystemContext_Handle_t sys_context_handle = nullptr;
-    Qnn_ErrorHandle_t error = sys_interface->QNN_SYSTEM_INTERFACE_VER_NAME.systemContextCreate(&sys_context_handle);
+    if (mode == ProfileMode::OFF)
+        return nullptr;
+
+    QnnProfile_Level_t level = mode == ProfileMode::BASIC ? QNN_PROFILE_LEVEL_BASIC : QNN_PROFILE_LEVEL_DETAILED;
+    Qnn_ProfileHandle_t profile = nullptr;
+    Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.profileCreate(backend, level, &profile);
+    if (err != QNN_SUCCESS)
+    {
+        printf("profileCreate failed: %lu\n", err);
+        return nullptr;
+    }
+
+    // Op trace only for the detailed levels, it is what perturbs latency most
+    if (mode == ProfileMode::BASIC)
+        return profile;
+
+    QnnProfile_Config_t profileConfig = QNN_PROFILE_CONFIG_INIT;
+    profileConfig.option = QNN_PROFILE_CONFIG_OPTION_ENABLE_OPTRACE;
+
+    std::array<const QnnProfile_Config_t *, 2> profileConfigs = {&profileConfig, nullptr};
+
+    err = interface->QNN_INTERFACE_VER_NAME.profileSetConfig(profile, profileConfigs.data());
+    if (err != QNN_SUCCESS)
+        printf("profileSetConfig(optrace) failed: %lu\n", err);
+
+    return profile;
+}
+
+template <typename INFO>
+static QnnGraphInfo flatten_graph_info(const INFO &info)
+{
+    return {info.graphName, info.numGraphInputs, info.graphInputs, info.numGraphOutputs, info.graphOutputs};
+}
+
+QnnSystemContext::QnnSystemContext(QnnSystemContext &&other)
+    : sys_interface_(other.sys_interface_), handle_(other.handle_)
+{
+    other.handle_ = nullptr;
+}
+
+QnnSystemContext &QnnSystemContext::operator=(QnnSystemContext &&other)
+{
+    if (this != &other)
+    {
+        reset();
+        sys_interface_ = other.sys_interface_;
+        handle_ = other.handle_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+bool QnnSystemContext::create(const QnnSystemInterface_t *sys_interface)
+{
+    reset();
+
+    Qnn_ErrorHandle_t error = sys_interface->QNN_SYSTEM_INTERFACE_VER_NAME.systemContextCreate(&handle_);
     if (error != QNN_SUCCESS)
     {
-        // Handle error
         printf("Error systemContextCreate()\n");
+        handle_ = nullptr;
+        return false;
     }
 
+    sys_interface_ = sys_interface;
+    return true;
+}
+
+void QnnSystemContext::reset()
+{
+    if (handle_ == nullptr)
+        return;
+
+    Qnn_ErrorHandle_t error = sys_interface_->QNN_SYSTEM_INTERFACE_VER_NAME.systemContextFree(handle_);
+    if (error != QNN_SUCCESS)
+        printf("systemContextFree failed: %lu\n", error);
+    handle_ = nullptr;
+}
+
+bool QnnGetGraphInfosFromBinary(const QnnSystemInterface_t *sys_interface,
+                                void *buffer,
+                                uint64_t n_bytes,
+                                QnnSystemContext &out_sys_context,
+                                std::vector<QnnGraphInfo> &out_graphs)
+{
+    out_graphs.clear();
+
+    if (!out_sys_context.create(sys_interface))
+        return false;
+
     const QnnSystemContext_BinaryInfo_t *binary_info = nullptr;
     Qnn_ContextBinarySize_t binary_info_size = 0;
 
-    error = sys_interface->QNN_SYSTEM_INTERFACE_VER_NAME.systemContextGetBinaryInfo(
-        sys_context_handle, buffer, n_bytes, &binary_info, &binary_info_size);
+    Qnn_ErrorHandle_t error = sys_interface->QNN_SYSTEM_INTERFACE_VER_NAME.systemContextGetBinaryInfo(
+        out_sys_context.handle(), buffer, n_bytes, &binary_info, &binary_info_size);
 
-    if (error != QNN_SUCCESS)
+    if (error != QNN_SUCCESS || binary_info == nullptr)
     {
         printf("Error systemContextGetBinaryInfo()\n");
+        return false;
     }
 
     uint32_t num_graphs = 0;
@@ -242,30 +323,66 @@ void QnnGetGraphInfoFromBinary(const QnnSystemInterface_t *sys_interface,
     {
         num_graphs = binary_info->contextBinaryInfoV1.numGraphs;
         graphs = binary_info->contextBinaryInfoV1.graphs;
-        out_graph_name = graphs[0].graphInfoV1.graphName;
     }
     else if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_2)
     {
         num_graphs = binary_info->contextBinaryInfoV2.numGraphs;
         graphs = binary_info->contextBinaryInfoV2.graphs;
-        out_graph_name = graphs[0].graphInfoV2.graphName;
     }
 #if (QNN_API_VERSION_MAJOR >= 2 && QNN_API_VERSION_MINOR >= 21)
     else if (binary_info->version == QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_3)
     {
         num_graphs = binary_info->contextBinaryInfoV3.numGraphs;
         graphs = binary_info->contextBinaryInfoV3.graphs;
-        out_graph_name = graphs[0].graphInfoV3.graphName;
     }
 #endif
     else
     {
-        assert(0);
+        printf("Unknown context binary info version: %d\n", binary_info->version);
+        return false;
+    }
+
+    // Each graph carries its own info version, independent of the binary info version
+    for (uint32_t i = 0; i < num_graphs; i++)
+    {
+        const QnnSystemContext_GraphInfo_t &graph = graphs[i];
+        if (graph.version == QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_1)
+            out_graphs.push_back(flatten_graph_info(graph.graphInfoV1));
+        else if (graph.version == QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_2)
+            out_graphs.push_back(flatten_graph_info(graph.graphInfoV2));
+#if (QNN_API_VERSION_MAJOR >= 2 && QNN_API_VERSION_MINOR >= 21)
+        else if (graph.version == QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_3)
+            out_graphs.push_back(flatten_graph_info(graph.graphInfoV3));
+#endif
+        else
+        {
+            printf("Unknown graph info version: %d\n", graph.version);
+            return false;
+        }
+    }
+
+    return !out_graphs.empty();
+}
+
+bool QnnRetrieveGraphs(const QnnInterface_t *interface,
+                       Qnn_ContextHandle_t context,
+                       const std::vector<QnnGraphInfo> &graphs,
+                       QnnGraphTable &out_table)
+{
+    for (const QnnGraphInfo &info : graphs)
+    {
+        Qnn_GraphHandle_t graph = nullptr;
+        Qnn_ErrorHandle_t err = interface->QNN_INTERFACE_VER_NAME.graphRetrieve(context, info.graphName, &graph);
+        if (err != QNN_SUCCESS)
+        {
+            printf("graphRetrieve(%s) failed: %lu\n", info.graphName, err);
+            return false;
+        }
+
+        out_table[info.graphName] = {info, graph};
     }
 
-    *out_binary_info = binary_info;
-    *out_num_graphs = num_graphs;
-    *out_graph = graphs;
+    return true;
 }
 
 void QnnCleanup(void *handle, void *sys_handle)
@@ -3,8 +3,17 @@
 
 #include "QnnInterface.h"
 #include "System/QnnSystemInterface.h"
+#include "QnnUtils.h"
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+/**
+ * Load the backend at `backend_path` and create its logger, backend and
+ * device. The device gets the configs of `backend_type`: the HTP and its
+ * simulator take `htp_arch` (0 leaves it to the backend), the CPU backend
+ * none. Backends without the device API run without a device (nullptr).
+ */
 void QnnInit(const char *backend_path,
              const char *system_path,
              void **out_handle,
@@ -17,15 +26,75 @@ void QnnInit(const char *backend_path,
              Qnn_ContextHandle_t *out_context = nullptr,
              Qnn_GraphHandle_t *out_graph = nullptr,
              Qnn_ProfileHandle_t *out_profile = nullptr,
-             bool is_aot = true);
-
-void QnnGetGraphInfoFromBinary(const QnnSystemInterface_t *sys_interface,
-                               void *buffer,
-                               uint32_t n_bytes,
-                               uint32_t *out_num_graphs,
-                               QnnSystemContext_GraphInfo_t **out_graph,
-                               const QnnSystemContext_BinaryInfo_t **out_binary_info,
-                               std::string &out_graph_name);
+             bool is_aot = true,
+             const QnnContext_Config_t **context_config = nullptr,
+             ProfileMode profile_mode = ProfileMode::DETAILED,
+             BackendType backend_type = BackendType::HTP,
+             uint32_t htp_arch = 73);
+
+// nullptr for ProfileMode::OFF or on failure; sampled uses a detailed profile
+Qnn_ProfileHandle_t QnnCreateProfile(const QnnInterface_t *interface,
+                                     Qnn_BackendHandle_t backend,
+                                     ProfileMode mode);
+
+/**
+ * One graph of a context binary, flattened from the V1/V2/V3 graph info.
+ * The pointers stay owned by the system context that parsed the binary.
+ */
+struct QnnGraphInfo
+{
+    const char *graphName;
+    uint32_t numGraphInputs;
+    Qnn_Tensor_t *graphInputs;
+    uint32_t numGraphOutputs;
+    Qnn_Tensor_t *graphOutputs;
+};
+
+/**
+ * Owns the system context that parsed a binary and frees it on destruction.
+ * Keep it alive while the QnnGraphInfos (and graph tables built from them)
+ * are in use, and drop it before the system library is unloaded.
+ */
+class QnnSystemContext
+{
+public:
+    QnnSystemContext() = default;
+    QnnSystemContext(const QnnSystemContext &) = delete;
+    QnnSystemContext &operator=(const QnnSystemContext &) = delete;
+    QnnSystemContext(QnnSystemContext &&other);
+    QnnSystemContext &operator=(QnnSystemContext &&other);
+    ~QnnSystemContext() { reset(); }
+
+    bool create(const QnnSystemInterface_t *sys_interface);
+    void reset();
+
+    QnnSystemContext_Handle_t handle() const { return handle_; }
+
+private:
+    const QnnSystemInterface_t *sys_interface_{nullptr};
+    QnnSystemContext_Handle_t handle_{nullptr};
+};
+
+// Every graph packed in the binary, in binary order; the infos point into out_sys_context
+bool QnnGetGraphInfosFromBinary(const QnnSystemInterface_t *sys_interface,
+                                void *buffer,
+                                uint64_t n_bytes,
+                                QnnSystemContext &out_sys_context,
+                                std::vector<QnnGraphInfo> &out_graphs);
+
+struct QnnGraph
+{
+    QnnGraphInfo info;
+    Qnn_GraphHandle_t handle;
+};
+
+// Retrieved graphs of one context, looked up by graph name
+using QnnGraphTable = std::unordered_map<std::string, QnnGraph>;
+
+bool QnnRetrieveGraphs(const QnnInterface_t *interface,
+                       Qnn_ContextHandle_t context,
+                       const std::vector<QnnGraphInfo> &graphs,
+                       QnnGraphTable &out_table);
 
 void QnnCleanup(void *handle, void *sys_handle);
 
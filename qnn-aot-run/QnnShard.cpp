@@ -0,0 +1,158 @@
+#include "QnnShard.h"
+#include "QnnHalf.h"
+#include "QnnIOPlanner.h"
+#include "QnnUtils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+// Shard sizes stay whole HVX vectors and whole quantization blocks
+static constexpr uint32_t SHARD_ALIGN = 64;
+
+void parse_shard_arg(int argc, char **argv, ShardConfig &config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--col-shards") && i + 1 < argc)
+            config.col_shards = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--k-tiles") && i + 1 < argc)
+            config.k_tiles = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--with-monolithic"))
+            config.monolithic = true;
+    }
+}
+
+std::vector<ShardRange> split_dimension(uint32_t total, uint32_t parts)
+{
+    uint32_t size = (total + parts - 1) / parts;
+    size = (size + SHARD_ALIGN - 1) / SHARD_ALIGN * SHARD_ALIGN;
+
+    std::vector<ShardRange> ranges;
+    for (uint32_t offset = 0; offset < total; offset += size)
+        ranges.push_back({offset, std::min(size, total - offset)});
+    return ranges;
+}
+
+std::string shard_graph_name(const std::string &bucket_name, uint32_t col, uint32_t tile)
+{
+    return bucket_name + "_n" + std::to_string(col) + "k" + std::to_string(tile);
+}
+
+bool parse_shard_graph_name(const std::string &name, std::string &bucket_name, uint32_t &col, uint32_t &tile)
+{
+    size_t sep = name.rfind('_');
+    if (sep == std::string::npos)
+        return false;
+
+    unsigned c, t;
+    char tail;
+    if (sscanf(name.c_str() + sep, "_n%uk%u%c", &c, &t, &tail) != 2)
+        return false;
+
+    bucket_name = name.substr(0, sep);
+    col = c;
+    tile = t;
+    return true;
+}
+
+bool ShardedLayer::build(QnnGraphTable &graphs, uint32_t rows)
+{
+    std::map<std::string, std::vector<LayerShard>> layers;
+    for (auto &entry : graphs)
+    {
+        std::string bucket_name;
+        LayerShard shard{};
+        if (!parse_shard_graph_name(entry.first, bucket_name, shard.col, shard.tile))
+            continue;
+
+        const QnnGraphInfo &info = entry.second.info;
+        if (info.numGraphInputs == 0 || info.numGraphOutputs == 0 ||
+            qnn_tensor_rank(info.graphInputs[0]) != 2 || qnn_tensor_rank(info.graphOutputs[0]) != 2)
+            continue;
+
+        shard.graph = &entry.second;
+        shard.kn = qnn_tensor_dims(info.graphInputs[0])[1];
+        shard.nn = qnn_tensor_dims(info.graphOutputs[0])[1];
+        layers[bucket_name].push_back(shard);
+    }
+
+    // Same selection as BatchBuckets
+    const std::vector<LayerShard> *selected = nullptr;
+    uint32_t selected_batch = 0;
+    for (auto &layer : layers)
+    {
+        uint32_t batch = qnn_tensor_dims(layer.second[0].graph->info.graphInputs[0])[0];
+        bool fits = batch >= rows;
+        bool selected_fits = selected && selected_batch >= rows;
+        if (selected == nullptr || (fits && (!selected_fits || batch < selected_batch)) ||
+            (!fits && !selected_fits && batch > selected_batch))
+        {
+            selected = &layer.second;
+            selected_batch = batch;
+            name_ = layer.first;
+        }
+    }
+    if (selected == nullptr)
+        return false;
+
+    shards_ = *selected;
+    batch_ = selected_batch;
+    std::sort(shards_.begin(), shards_.end(), [](const LayerShard &a, const LayerShard &b)
+              { return a.col != b.col ? a.col < b.col : a.tile < b.tile; });
+    col_shards_ = shards_.back().col + 1;
+    k_tiles_ = 0;
+    for (const LayerShard &shard : shards_)
+        k_tiles_ = std::max(k_tiles_, shard.tile + 1);
+    if (shards_.size() != static_cast<size_t>(col_shards_) * k_tiles_)
+    {
+        printf("Sharded layer %s: %zu graphs for %u x %u shards\n", name_.c_str(), shards_.size(), col_shards_, k_tiles_);
+        return false;
+    }
+
+    // Every column shard tiles K the same way and keeps its width across tiles
+    out_features_ = 0;
+    for (uint32_t c = 0; c < col_shards_; c++)
+    {
+        in_features_ = 0;
+        for (uint32_t t = 0; t < k_tiles_; t++)
+        {
+            LayerShard &shard = shards_[c * k_tiles_ + t];
+            const LayerShard &first_col = shards_[t];
+            const LayerShard &first_tile = shards_[c * k_tiles_];
+            if (shard.kn != first_col.kn || shard.nn != first_tile.nn)
+            {
+                printf("Sharded layer %s: shard n%uk%u does not line up\n", name_.c_str(), c, t);
+                return false;
+            }
+            shard.n0 = out_features_;
+            shard.k0 = in_features_;
+            in_features_ += shard.kn;
+        }
+        out_features_ += shards_[c * k_tiles_].nn;
+    }
+
+    return true;
+}
+
+void gather_columns(const uint16_t *src, uint32_t rows, uint32_t src_cols,
+                    uint32_t col0, uint32_t cols, uint16_t *dst)
+{
+    for (uint32_t r = 0; r < rows; r++)
+        memcpy(dst + static_cast<size_t>(r) * cols, src + static_cast<size_t>(r) * src_cols + col0, cols * sizeof(uint16_t));
+}
+
+void combine_shard_output(const uint16_t *shard, uint32_t rows, uint32_t cols,
+                          float *out, uint32_t out_cols, uint32_t col0, bool accumulate)
+{
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        const uint16_t *src = shard + static_cast<size_t>(r) * cols;
+        float *dst = out + static_cast<size_t>(r) * out_cols + col0;
+        if (accumulate)
+            accumulate_fp16_to_fp32(src, dst, cols);
+        else
+            fp16_to_fp32_array(src, dst, cols);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "QnnSetup.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --col-shards N --k-tiles M [--with-monolithic] of the AOT tools
+struct ShardConfig
+{
+    uint32_t col_shards{1}; // --col-shards N, output features split across N graphs
+    uint32_t k_tiles{1};    // --k-tiles M, input features split across M graphs whose outputs are summed
+    bool monolithic{false}; // --with-monolithic, also build the unsplit graphs for comparison
+
+    bool sharded() const { return col_shards > 1 || k_tiles > 1; }
+};
+
+// Leaves `config` untouched when absent
+void parse_shard_arg(int argc, char **argv, ShardConfig &config);
+
+struct ShardRange
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+// `total` split into at most `parts` ranges, multiples of 64 except the last
+std::vector<ShardRange> split_dimension(uint32_t total, uint32_t parts);
+
+// Graph name of one shard of a bucket, e.g. linear_b8_n1k0
+std::string shard_graph_name(const std::string &bucket_name, uint32_t col, uint32_t tile);
+// Inverse of shard_graph_name(), false for unsharded graphs
+bool parse_shard_graph_name(const std::string &name, std::string &bucket_name, uint32_t &col, uint32_t &tile);
+
+struct LayerShard
+{
+    QnnGraph *graph;
+    uint32_t col;  // column shard index
+    uint32_t tile; // K tile index
+    uint32_t n0, nn; // output columns [n0, n0 + nn)
+    uint32_t k0, kn; // input columns [k0, k0 + kn)
+};
+
+/**
+ * Shard graphs of one batch bucket, as built by the AOT tools with
+ * --col-shards / --k-tiles. Column shards own disjoint output columns and
+ * are concatenated; K tiles of the same columns produce partial sums that
+ * the host adds up in FP32. Offsets come from the graph dimensions, so
+ * uneven splits work.
+ */
+class ShardedLayer
+{
+public:
+    // Shards of the smallest batch holding `rows`, the largest one when none does
+    bool build(QnnGraphTable &graphs, uint32_t rows);
+
+    const std::string &name() const { return name_; }
+    uint32_t batch() const { return batch_; }
+    uint32_t in_features() const { return in_features_; }
+    uint32_t out_features() const { return out_features_; }
+    uint32_t col_shards() const { return col_shards_; }
+    uint32_t k_tiles() const { return k_tiles_; }
+    // Sorted by column shard, then K tile
+    const std::vector<LayerShard> &shards() const { return shards_; }
+
+private:
+    std::string name_;
+    uint32_t batch_{0};
+    uint32_t in_features_{0};
+    uint32_t out_features_{0};
+    uint32_t col_shards_{0};
+    uint32_t k_tiles_{0};
+    std::vector<LayerShard> shards_;
+};
+
+// Columns [col0, col0 + cols) of a row-major FP16 [rows, src_cols] matrix, packed into `dst`
+void gather_columns(const uint16_t *src, uint32_t rows, uint32_t src_cols,
+                    uint32_t col0, uint32_t cols, uint16_t *dst);
+
+/**
+ * FP16 shard output [rows, cols] into columns [col0, col0 + cols) of the
+ * FP32 output [rows, out_cols]. The first partial sum of a column block is
+ * converted straight into place, later ones are added to it.
+ */
+void combine_shard_output(const uint16_t *shard, uint32_t rows, uint32_t cols,
+                          float *out, uint32_t out_cols, uint32_t col0, bool accumulate);
+
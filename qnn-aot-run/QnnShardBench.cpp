@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "QnnHalf.h"
+#include "QnnShard.h"
+#include "QnnUtils.h"
+
+// Host side of sharded linear layers. First a small layer is split
+// unevenly, every shard is run as a reference FullyConnected with FP16
+// outputs, and the combined result is checked against the unsplit layer.
+// Then the layer grows from 4096 to --max-size, and each shard layout
+// reports the per-inference host work (input gather plus concat/reduce)
+// against the monolithic readback, the I/O it needs and the largest weight
+// slice a single graph has to hold.
+
+static uint32_t rows = 32;
+static uint32_t max_size = 4096 * 8;
+static uint32_t num_iters = 20;
+
+static void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--rows") && i + 1 < argc)
+            rows = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--max-size") && i + 1 < argc)
+            max_size = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc)
+            num_iters = static_cast<uint32_t>(atoi(argv[++i]));
+    }
+}
+
+// Graph table entries as QnnRetrieveGraphs would list them, dims only
+struct FakeGraph
+{
+    std::string name;
+    uint32_t in_dims[2];
+    uint32_t out_dims[2];
+    Qnn_Tensor_t input;
+    Qnn_Tensor_t output;
+};
+
+static void add_shard_graphs(QnnGraphTable &graphs, std::vector<std::unique_ptr<FakeGraph>> &storage,
+                             const std::string &bucket_name, uint32_t batch,
+                             const std::vector<ShardRange> &cols, const std::vector<ShardRange> &tiles)
+{
+    for (uint32_t c = 0; c < cols.size(); c++)
+    {
+        for (uint32_t t = 0; t < tiles.size(); t++)
+        {
+            storage.emplace_back(new FakeGraph());
+            FakeGraph &fake = *storage.back();
+            fake.name = shard_graph_name(bucket_name, c, t);
+            fake.in_dims[0] = batch;
+            fake.in_dims[1] = tiles[t].size;
+            fake.out_dims[0] = batch;
+            fake.out_dims[1] = cols[c].size;
+            fake.input = QNN_TENSOR_INIT;
+            fake.input.v1.rank = 2;
+            fake.input.v1.dimensions = fake.in_dims;
+            fake.output = QNN_TENSOR_INIT;
+            fake.output.v1.rank = 2;
+            fake.output.v1.dimensions = fake.out_dims;
+
+            QnnGraph &graph = graphs[fake.name];
+            graph.info = {fake.name.c_str(), 1, &fake.input, 1, &fake.output};
+            graph.handle = nullptr;
+        }
+    }
+}
+
+// Split, run each shard as x[:, k] . W[n, k]^T + b (bias on tile 0) rounded to FP16, combine
+static bool check_combine(uint32_t batch, uint32_t in_features, uint32_t out_features, uint32_t col_shards, uint32_t k_tiles)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<uint16_t> x(static_cast<size_t>(batch) * in_features);
+    std::vector<uint16_t> w(static_cast<size_t>(out_features) * in_features);
+    std::vector<float> bias(out_features);
+    for (uint16_t &v : x)
+        v = fp32_to_fp16(dist(rng));
+    for (uint16_t &v : w)
+        v = fp32_to_fp16(dist(rng) / std::sqrt(static_cast<float>(in_features)));
+    for (float &v : bias)
+        v = fp16_to_fp32(fp32_to_fp16(dist(rng)));
+
+    QnnGraphTable graphs;
+    std::vector<std::unique_ptr<FakeGraph>> storage;
+    // A larger bucket next to it, so the layer has to be picked by batch
+    add_shard_graphs(graphs, storage, "linear_b" + std::to_string(batch), batch,
+                     split_dimension(out_features, col_shards), split_dimension(in_features, k_tiles));
+    add_shard_graphs(graphs, storage, "linear_b" + std::to_string(batch * 2), batch * 2,
+                     split_dimension(out_features, col_shards), split_dimension(in_features, k_tiles));
+
+    ShardedLayer layer;
+    if (!layer.build(graphs, batch) || layer.batch() != batch ||
+        layer.in_features() != in_features || layer.out_features() != out_features)
+    {
+        printf("ShardedLayer did not rebuild [%u, %u] -> [%u, %u]\n", batch, in_features, batch, out_features);
+        return false;
+    }
+
+    std::vector<float> out(static_cast<size_t>(batch) * out_features);
+    std::vector<uint32_t> tiles_done(layer.col_shards(), 0);
+    std::vector<uint16_t> shard_in;
+    std::vector<uint16_t> shard_out;
+    // Reverse completion order, as an async backend may deliver them
+    for (auto it = layer.shards().rbegin(); it != layer.shards().rend(); ++it)
+    {
+        const LayerShard &shard = *it;
+        shard_in.resize(static_cast<size_t>(batch) * shard.kn);
+        shard_out.resize(static_cast<size_t>(batch) * shard.nn);
+        gather_columns(x.data(), batch, in_features, shard.k0, shard.kn, shard_in.data());
+        for (uint32_t r = 0; r < batch; r++)
+        {
+            for (uint32_t n = 0; n < shard.nn; n++)
+            {
+                float acc = shard.tile == 0 ? bias[shard.n0 + n] : 0.0f;
+                for (uint32_t k = 0; k < shard.kn; k++)
+                    acc += fp16_to_fp32(shard_in[r * shard.kn + k]) *
+                           fp16_to_fp32(w[static_cast<size_t>(shard.n0 + n) * in_features + shard.k0 + k]);
+                shard_out[r * shard.nn + n] = fp32_to_fp16(acc);
+            }
+        }
+        combine_shard_output(shard_out.data(), batch, shard.nn, out.data(), out_features, shard.n0,
+                             tiles_done[shard.col]++ > 0);
+    }
+
+    // Each tile's output carries half an FP16 ulp of rounding
+    double max_err = 0.0;
+    double max_bound = 0.0;
+    bool ok = true;
+    for (uint32_t r = 0; r < batch; r++)
+    {
+        for (uint32_t n = 0; n < out_features; n++)
+        {
+            double ref = bias[n];
+            double abs_sum = std::fabs(bias[n]);
+            for (uint32_t k = 0; k < in_features; k++)
+            {
+                double p = static_cast<double>(fp16_to_fp32(x[r * in_features + k])) *
+                           fp16_to_fp32(w[static_cast<size_t>(n) * in_features + k]);
+                ref += p;
+                abs_sum += std::fabs(p);
+            }
+            double err = std::fabs(out[static_cast<size_t>(r) * out_features + n] - ref);
+            double bound = layer.k_tiles() * abs_sum * std::ldexp(1.0, -11) + 1e-6;
+            max_err = std::max(max_err, err);
+            max_bound = std::max(max_bound, bound);
+            ok = ok && err <= bound;
+        }
+    }
+
+    printf("  %u x %u shards of [%u, %u] -> [%u, %u]: max |err| %.2e (bound %.2e) %s\n",
+           layer.col_shards(), layer.k_tiles(), batch, in_features, batch, out_features,
+           max_err, max_bound, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+template <typename FN>
+static double ms_per_pass(FN pass)
+{
+    pass();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iters; i++)
+        pass();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / num_iters;
+}
+
+int main(int argc, char **argv)
+{
+    parse_bench_arg(argc, argv);
+
+    printf("=======================================================\n");
+    printf("Sharded linear host path: %u rows, %s conversion and reduction\n",
+           rows, fp16_convert_path());
+    printf("=======================================================\n");
+
+    printf("Combine check:\n");
+    bool ok = check_combine(4, 300, 200, 1, 1) &&
+              check_combine(4, 300, 200, 3, 1) &&
+              check_combine(4, 300, 200, 1, 3) &&
+              check_combine(3, 520, 333, 4, 5);
+    if (!ok)
+        return -1;
+
+    const uint32_t layouts[][2] = {{1, 1}, {4, 1}, {1, 4}, {4, 4}, {8, 2}};
+    printf("%7s %7s %8s %12s %10s %12s %14s %10s\n",
+           "size", "shards", "graphs", "host (ms)", "GB/s", "I/O (MiB)", "max slice MiB", "RSS KiB");
+    for (uint32_t size = 4096; size <= max_size; size *= 2)
+    {
+        std::vector<uint16_t> input(static_cast<size_t>(rows) * size, fp32_to_fp16(1.0f));
+        std::vector<float> output(static_cast<size_t>(rows) * size);
+        for (const auto &layout : layouts)
+        {
+            std::vector<ShardRange> cols = split_dimension(size, layout[0]);
+            std::vector<ShardRange> tiles = split_dimension(size, layout[1]);
+
+            // One FP16 input and output buffer per shard graph, as the runner registers them
+            std::vector<std::vector<uint16_t>> shard_in;
+            std::vector<std::vector<uint16_t>> shard_out;
+            uint64_t io_bytes = 0;
+            for (const ShardRange &col : cols)
+            {
+                for (const ShardRange &tile : tiles)
+                {
+                    shard_in.emplace_back(static_cast<size_t>(rows) * tile.size, 0);
+                    shard_out.emplace_back(static_cast<size_t>(rows) * col.size, fp32_to_fp16(0.5f));
+                    io_bytes += (shard_in.back().size() + shard_out.back().size()) * sizeof(uint16_t);
+                }
+            }
+
+            // Monolithic: copy the input in, read the output back; sharded: gather, then concat/reduce
+            bool monolithic = cols.size() == 1 && tiles.size() == 1;
+            double ms = ms_per_pass([&]()
+                                    {
+                size_t s = 0;
+                for (uint32_t c = 0; c < cols.size(); c++)
+                {
+                    for (uint32_t t = 0; t < tiles.size(); t++, s++)
+                    {
+                        if (monolithic)
+                            memcpy(shard_in[s].data(), input.data(), input.size() * sizeof(uint16_t));
+                        else
+                            gather_columns(input.data(), rows, size, tiles[t].offset, tiles[t].size, shard_in[s].data());
+                        combine_shard_output(shard_out[s].data(), rows, cols[c].size, output.data(), size,
+                                             cols[c].offset, t > 0);
+                    }
+                } });
+
+            // FP16 input read + written, FP16 outputs read, FP32 output written (and read again per extra tile)
+            double bytes = rows * static_cast<double>(size) * (2 * 2 + 2 * tiles.size() + 4 * (2 * tiles.size() - 1));
+            double slice_mib = 2.0 * cols[0].size * tiles[0].size / (1 << 20);
+            printf("%7u %4zux%-2zu %8zu %12.3f %10.2f %12.2f %14.1f %10lu\n",
+                   size, cols.size(), tiles.size(), cols.size() * tiles.size(), ms, bytes / ms / 1e6,
+                   io_bytes / static_cast<double>(1 << 20), slice_mib, get_current_rss_kb());
+
+            // K tiles sum to tiles.size() * 0.5
+            if (output[0] != 0.5f * tiles.size())
+            {
+                printf("Unexpected combined output %f\n", output[0]);
+                return -1;
+            }
+        }
+    }
+
+    printf("Peak RSS: %lu KiB\n", get_peak_rss_kb());
+    return 0;
+}
@@ -1,11 +1,49 @@
 #include "QnnSharedBuffer.h"
 #include <dlfcn.h>
+#include <cstdio>
 
 constexpr uint8_t RPCMEM_HEAP_ID_SYSTEM = 25;
 constexpr uint8_t RPCMEM_DEFAULT_FLAGS = 1;
 
+// Size-class pool parameters
+constexpr uint32_t POOL_MIN_CLASS_BYTES = 4096;
+constexpr uint32_t POOL_CLASS_STEPS_LOG2 = 3; // 8 classes per power of two
+constexpr uint64_t POOL_SLAB_BYTES = 4ull << 20;
+constexpr uint32_t POOL_MAX_SLAB_BLOCKS = 16;
+
+// Per-thread cache limits
+constexpr uint32_t THREAD_CACHE_BLOCKS = 4;
+constexpr uint64_t THREAD_CACHE_BYTES = 16ull << 20;
+
 std::mutex SharedBuffer::init_mutex_;
 
+// Cleared when the manager is destroyed, so late thread exits don't touch it
+static std::atomic<bool> g_manager_alive{false};
+static std::atomic<uint32_t> g_next_counter_slot{0};
+
+struct SharedBuffer::ThreadCache
+{
+    std::unordered_map<uint32_t, std::vector<void *>> blocks;
+    uint64_t bytes{0};
+    uint32_t slot{g_next_counter_slot.fetch_add(1, std::memory_order_relaxed) % NUM_COUNTER_SLOTS};
+
+    ~ThreadCache()
+    {
+        if (!g_manager_alive.load(std::memory_order_acquire) || bytes == 0)
+            return;
+
+        SharedBuffer &manager = SharedBuffer::get_shared_buffer_manager();
+        std::lock_guard<std::mutex> lock(manager.pool_mutex_);
+        for (auto &entry : blocks)
+        {
+            auto &free_list = manager.free_lists_[entry.first];
+            free_list.insert(free_list.end(), entry.second.begin(), entry.second.end());
+        }
+        manager.counter_slots_[slot].bytes_cached.fetch_sub(bytes, std::memory_order_relaxed);
+        manager.pool_stats_.bytes_idle.fetch_add(bytes, std::memory_order_relaxed);
+    }
+};
+
 intptr_t align_to(size_t alignment, intptr_t offset)
 {
     return offset % alignment == 0 ? offset
@@ -16,26 +54,53 @@ intptr_t align_to(size_t alignment, intptr_t offset)
 
 SharedBuffer::~SharedBuffer()
 {
+    g_manager_alive.store(false, std::memory_order_release);
+    if (initialized_)
+        trim_central(0);
     unload();
 }
 
 SharedBuffer &SharedBuffer::get_shared_buffer_manager()
 {
-    std::lock_guard<std::mutex> lock(init_mutex_);
     static SharedBuffer manager;
     if (!manager.get_init())
     {
-        manager.load();
-        manager.set_init(true);
+        std::lock_guard<std::mutex> lock(init_mutex_);
+        if (!manager.load_attempted_)
+        {
+            manager.load_attempted_ = true;
+            g_manager_alive.store(true, std::memory_order_release);
+            manager.set_init(manager.load());
+        }
     }
 
     return manager;
 }
 
+SharedBuffer::ThreadCache &SharedBuffer::thread_cache()
+{
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+SharedBuffer::CounterSlot &SharedBuffer::counter_slot()
+{
+    return counter_slots_[thread_cache().slot];
+}
+
+SharedBuffer::MapShard &SharedBuffer::shard_of(void *addr)
+{
+    // Fibonacci hash; rpcmem blocks are page aligned so the low bits carry little
+    uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(addr)) >> 3;
+    return shards_[(key * 0x9E3779B97F4A7C15ull) >> 59];
+}
+
 void *SharedBuffer::get_custom_memory_base(void *buf)
 {
-    auto iter = tensor_addr_to_custom_mem.find(buf);
-    if (iter == tensor_addr_to_custom_mem.end())
+    MapShard &shard = shard_of(buf);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto iter = shard.tensor_addr_to_custom_mem.find(buf);
+    if (iter == shard.tensor_addr_to_custom_mem.end())
     {
         return nullptr;
     }
@@ -45,8 +110,10 @@ void *SharedBuffer::get_custom_memory_base(void *buf)
 
 void *SharedBuffer::get_unaligned_addr(void *buf)
 {
-    auto iter = restore_map_.find(buf);
-    if (iter == restore_map_.end())
+    MapShard &shard = shard_of(buf);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto iter = shard.restore_map.find(buf);
+    if (iter == shard.restore_map.end())
     {
         return nullptr;
     }
@@ -54,46 +121,310 @@ void *SharedBuffer::get_unaligned_addr(void *buf)
     return iter->second;
 }
 
+uint32_t SharedBuffer::get_allocated_size(void *unaligned_buf)
+{
+    MapShard &shard = shard_of(unaligned_buf);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto iter = shard.alloc_size_map.find(unaligned_buf);
+    if (iter == shard.alloc_size_map.end())
+    {
+        return 0;
+    }
+
+    return iter->second;
+}
+
+uint32_t SharedBuffer::size_class_of(uint32_t bytes)
+{
+    if (bytes <= POOL_MIN_CLASS_BYTES)
+        return POOL_MIN_CLASS_BYTES;
+
+    // Round up to 1/8 of the enclosing power of two, so a class wastes at most 12.5%
+    uint32_t msb = 31 - __builtin_clz(bytes - 1);
+    uint64_t step = 1ull << (msb - POOL_CLASS_STEPS_LOG2);
+    uint64_t class_bytes = (static_cast<uint64_t>(bytes) + step - 1) & ~(step - 1);
+    return class_bytes > UINT32_MAX ? 0 : static_cast<uint32_t>(class_bytes);
+}
+
+void *SharedBuffer::grow_slab(uint32_t class_bytes)
+{
+    uint64_t blocks = POOL_SLAB_BYTES / class_bytes;
+    if (blocks == 0)
+        blocks = 1;
+    else if (blocks > POOL_MAX_SLAB_BLOCKS)
+        blocks = POOL_MAX_SLAB_BLOCKS;
+
+    // rpcmem calls are slow, keep them outside of every lock.
+    // Each block stays its own rpcmem allocation so mem2fd/ION registration keeps working
+    std::vector<void *> slab;
+    slab.reserve(blocks);
+    for (uint64_t i = 0; i < blocks; i++)
+    {
+        void *block = rpc_mem_alloc_(RPCMEM_HEAP_ID_SYSTEM, RPCMEM_DEFAULT_FLAGS, class_bytes);
+        if (!block)
+            break;
+
+        MapShard &shard = shard_of(block);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.alloc_size_map.insert({block, class_bytes});
+        slab.push_back(block);
+    }
+
+    // A refill that got no block from rpcmem is not a grow
+    if (slab.empty())
+        return nullptr;
+    pool_stats_.slab_grows.fetch_add(1, std::memory_order_relaxed);
+    pool_stats_.rpc_allocs.fetch_add(slab.size(), std::memory_order_relaxed);
+
+    // Hand the first block to the caller and park the rest
+    void *block = slab.back();
+    slab.pop_back();
+    if (!slab.empty())
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        auto &free_list = free_lists_[class_bytes];
+        free_list.insert(free_list.end(), slab.begin(), slab.end());
+        pool_stats_.bytes_idle.fetch_add(class_bytes * slab.size(), std::memory_order_relaxed);
+    }
+
+    return block;
+}
+
+void *SharedBuffer::take_block(uint32_t class_bytes)
+{
+    // Fast path: this thread's cache and counter slot, no lock and no shared line
+    ThreadCache &cache = thread_cache();
+    CounterSlot &counters = counter_slots_[cache.slot];
+    auto iter = cache.blocks.find(class_bytes);
+    if (iter != cache.blocks.end() && !iter->second.empty())
+    {
+        void *block = iter->second.back();
+        iter->second.pop_back();
+        cache.bytes -= class_bytes;
+        counters.hits.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes_cached.fetch_sub(class_bytes, std::memory_order_relaxed);
+        return block;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        auto &free_list = free_lists_[class_bytes];
+        if (!free_list.empty())
+        {
+            void *block = free_list.back();
+            free_list.pop_back();
+            pool_stats_.bytes_idle.fetch_sub(class_bytes, std::memory_order_relaxed);
+            counters.hits.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+
+    counters.misses.fetch_add(1, std::memory_order_relaxed);
+    return grow_slab(class_bytes);
+}
+
+bool SharedBuffer::give_block(void *block, uint32_t class_bytes)
+{
+    ThreadCache &cache = thread_cache();
+    auto &cached = cache.blocks[class_bytes];
+    if (cached.size() < THREAD_CACHE_BLOCKS && cache.bytes + class_bytes <= THREAD_CACHE_BYTES)
+    {
+        cached.push_back(block);
+        cache.bytes += class_bytes;
+        counter_slots_[cache.slot].bytes_cached.fetch_add(class_bytes, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    free_lists_[class_bytes].push_back(block);
+    pool_stats_.bytes_idle.fetch_add(class_bytes, std::memory_order_relaxed);
+    return false;
+}
+
 void *SharedBuffer::allocmem(uint32_t bytes, uint32_t align)
 {
-    if (!initialized_)
+    if (!get_init())
         return nullptr;
 
-    uint32_t alloc_bytes = (bytes + align);
-    void *buf = rpc_mem_alloc_(RPCMEM_HEAP_ID_SYSTEM, RPCMEM_DEFAULT_FLAGS, alloc_bytes);
-    if (!buf)
+    // 64-bit so requests near 4 GiB fail instead of wrapping to a small class
+    uint64_t request = static_cast<uint64_t>(bytes) + align;
+    if (request > UINT32_MAX)
+        return nullptr;
+    uint32_t class_bytes = size_class_of(static_cast<uint32_t>(request));
+    if (class_bytes == 0)
         return nullptr;
 
-    alloc_size_map_.insert({buf, alloc_bytes});
+    void *buf = take_block(class_bytes);
+    if (!buf)
+        return nullptr;
 
     void *aligned_buf = reinterpret_cast<void *>(align_to(align, reinterpret_cast<intptr_t>(buf)));
-    bool status = restore_map_.insert({aligned_buf, buf}).second;
+    bool status = false;
+    {
+        MapShard &shard = shard_of(aligned_buf);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        status = shard.restore_map.insert({aligned_buf, buf}).second;
+    }
+
     if (!status)
     {
-        rpc_mem_free_(buf);
+        give_block(buf, class_bytes);
         return nullptr;
     }
 
+    counter_slot().bytes_in_use.fetch_add(class_bytes, std::memory_order_relaxed);
     return aligned_buf;
 }
 
 void SharedBuffer::freemem(void *buf)
 {
-    if (!initialized_)
+    if (!get_init())
         return;
-    else if (restore_map_.count(buf) == 0)
+
+    void *block = nullptr;
+    {
+        MapShard &shard = shard_of(buf);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto iter = shard.restore_map.find(buf);
+        if (iter != shard.restore_map.end())
+        {
+            block = iter->second;
+            shard.restore_map.erase(iter);
+        }
+    }
+
+    if (!block)
+    {
         printf("Don't free an unallocated tensor.");
-    else
+        return;
+    }
+
+    // Tensors sub-allocated from this buffer go away with it
+    std::vector<void *> bound_tensors;
+    {
+        MapShard &shard = shard_of(buf);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto iter = shard.custom_mem_tensors.find(buf);
+        if (iter != shard.custom_mem_tensors.end())
+        {
+            bound_tensors.swap(iter->second);
+            shard.custom_mem_tensors.erase(iter);
+        }
+    }
+    for (void *tensor_addr : bound_tensors)
+    {
+        MapShard &shard = shard_of(tensor_addr);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.tensor_addr_to_custom_mem.erase(tensor_addr);
+    }
+
+    uint32_t class_bytes = 0;
+    {
+        MapShard &shard = shard_of(block);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        class_bytes = shard.alloc_size_map[block];
+    }
+
+    counter_slot().bytes_in_use.fetch_sub(class_bytes, std::memory_order_relaxed);
+    if (give_block(block, class_bytes))
+        return;
+
+    // Only blocks that reached the shared lists can be trimmed
+    uint64_t high_water = get_pool_high_water();
+    if (static_cast<uint64_t>(pool_stats_.bytes_idle.load(std::memory_order_relaxed)) > high_water)
+        trim_central(high_water);
+}
+
+void SharedBuffer::trim_pool(uint64_t keep_bytes)
+{
+    // Give this thread's cached blocks back first so they can be released too
+    ThreadCache &cache = thread_cache();
     {
-        rpc_mem_free_(restore_map_[buf]);
-        restore_map_.erase(buf);
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        for (auto &entry : cache.blocks)
+        {
+            auto &free_list = free_lists_[entry.first];
+            free_list.insert(free_list.end(), entry.second.begin(), entry.second.end());
+            entry.second.clear();
+        }
+        pool_stats_.bytes_idle.fetch_add(cache.bytes, std::memory_order_relaxed);
     }
+    counter_slots_[cache.slot].bytes_cached.fetch_sub(cache.bytes, std::memory_order_relaxed);
+    cache.bytes = 0;
+
+    trim_central(keep_bytes);
+}
+
+void SharedBuffer::set_release_hook(SharedBufferReleaseFn_t hook)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    release_hook_ = std::move(hook);
+}
+
+void SharedBuffer::trim_central(uint64_t keep_bytes)
+{
+    std::vector<std::pair<void *, uint32_t>> released;
+    SharedBufferReleaseFn_t hook;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        hook = release_hook_;
+        int64_t idle = pool_stats_.bytes_idle.load(std::memory_order_relaxed);
+        for (auto &entry : free_lists_)
+        {
+            auto &free_list = entry.second;
+            while (!free_list.empty() && idle > static_cast<int64_t>(keep_bytes))
+            {
+                released.push_back({free_list.back(), entry.first});
+                free_list.pop_back();
+                idle -= entry.first;
+                pool_stats_.bytes_idle.fetch_sub(entry.first, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (auto &entry : released)
+    {
+        {
+            MapShard &shard = shard_of(entry.first);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.alloc_size_map.erase(entry.first);
+        }
+        if (hook)
+            hook(entry.first);
+        rpc_mem_free_(entry.first);
+    }
+
+    pool_stats_.rpc_frees.fetch_add(released.size(), std::memory_order_relaxed);
+    pool_stats_.trims.fetch_add(released.size(), std::memory_order_relaxed);
+}
+
+SharedBufferPoolStats SharedBuffer::get_pool_stats() const
+{
+    SharedBufferPoolStats stats;
+    int64_t in_use = 0;
+    int64_t cached = 0;
+    for (const CounterSlot &slot : counter_slots_)
+    {
+        stats.hits += slot.hits.load(std::memory_order_relaxed);
+        stats.misses += slot.misses.load(std::memory_order_relaxed);
+        in_use += slot.bytes_in_use.load(std::memory_order_relaxed);
+        cached += slot.bytes_cached.load(std::memory_order_relaxed);
+    }
+    // A block freed on another thread than it was taken on moves bytes between slots
+    stats.bytes_in_use = static_cast<uint64_t>(in_use);
+    stats.bytes_cached = static_cast<uint64_t>(cached);
+    stats.slab_grows = pool_stats_.slab_grows.load(std::memory_order_relaxed);
+    stats.rpc_allocs = pool_stats_.rpc_allocs.load(std::memory_order_relaxed);
+    stats.rpc_frees = pool_stats_.rpc_frees.load(std::memory_order_relaxed);
+    stats.trims = pool_stats_.trims.load(std::memory_order_relaxed);
+    stats.bytes_idle = pool_stats_.bytes_idle.load(std::memory_order_relaxed);
+    return stats;
 }
 
 int32_t SharedBuffer::mem2fd(void *buf)
 {
     int32_t memfd = -1;
-    if (!initialized_)
+    if (!get_init())
         return -1;
     memfd = rpc_mem_to_fd_(buf);
     return memfd;
@@ -101,15 +432,26 @@ int32_t SharedBuffer::mem2fd(void *buf)
 
 bool SharedBuffer::is_allocated(void *buf)
 {
-    return restore_map_.count(buf) != 0U;
+    MapShard &shard = shard_of(buf);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.restore_map.count(buf) != 0U;
 }
 
 void SharedBuffer::add_custom_memory_tensor_addr(void *tensor_addr, void *custom_mem)
 {
-    tensor_addr_to_custom_mem.insert({tensor_addr, custom_mem});
+    {
+        MapShard &shard = shard_of(tensor_addr);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.tensor_addr_to_custom_mem.insert({tensor_addr, custom_mem}).second)
+            return;
+    }
+
+    MapShard &shard = shard_of(custom_mem);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.custom_mem_tensors[custom_mem].push_back(tensor_addr);
 }
 
-void SharedBuffer::load()
+bool SharedBuffer::load()
 {
     lib_cdsp_rpc_ = dlopen("libcdsprpc.so", RTLD_LAZY | RTLD_GLOBAL);
 
@@ -118,7 +460,7 @@ void SharedBuffer::load()
     if (!lib_cdsp_rpc_)
     {
         printf("Failed to load libcdsprpc.so %s\n", dlerror());
-        return;
+        return false;
     }
 
     rpc_mem_alloc_ = reinterpret_cast<RpcMemAllocFn_t>(dlsym(lib_cdsp_rpc_, "rpcmem_alloc"));
@@ -128,13 +470,16 @@ void SharedBuffer::load()
     {
         printf("Unable to access symbols in shared buffer. dlerror(): %s", dlerror());
         dlclose(lib_cdsp_rpc_);
-        return;
+        lib_cdsp_rpc_ = nullptr;
+        return false;
     }
+
+    return true;
 }
 
 void SharedBuffer::unload()
 {
-    if (dlclose(lib_cdsp_rpc_) != 0)
+    if (lib_cdsp_rpc_ && dlclose(lib_cdsp_rpc_) != 0)
     {
         printf("Failed to close libcdsprpc.so %s\n", dlerror());
     }
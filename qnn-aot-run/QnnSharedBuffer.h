@@ -2,15 +2,39 @@
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 using RpcMemAllocFn_t = void *(*)(int, uint32_t, int);
 using RpcMemFreeFn_t = void (*)(void *);
 using RpcMemToFdFn_t = int (*)(void *);
+// Called with an rpcmem block right before the pool returns it to rpcmem
+using SharedBufferReleaseFn_t = std::function<void(void *)>;
 
+// Counters of the size-class pool sitting in front of rpcmem_alloc/rpcmem_free
+struct SharedBufferPoolStats
+{
+    uint64_t hits{0};         // allocmem served from a recycled block
+    uint64_t misses{0};       // allocmem had to grow the pool
+    uint64_t slab_grows{0};   // number of slab refills
+    uint64_t rpc_allocs{0};   // total rpcmem_alloc calls
+    uint64_t rpc_frees{0};    // total rpcmem_free calls
+    uint64_t trims{0};        // blocks released because of the high-water mark
+    uint64_t bytes_in_use{0}; // bytes held by live allocations (class sized)
+    uint64_t bytes_idle{0};   // bytes parked in the shared free lists, what trimming releases
+    uint64_t bytes_cached{0}; // bytes parked in the thread caches
+};
+
+/**
+ * Process-wide rpcmem manager. All public methods are thread-safe:
+ *  - address maps are split into shards, each behind its own mutex
+ *  - every thread keeps a small per-class block cache, so the common
+ *    alloc/free cycle never touches the shared free lists
+ */
 class SharedBuffer
 {
 private:
@@ -29,8 +53,11 @@ public:
 
     void* get_unaligned_addr(void* buf);
 
-    bool get_init() { return initialized_; }
-    void set_init(bool init) { initialized_ = init; }
+    // Size of the rpcmem block behind an unaligned address, 0 if unknown
+    uint32_t get_allocated_size(void *unaligned_buf);
+
+    bool get_init() { return initialized_.load(std::memory_order_acquire); }
+    void set_init(bool init) { initialized_.store(init, std::memory_order_release); }
 
     void *allocmem(uint32_t bytes, uint32_t align);
     void freemem(void *buf);
@@ -40,14 +67,77 @@ public:
 
     void add_custom_memory_tensor_addr(void *tensor_addr, void *custom_mem);
 
+    // Pool controls. Idle bytes above the high-water mark are returned to rpcmem.
+    void set_pool_high_water(uint64_t bytes) { pool_high_water_.store(bytes, std::memory_order_relaxed); }
+    uint64_t get_pool_high_water() const { return pool_high_water_.load(std::memory_order_relaxed); }
+    void trim_pool(uint64_t keep_bytes = 0);
+    // Lets registrations of pooled blocks live until the block is really freed
+    void set_release_hook(SharedBufferReleaseFn_t hook);
+    SharedBufferPoolStats get_pool_stats() const;
+
+    static uint32_t size_class_of(uint32_t bytes);
+
 private:
-    void load();
+    static constexpr uint32_t NUM_SHARDS = 32;
+
+    struct alignas(64) MapShard
+    {
+        std::mutex mutex;
+
+        // Maps for the custom memory
+        // restore_map: aligned address handed out -> rpcmem block
+        // alloc_size_map: every rpcmem block owned by the pool -> size class
+        std::unordered_map<void *, void *> restore_map;
+        std::unordered_map<void *, uint32_t> alloc_size_map;
+
+        // For Custom Memory Base Address
+        std::unordered_map<void *, void *> tensor_addr_to_custom_mem;
+        // custom memory base -> tensor addresses bound into it, dropped on freemem
+        std::unordered_map<void *, std::vector<void *>> custom_mem_tensors;
+    };
+
+    // Slow-path counters, only touched next to pool_mutex_ or an rpcmem call
+    struct PoolCounters
+    {
+        std::atomic<uint64_t> slab_grows{0};
+        std::atomic<uint64_t> rpc_allocs{0};
+        std::atomic<uint64_t> rpc_frees{0};
+        std::atomic<uint64_t> trims{0};
+        std::atomic<int64_t> bytes_idle{0}; // shared free lists only, updated under pool_mutex_
+    };
+
+    // Counters of the alloc/free fast path. Each thread bumps the slot it was
+    // given, so the line stays with its core; get_pool_stats() sums the slots.
+    static constexpr uint32_t NUM_COUNTER_SLOTS = 64;
+
+    struct alignas(64) CounterSlot
+    {
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<int64_t> bytes_in_use{0};
+        std::atomic<int64_t> bytes_cached{0};
+    };
+
+    struct ThreadCache;
+    friend struct ThreadCache;
+
+    static ThreadCache &thread_cache();
+    CounterSlot &counter_slot();
+    MapShard &shard_of(void *addr);
+
+    bool load();
     void unload();
 
+    void *take_block(uint32_t class_bytes);
+    bool give_block(void *block, uint32_t class_bytes);
+    void *grow_slab(uint32_t class_bytes);
+    void trim_central(uint64_t keep_bytes);
+
 private:
     static std::mutex init_mutex_;
 
-    bool initialized_{false};
+    std::atomic<bool> initialized_{false};
+    bool load_attempted_{false};
     void *lib_cdsp_rpc_{nullptr};
 
     // Function pointer to rpcmem_alloc
@@ -59,10 +149,14 @@ private:
     // Function pointer to rpcmem_to_fd
     RpcMemToFdFn_t rpc_mem_to_fd_;
 
-    // Maps for the custom memory
-    std::unordered_map<void *, void *> restore_map_;
-    std::unordered_map<void *, uint32_t> alloc_size_map_;
+    MapShard shards_[NUM_SHARDS];
+
+    // Size class -> recycled rpcmem blocks shared by all threads
+    std::mutex pool_mutex_;
+    std::unordered_map<uint32_t, std::vector<void *>> free_lists_;
+    SharedBufferReleaseFn_t release_hook_;
 
-    // For Custom Memory Base Address
-    std::unordered_map<void *, void *> tensor_addr_to_custom_mem;
-};
\ No newline at end of file
+    std::atomic<uint64_t> pool_high_water_{256ull << 20};
+    PoolCounters pool_stats_;
+    CounterSlot counter_slots_[NUM_COUNTER_SLOTS];
+};
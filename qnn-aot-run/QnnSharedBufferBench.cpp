@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "QnnSharedBuffer.h"
+
+/**
+ * Multi-threaded SharedBuffer stress benchmark.
+ * Every worker churns request-sized buffers (alloc, lookup, fd, free) the way
+ * a serving loop does and the allocation rate is reported per thread count.
+ *
+ * Host run: LD_LIBRARY_PATH=<build dir> ./QnnSharedBufferBench [--threads N] [--iters N]
+ */
+
+uint32_t max_threads = std::thread::hardware_concurrency();
+uint32_t num_iter = 20000;
+
+static constexpr uint32_t DEFAULT_ALIGNMENT = 8;
+static const uint32_t request_sizes[] = {4096, 64 * 1024, 256 * 1024, 2 * 1024 * 1024};
+
+void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            max_threads = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc)
+            num_iter = static_cast<uint32_t>(atoi(argv[++i]));
+    }
+
+    if (max_threads == 0)
+        max_threads = 1;
+}
+
+void worker(std::atomic<bool> &start, std::atomic<uint64_t> &failures)
+{
+    SharedBuffer &manager = SharedBuffer::get_shared_buffer_manager();
+    constexpr uint32_t num_sizes = sizeof(request_sizes) / sizeof(request_sizes[0]);
+    void *bufs[num_sizes];
+
+    while (!start.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    for (uint32_t i = 0; i < num_iter; i++)
+    {
+        for (uint32_t s = 0; s < num_sizes; s++)
+        {
+            bufs[s] = manager.allocmem(request_sizes[s], DEFAULT_ALIGNMENT);
+            if (!bufs[s])
+                failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for (uint32_t s = 0; s < num_sizes; s++)
+        {
+            if (!bufs[s])
+                continue;
+            if (!manager.is_allocated(bufs[s]) || manager.get_unaligned_addr(bufs[s]) == nullptr ||
+                manager.mem2fd(bufs[s]) < 0)
+                failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for (uint32_t s = 0; s < num_sizes; s++)
+        {
+            if (bufs[s])
+                manager.freemem(bufs[s]);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    printf("=======================================================\n");
+    printf("Qnn SharedBuffer Multi-thread Stress Benchmark\n");
+    printf("=======================================================\n");
+
+    parse_bench_arg(argc, argv);
+
+    SharedBuffer &manager = SharedBuffer::get_shared_buffer_manager();
+    if (!manager.get_init())
+    {
+        printf("SharedBuffer is not initialized (libcdsprpc.so missing?)\n");
+        return -1;
+    }
+
+    constexpr uint32_t num_sizes = sizeof(request_sizes) / sizeof(request_sizes[0]);
+    double base_rate = 0.0;
+
+    // 1, 2, 4, ... below the maximum, then the maximum itself
+    std::vector<uint32_t> thread_counts;
+    for (uint32_t threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    printf("%8s %14s %16s %10s %10s\n", "threads", "time (ms)", "allocs/s", "scaling", "failures");
+    for (uint32_t threads : thread_counts)
+    {
+        std::atomic<bool> start{false};
+        std::atomic<uint64_t> failures{0};
+        std::vector<std::thread> workers;
+        for (uint32_t t = 0; t < threads; t++)
+            workers.emplace_back(worker, std::ref(start), std::ref(failures));
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto &w : workers)
+            w.join();
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        double allocs = static_cast<double>(threads) * num_iter * num_sizes;
+        double rate = allocs / seconds;
+        if (threads == 1)
+            base_rate = rate;
+
+        printf("%8u %14.3f %16.0f %9.2fx %10lu\n", threads, seconds * 1e3, rate, rate / base_rate,
+               static_cast<unsigned long>(failures.load()));
+
+    }
+
+    SharedBufferPoolStats stats = manager.get_pool_stats();
+    printf("Pool: hits %lu, misses %lu, slab grows %lu, rpcmem_alloc %lu, rpcmem_free %lu, idle %lu bytes, "
+           "thread cached %lu bytes, in use %lu bytes\n",
+           static_cast<unsigned long>(stats.hits), static_cast<unsigned long>(stats.misses),
+           static_cast<unsigned long>(stats.slab_grows), static_cast<unsigned long>(stats.rpc_allocs),
+           static_cast<unsigned long>(stats.rpc_frees), static_cast<unsigned long>(stats.bytes_idle),
+           static_cast<unsigned long>(stats.bytes_cached), static_cast<unsigned long>(stats.bytes_in_use));
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "QnnHalf.h"
+#include "QnnStagingPool.h"
+#include "QnnUtils.h"
+
+// StagingPool scaling: FP32 -> FP16 input staging, FP16 buffer copy and
+// FP16 -> FP32 readback over 64-byte aligned buffers, 1..N threads, each
+// reported as time per pass and speedup over one thread.
+
+static uint32_t num_elems = 32 * 4096 * 8 * 4; // a few batches of the linear runner's input
+static uint32_t num_iters = 20;
+static uint32_t max_threads = 0;
+
+static void parse_bench_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--elems") && i + 1 < argc)
+            num_elems = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc)
+            num_iters = static_cast<uint32_t>(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            max_threads = static_cast<uint32_t>(atoi(argv[++i]));
+    }
+}
+
+template <typename T>
+static T *aligned_buffer(size_t n)
+{
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, StagingPool::CACHE_LINE, n * sizeof(T)) != 0)
+        return nullptr;
+    memset(ptr, 0, n * sizeof(T)); // page in before timing
+    return static_cast<T *>(ptr);
+}
+
+template <typename FN>
+static double ms_per_pass(FN pass)
+{
+    pass();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iters; i++)
+        pass();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / num_iters;
+}
+
+int main(int argc, char **argv)
+{
+    parse_bench_arg(argc, argv);
+    if (max_threads == 0)
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("=======================================================\n");
+    printf("StagingPool: %u elements (%.1f MiB fp16), %s conversion, 1..%u threads\n",
+           num_elems, num_elems * 2.0 / (1 << 20), fp16_convert_path(), max_threads);
+    printf("=======================================================\n");
+
+    float *host = aligned_buffer<float>(num_elems);
+    uint16_t *staged = aligned_buffer<uint16_t>(num_elems);
+    uint16_t *copied = aligned_buffer<uint16_t>(num_elems);
+    float *readback = aligned_buffer<float>(num_elems);
+    if (!host || !staged || !copied || !readback)
+    {
+        printf("Failed to allocate staging buffers\n");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < num_elems; i++)
+        host[i] = static_cast<float>(i % 1000) * 0.01f;
+
+    printf("%8s %14s %8s %14s %8s %14s %8s\n", "threads", "stage (ms)", "x", "copy (ms)", "x", "readback (ms)", "x");
+    double base[3] = {0.0, 0.0, 0.0};
+    for (uint32_t threads = 1; threads <= max_threads; threads++)
+    {
+        StagingPool pool(threads);
+        double ms[3];
+        ms[0] = ms_per_pass([&]()
+                            { stage_fp32_to_fp16(pool, host, staged, num_elems); });
+        ms[1] = ms_per_pass([&]()
+                            { stage_copy(pool, copied, staged, num_elems * sizeof(uint16_t)); });
+        ms[2] = ms_per_pass([&]()
+                            { stage_fp16_to_fp32(pool, copied, readback, num_elems); });
+        if (threads == 1)
+            std::copy(ms, ms + 3, base);
+
+        printf("%8u %14.3f %7.2fx %14.3f %7.2fx %14.3f %7.2fx\n", threads,
+               ms[0], base[0] / ms[0], ms[1], base[1] / ms[1], ms[2], base[2] / ms[2]);
+    }
+
+    // Every partition written: the round trip matches the scalar one element for element
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < num_elems; i++)
+        if (readback[i] != fp16_to_fp32(fp32_to_fp16(host[i])))
+            mismatches++;
+    printf("Round trip mismatches: %u\n", mismatches);
+
+    free(host);
+    free(staged);
+    free(copied);
+    free(readback);
+    return mismatches ? -1 : 0;
+}
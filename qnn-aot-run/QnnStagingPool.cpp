@@ -0,0 +1,112 @@
+#include "QnnStagingPool.h"
+#include "QnnHalf.h"
+#include <algorithm>
+#include <cstring>
+
+constexpr size_t StagingPool::CACHE_LINE;
+constexpr size_t StagingPool::MIN_CHUNK_BYTES;
+
+StagingPool::StagingPool(uint32_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (uint32_t i = 1; i < num_threads; i++)
+        workers_.emplace_back(&StagingPool::worker_loop, this, i);
+}
+
+StagingPool::~StagingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto &worker : workers_)
+        worker.join();
+}
+
+void StagingPool::worker_loop(uint32_t index)
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        start_cv_.wait(lock, [&]()
+                       { return stop_ || generation_ != seen; });
+        if (stop_)
+            return;
+
+        seen = generation_;
+        if (index >= parts_)
+            continue;
+
+        const RangeFn &fn = *job_;
+        size_t begin = index * chunk_;
+        size_t end = std::min(n_, begin + chunk_);
+        lock.unlock();
+        fn(begin, end);
+        lock.lock();
+
+        if (--pending_ == 0)
+            done_cv_.notify_one();
+    }
+}
+
+void StagingPool::parallel_for(size_t n, size_t elem_bytes, const RangeFn &fn)
+{
+    if (n == 0)
+        return;
+
+    // Even split rounded up to whole cache lines, but never below the inline threshold
+    size_t line_elems = std::max<size_t>(1, CACHE_LINE / elem_bytes);
+    size_t min_elems = std::max<size_t>(line_elems, MIN_CHUNK_BYTES / elem_bytes);
+    size_t chunk = (n + num_threads() - 1) / num_threads();
+    chunk = std::max(min_elems, (chunk + line_elems - 1) / line_elems * line_elems);
+
+    uint32_t parts = static_cast<uint32_t>((n + chunk - 1) / chunk);
+    if (parts <= 1)
+    {
+        fn(0, n);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &fn;
+        n_ = n;
+        chunk_ = chunk;
+        parts_ = parts;
+        pending_ = parts - 1;
+        generation_++;
+    }
+    start_cv_.notify_all();
+
+    fn(0, chunk);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&]()
+                  { return pending_ == 0; });
+    job_ = nullptr;
+}
+
+void stage_fp32_to_fp16(StagingPool &pool, const float *src, uint16_t *dst, size_t n)
+{
+    pool.parallel_for(n, sizeof(uint16_t), [&](size_t begin, size_t end)
+                      { fp32_to_fp16_array(src + begin, dst + begin, end - begin); });
+}
+
+void stage_fp16_to_fp32(StagingPool &pool, const uint16_t *src, float *dst, size_t n)
+{
+    // Partitioned on the wider output so the float writes split on cache lines
+    pool.parallel_for(n, sizeof(float), [&](size_t begin, size_t end)
+                      { fp16_to_fp32_array(src + begin, dst + begin, end - begin); });
+}
+
+void stage_copy(StagingPool &pool, void *dst, const void *src, size_t bytes)
+{
+    uint8_t *out = static_cast<uint8_t *>(dst);
+    const uint8_t *in = static_cast<const uint8_t *>(src);
+    pool.parallel_for(bytes, 1, [&](size_t begin, size_t end)
+                      { memcpy(out + begin, in + begin, end - begin); });
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent host threads for input staging and output readback.
+ *
+ * parallel_for() splits [0, n) into one contiguous range per thread, the
+ * caller taking the first. Range boundaries fall on 64-byte boundaries of
+ * the element array, so with the 64-byte aligned IOArena slots no two
+ * threads write the same cache line. Work below MIN_CHUNK_BYTES per
+ * thread runs inline on the caller, where waking threads costs more than
+ * it saves.
+ *
+ * One parallel_for() at a time: callers on different threads need their
+ * own pool.
+ */
+class StagingPool
+{
+public:
+    using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t MIN_CHUNK_BYTES = 32 * 1024;
+
+    // 0 uses every core
+    explicit StagingPool(uint32_t num_threads = 0);
+    StagingPool(const StagingPool &) = delete;
+    StagingPool &operator=(const StagingPool &) = delete;
+    ~StagingPool();
+
+    // Worker threads plus the caller
+    uint32_t num_threads() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+    void parallel_for(size_t n, size_t elem_bytes, const RangeFn &fn);
+
+private:
+    void worker_loop(uint32_t index);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const RangeFn *job_{nullptr};
+    size_t n_{0};
+    size_t chunk_{0};
+    uint32_t parts_{0};
+    uint32_t pending_{0};
+    uint64_t generation_{0};
+    bool stop_{false};
+};
+
+// FP32 host data converted into (registered) FP16 buffers and back
+void stage_fp32_to_fp16(StagingPool &pool, const float *src, uint16_t *dst, size_t n);
+void stage_fp16_to_fp32(StagingPool &pool, const uint16_t *src, float *dst, size_t n);
+void stage_copy(StagingPool &pool, void *dst, const void *src, size_t bytes);
@@ -0,0 +1,1554 @@
+/**
+ * Stub QNN backend for host-side overhead benchmarks on Linux.
+ *
+ * Implements the part of the QNN API the AOT tools and the runners use:
+ * contexts with binary save/load, FullyConnected/MatMul graphs with FP16
+ * activations and FP16 or quantized static weights (dequantized to FP16
+ * when the tensor is created), memRegister of rpcmem buffers, execute,
+ * profiling and the HTP perf infrastructure (votes are accepted and
+ * logged). The system interface parses its own context binaries, so the
+ * one library is both the backend and the system library:
+ *   QnnAOT --backend-lib libQnnStub.so ...
+ *   LD_LIBRARY_PATH=<build dir> ./QnnRun --backend stub --bin <binary>
+ *
+ * Execute computes the graph on the CPU (FP32 accumulation), then waits out
+ * the synthetic device latency, so the wall time of a request minus that
+ * latency is what the host side costs. Environment:
+ *   QNN_STUB_EXEC_US  device latency per graphExecute in us (default 0)
+ *   QNN_STUB_COMPUTE  0 skips the math, outputs keep their contents
+ *
+ * graphExecuteAsync is left out so AsyncExecutor emulates it.
+ */
+#include <dlfcn.h>
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "QnnInterface.h"
+#include "System/QnnSystemInterface.h"
+#include "HTP/QnnHtpDevice.h"
+#include "HTP/QnnHtpMem.h"
+#include "HTP/QnnHtpPerfInfrastructure.h"
+#include "QnnHalf.h"
+#include "QnnUtils.h"
+
+namespace
+{
+    constexpr uint32_t STUB_BACKEND_ID = 0x5354;   // outside the QNN_BACKEND_ID_* range
+    constexpr uint32_t BINARY_MAGIC = 0x42545351;  // "QSTB"
+    constexpr uint32_t BINARY_VERSION = 1;
+    // Short waits overshoot in the scheduler, the last stretch spins instead
+    constexpr std::chrono::microseconds SPIN_US{100};
+
+    struct StubSettings
+    {
+        std::chrono::microseconds exec_latency{0};
+        bool compute{true};
+    };
+
+    const StubSettings &settings()
+    {
+        static const StubSettings stub = []
+        {
+            StubSettings s;
+            if (const char *us = getenv("QNN_STUB_EXEC_US"))
+                s.exec_latency = std::chrono::microseconds(strtoull(us, nullptr, 10));
+            if (const char *compute = getenv("QNN_STUB_COMPUTE"))
+                s.compute = strcmp(compute, "0") != 0;
+            return s;
+        }();
+        return stub;
+    }
+
+    uint64_t now_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // ---------------------------------------------------------------
+    // Logging through the callback of logCreate
+    // ---------------------------------------------------------------
+    struct StubLogger
+    {
+        QnnLog_Callback_t callback;
+        QnnLog_Level_t level;
+    };
+
+    std::mutex g_log_mutex;
+    StubLogger *g_logger = nullptr;
+
+    void stub_log(QnnLog_Level_t level, const char *fmt, ...)
+    {
+        std::lock_guard<std::mutex> lock(g_log_mutex);
+        if (g_logger == nullptr || g_logger->callback == nullptr || level > g_logger->level)
+            return;
+
+        va_list args;
+        va_start(args, fmt);
+        g_logger->callback(fmt, level, now_us(), args);
+        va_end(args);
+    }
+
+    // ---------------------------------------------------------------
+    // Contexts and graphs
+    // ---------------------------------------------------------------
+    struct StubTensor
+    {
+        uint32_t id;
+        std::string name;
+        Qnn_TensorType_t type;
+        Qnn_DataType_t data_type;
+        std::vector<uint32_t> dims;
+        int32_t weight{-1}; // index into the context's weights for static tensors
+
+        uint64_t elements() const
+        {
+            uint64_t n = 1;
+            for (uint32_t dim : dims)
+                n *= dim;
+            return n;
+        }
+    };
+
+    struct StubNode
+    {
+        std::string name;
+        std::string type;
+        std::vector<uint32_t> inputs; // tensor indices
+        std::vector<uint32_t> outputs;
+        bool transpose_in1{false};
+        // Filled in by check_node
+        uint32_t rows{0};
+        uint32_t k{0};
+        uint32_t n{0};
+    };
+
+    struct StubContext;
+
+    struct StubGraph
+    {
+        StubContext *context;
+        std::string name;
+        std::vector<StubTensor> tensors; // id is index + 1
+        std::vector<StubNode> nodes;
+        bool finalized{false};
+        std::vector<std::vector<uint16_t>> scratch; // native tensors, by tensor index
+
+        const StubTensor *find(uint32_t id) const
+        {
+            return id >= 1 && id <= tensors.size() ? &tensors[id - 1] : nullptr;
+        }
+    };
+
+    struct StubContext
+    {
+        // Static tensors are shared across the graphs of a context by name, like HTP weight sharing
+        std::vector<std::string> weight_names;
+        std::vector<std::vector<uint16_t>> weights;
+        std::vector<std::unique_ptr<StubGraph>> graphs;
+        std::vector<uint8_t> binary; // built by contextGetBinarySize, released by contextGetBinary
+    };
+
+    struct StubBackend
+    {
+        uint32_t contexts{0};
+    };
+
+    struct StubMem
+    {
+        StubContext *context;
+        void *data;
+        uint64_t size;
+    };
+
+    // Executions are serialized like on the one HTP
+    std::mutex g_device_mutex;
+    std::mutex g_mem_mutex;
+    std::unordered_set<StubMem *> g_mems;
+
+    uint32_t data_type_size(Qnn_DataType_t type)
+    {
+        return (static_cast<uint32_t>(type) & 0xff) / 8;
+    }
+
+    uint64_t tensor_bytes(const StubTensor &tensor)
+    {
+        return tensor.elements() * data_type_size(tensor.data_type);
+    }
+
+    StubGraph *to_graph(Qnn_GraphHandle_t handle) { return reinterpret_cast<StubGraph *>(handle); }
+    StubContext *to_context(Qnn_ContextHandle_t handle) { return reinterpret_cast<StubContext *>(handle); }
+
+    // ---------------------------------------------------------------
+    // Static weights, dequantized to FP16 at creation
+    // ---------------------------------------------------------------
+    bool is_quantized(Qnn_DataType_t type)
+    {
+        return type == QNN_DATATYPE_SFIXED_POINT_8 || type == QNN_DATATYPE_UFIXED_POINT_8 ||
+               type == QNN_DATATYPE_SFIXED_POINT_4 || type == QNN_DATATYPE_UFIXED_POINT_4;
+    }
+
+    // INT4 values are packed two per byte, low nibble first
+    int32_t quantized_value(const uint8_t *data, uint64_t index, Qnn_DataType_t type)
+    {
+        switch (type)
+        {
+        case QNN_DATATYPE_SFIXED_POINT_4:
+        {
+            int32_t nibble = (data[index / 2] >> ((index & 1) * 4)) & 0x0f;
+            return nibble >= 8 ? nibble - 16 : nibble;
+        }
+        case QNN_DATATYPE_UFIXED_POINT_4:
+            return (data[index / 2] >> ((index & 1) * 4)) & 0x0f;
+        case QNN_DATATYPE_SFIXED_POINT_8:
+            return static_cast<int8_t>(data[index]);
+        default:
+            return data[index];
+        }
+    }
+
+    bool dequantize_weight(const Qnn_TensorV1_t &tensor, uint64_t elements, std::vector<uint16_t> &out)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(tensor.clientBuf.data);
+        out.resize(elements);
+
+        if (tensor.dataType == QNN_DATATYPE_FLOAT_16)
+        {
+            if (tensor.clientBuf.dataSize < elements * sizeof(uint16_t))
+                return false;
+            memcpy(out.data(), data, elements * sizeof(uint16_t));
+            return true;
+        }
+
+        if (!is_quantized(tensor.dataType))
+            return false;
+        bool int4 = tensor.dataType == QNN_DATATYPE_SFIXED_POINT_4 || tensor.dataType == QNN_DATATYPE_UFIXED_POINT_4;
+        if (tensor.clientBuf.dataSize < (int4 ? (elements + 1) / 2 : elements))
+            return false;
+
+        const Qnn_QuantizeParams_t &params = tensor.quantizeParams;
+        if (params.quantizationEncoding == QNN_QUANTIZATION_ENCODING_SCALE_OFFSET)
+        {
+            const Qnn_ScaleOffset_t &so = params.scaleOffsetEncoding;
+            for (uint64_t i = 0; i < elements; i++)
+                out[i] = fp32_to_fp16((quantized_value(data, i, tensor.dataType) + so.offset) * so.scale);
+            return true;
+        }
+
+        // Per channel and blockwise encodings, on [rows, cols] weights only
+        if (tensor.rank != 2)
+            return false;
+        uint32_t rows = tensor.dimensions[0];
+        uint32_t cols = tensor.dimensions[1];
+
+        int32_t axis = 0;
+        uint32_t channels = 0;
+        uint32_t num_blocks = 1;
+        switch (params.quantizationEncoding)
+        {
+        case QNN_QUANTIZATION_ENCODING_AXIS_SCALE_OFFSET:
+            axis = params.axisScaleOffsetEncoding.axis;
+            channels = params.axisScaleOffsetEncoding.numScaleOffsets;
+            break;
+        case QNN_QUANTIZATION_ENCODING_BW_AXIS_SCALE_OFFSET:
+            axis = params.bwAxisScaleOffsetEncoding.axis;
+            channels = params.bwAxisScaleOffsetEncoding.numElements;
+            break;
+        case QNN_QUANTIZATION_ENCODING_BLOCKWISE_EXPANSION:
+            if (params.blockwiseExpansion == nullptr)
+                return false;
+            axis = params.blockwiseExpansion->axis;
+            channels = axis == 0 ? rows : cols;
+            num_blocks = params.blockwiseExpansion->numBlocksPerAxis;
+            break;
+        default:
+            return false;
+        }
+
+        uint32_t length = axis == 0 ? cols : rows;
+        if ((axis != 0 && axis != 1) || channels != (axis == 0 ? rows : cols) ||
+            num_blocks == 0 || length % num_blocks != 0)
+            return false;
+        uint32_t block_size = length / num_blocks;
+
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            for (uint32_t c = 0; c < cols; c++)
+            {
+                uint32_t channel = axis == 0 ? r : c;
+                uint32_t block = (axis == 0 ? c : r) / block_size;
+                float scale = 0.0f;
+                int32_t offset = 0;
+                switch (params.quantizationEncoding)
+                {
+                case QNN_QUANTIZATION_ENCODING_AXIS_SCALE_OFFSET:
+                    scale = params.axisScaleOffsetEncoding.scaleOffset[channel].scale;
+                    offset = params.axisScaleOffsetEncoding.scaleOffset[channel].offset;
+                    break;
+                case QNN_QUANTIZATION_ENCODING_BW_AXIS_SCALE_OFFSET:
+                    scale = params.bwAxisScaleOffsetEncoding.scales[channel];
+                    offset = params.bwAxisScaleOffsetEncoding.offsets ? params.bwAxisScaleOffsetEncoding.offsets[channel] : 0;
+                    break;
+                default:
+                {
+                    const Qnn_BlockwiseExpansion_t &bw = *params.blockwiseExpansion;
+                    uint64_t at = static_cast<uint64_t>(channel) * num_blocks + block;
+                    float block_scale = bw.blockScaleStorageType == QNN_BLOCKWISE_EXPANSION_BITWIDTH_SCALE_STORAGE_16
+                                            ? bw.blocksScale16[at]
+                                            : bw.blocksScale8[at];
+                    scale = bw.scaleOffsets[channel].scale * block_scale;
+                    offset = bw.scaleOffsets[channel].offset;
+                    break;
+                }
+                }
+
+                uint64_t index = static_cast<uint64_t>(r) * cols + c;
+                out[index] = fp32_to_fp16((quantized_value(data, index, tensor.dataType) + offset) * scale);
+            }
+        }
+        return true;
+    }
+
+    // ---------------------------------------------------------------
+    // Ops
+    // ---------------------------------------------------------------
+
+    // Shapes of FullyConnected (x, W[n, k], bias[n]) and MatMul (x, W[k, n] or W[n, k] with transpose_in1)
+    bool check_node(const StubGraph &graph, StubNode &node)
+    {
+        bool fc = node.type == QNN_OP_FULLY_CONNECTED;
+        if (!fc && node.type != QNN_OP_MAT_MUL)
+        {
+            stub_log(QNN_LOG_LEVEL_ERROR, "stub: op %s is not supported\n", node.type.c_str());
+            return false;
+        }
+        if (node.inputs.size() < 2 || node.inputs.size() > (fc ? 3u : 2u) || node.outputs.size() != 1)
+            return false;
+
+        for (uint32_t index : node.inputs)
+            if (graph.tensors[index].data_type != QNN_DATATYPE_FLOAT_16)
+                return false;
+        if (graph.tensors[node.outputs[0]].data_type != QNN_DATATYPE_FLOAT_16)
+            return false;
+
+        const StubTensor &x = graph.tensors[node.inputs[0]];
+        const StubTensor &w = graph.tensors[node.inputs[1]];
+        const StubTensor &y = graph.tensors[node.outputs[0]];
+        if (x.dims.empty() || w.dims.size() != 2)
+            return false;
+
+        bool n_first = fc || node.transpose_in1;
+        node.k = x.dims.back();
+        node.n = n_first ? w.dims[0] : w.dims[1];
+        if (node.k == 0 || (n_first ? w.dims[1] : w.dims[0]) != node.k)
+            return false;
+        node.rows = static_cast<uint32_t>(x.elements() / node.k);
+        if (y.elements() != static_cast<uint64_t>(node.rows) * node.n)
+            return false;
+        if (node.inputs.size() == 3 && graph.tensors[node.inputs[2]].elements() != node.n)
+            return false;
+        return true;
+    }
+
+    // y[rows, n] = x[rows, k] * W[n, k]^T + bias
+    void fully_connected(const uint16_t *x, const uint16_t *w, const uint16_t *bias, uint16_t *y,
+                         uint32_t rows, uint32_t k, uint32_t n)
+    {
+        thread_local std::vector<float> xf, wf, yf;
+        xf.resize(static_cast<size_t>(rows) * k);
+        wf.resize(k);
+        yf.resize(static_cast<size_t>(rows) * n);
+        fp16_to_fp32_array(x, xf.data(), xf.size());
+
+        for (uint32_t j = 0; j < n; j++)
+        {
+            fp16_to_fp32_array(w + static_cast<size_t>(j) * k, wf.data(), k);
+            float b = bias ? fp16_to_fp32(bias[j]) : 0.0f;
+            for (uint32_t r = 0; r < rows; r++)
+            {
+                const float *xr = xf.data() + static_cast<size_t>(r) * k;
+                float acc = 0.0f;
+                for (uint32_t i = 0; i < k; i++)
+                    acc += xr[i] * wf[i];
+                yf[static_cast<size_t>(r) * n + j] = acc + b;
+            }
+        }
+        fp32_to_fp16_array(yf.data(), y, yf.size());
+    }
+
+    // y[rows, n] = x[rows, k] * W[k, n]
+    void mat_mul(const uint16_t *x, const uint16_t *w, uint16_t *y, uint32_t rows, uint32_t k, uint32_t n)
+    {
+        thread_local std::vector<float> xf, wf, yf;
+        xf.resize(static_cast<size_t>(rows) * k);
+        wf.resize(n);
+        yf.assign(static_cast<size_t>(rows) * n, 0.0f);
+        fp16_to_fp32_array(x, xf.data(), xf.size());
+
+        for (uint32_t i = 0; i < k; i++)
+        {
+            fp16_to_fp32_array(w + static_cast<size_t>(i) * n, wf.data(), n);
+            for (uint32_t r = 0; r < rows; r++)
+            {
+                float xv = xf[static_cast<size_t>(r) * k + i];
+                float *yr = yf.data() + static_cast<size_t>(r) * n;
+                for (uint32_t j = 0; j < n; j++)
+                    yr[j] += xv * wf[j];
+            }
+        }
+        fp32_to_fp16_array(yf.data(), y, yf.size());
+    }
+
+    void run_node(const StubNode &node, const std::vector<void *> &data)
+    {
+        const uint16_t *x = static_cast<const uint16_t *>(data[node.inputs[0]]);
+        const uint16_t *w = static_cast<const uint16_t *>(data[node.inputs[1]]);
+        uint16_t *y = static_cast<uint16_t *>(data[node.outputs[0]]);
+        if (node.type == QNN_OP_FULLY_CONNECTED || node.transpose_in1)
+        {
+            const uint16_t *bias = node.inputs.size() == 3 ? static_cast<const uint16_t *>(data[node.inputs[2]]) : nullptr;
+            fully_connected(x, w, bias, y, node.rows, node.k, node.n);
+        }
+        else
+        {
+            mat_mul(x, w, y, node.rows, node.k, node.n);
+        }
+    }
+
+    // ---------------------------------------------------------------
+    // Context binary
+    // ---------------------------------------------------------------
+    class BinaryWriter
+    {
+    public:
+        explicit BinaryWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+        void put(const void *data, size_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            out_.insert(out_.end(), bytes, bytes + size);
+        }
+        void put_u32(uint32_t value) { put(&value, sizeof(value)); }
+        void put_u64(uint64_t value) { put(&value, sizeof(value)); }
+        void put_string(const std::string &value)
+        {
+            put_u32(static_cast<uint32_t>(value.size()));
+            put(value.data(), value.size());
+        }
+
+    private:
+        std::vector<uint8_t> &out_;
+    };
+
+    class BinaryReader
+    {
+    public:
+        BinaryReader(const void *data, uint64_t size)
+            : cursor_(static_cast<const uint8_t *>(data)), end_(cursor_ + size) {}
+
+        bool get(void *data, uint64_t size)
+        {
+            if (static_cast<uint64_t>(end_ - cursor_) < size)
+                return false;
+            if (data)
+                memcpy(data, cursor_, size);
+            cursor_ += size;
+            return true;
+        }
+        bool get_u32(uint32_t &value) { return get(&value, sizeof(value)); }
+        bool get_u64(uint64_t &value) { return get(&value, sizeof(value)); }
+        bool get_string(std::string &value)
+        {
+            uint32_t size = 0;
+            if (!get_u32(size) || static_cast<uint64_t>(end_ - cursor_) < size)
+                return false;
+            value.assign(reinterpret_cast<const char *>(cursor_), size);
+            cursor_ += size;
+            return true;
+        }
+
+    private:
+        const uint8_t *cursor_;
+        const uint8_t *end_;
+    };
+
+    // magic, version, weights (name, count, FP16 data), then per finalized graph its tensors and nodes
+    void write_binary(const StubContext &context, std::vector<uint8_t> &out)
+    {
+        out.clear();
+        BinaryWriter writer(out);
+        writer.put_u32(BINARY_MAGIC);
+        writer.put_u32(BINARY_VERSION);
+
+        writer.put_u32(static_cast<uint32_t>(context.weights.size()));
+        for (size_t i = 0; i < context.weights.size(); i++)
+        {
+            writer.put_string(context.weight_names[i]);
+            writer.put_u64(context.weights[i].size());
+            writer.put(context.weights[i].data(), context.weights[i].size() * sizeof(uint16_t));
+        }
+
+        uint32_t num_graphs = 0;
+        for (const auto &graph : context.graphs)
+            num_graphs += graph->finalized ? 1 : 0;
+        writer.put_u32(num_graphs);
+
+        for (const auto &graph : context.graphs)
+        {
+            if (!graph->finalized)
+                continue;
+
+            writer.put_string(graph->name);
+            writer.put_u32(static_cast<uint32_t>(graph->tensors.size()));
+            for (const StubTensor &tensor : graph->tensors)
+            {
+                writer.put_string(tensor.name);
+                writer.put_u32(tensor.type);
+                writer.put_u32(tensor.data_type);
+                writer.put_u32(static_cast<uint32_t>(tensor.dims.size()));
+                for (uint32_t dim : tensor.dims)
+                    writer.put_u32(dim);
+                writer.put_u32(static_cast<uint32_t>(tensor.weight));
+            }
+
+            writer.put_u32(static_cast<uint32_t>(graph->nodes.size()));
+            for (const StubNode &node : graph->nodes)
+            {
+                writer.put_string(node.name);
+                writer.put_string(node.type);
+                writer.put_u32(node.transpose_in1 ? 1 : 0);
+                writer.put_u32(static_cast<uint32_t>(node.inputs.size()));
+                for (uint32_t index : node.inputs)
+                    writer.put_u32(index);
+                writer.put_u32(static_cast<uint32_t>(node.outputs.size()));
+                for (uint32_t index : node.outputs)
+                    writer.put_u32(index);
+            }
+        }
+    }
+
+    // Without `with_weights` the weight data is skipped, enough for the graph infos
+    bool read_binary(const void *buffer, uint64_t size, bool with_weights, StubContext &context)
+    {
+        BinaryReader reader(buffer, size);
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        if (!reader.get_u32(magic) || !reader.get_u32(version) || magic != BINARY_MAGIC || version != BINARY_VERSION)
+        {
+            stub_log(QNN_LOG_LEVEL_ERROR, "stub: not a stub context binary\n");
+            return false;
+        }
+
+        uint32_t num_weights = 0;
+        if (!reader.get_u32(num_weights))
+            return false;
+        context.weight_names.resize(num_weights);
+        context.weights.resize(num_weights);
+        for (uint32_t i = 0; i < num_weights; i++)
+        {
+            uint64_t count = 0;
+            if (!reader.get_string(context.weight_names[i]) || !reader.get_u64(count) ||
+                count > size / sizeof(uint16_t))
+                return false;
+            if (with_weights)
+                context.weights[i].resize(count);
+            if (!reader.get(with_weights ? context.weights[i].data() : nullptr, count * sizeof(uint16_t)))
+                return false;
+        }
+
+        uint32_t num_graphs = 0;
+        if (!reader.get_u32(num_graphs))
+            return false;
+        for (uint32_t g = 0; g < num_graphs; g++)
+        {
+            std::unique_ptr<StubGraph> graph(new StubGraph());
+            graph->context = &context;
+            graph->finalized = true;
+
+            uint32_t num_tensors = 0;
+            if (!reader.get_string(graph->name) || !reader.get_u32(num_tensors))
+                return false;
+            graph->tensors.resize(num_tensors);
+            for (uint32_t t = 0; t < num_tensors; t++)
+            {
+                StubTensor &tensor = graph->tensors[t];
+                uint32_t type = 0, data_type = 0, rank = 0, weight = 0;
+                if (!reader.get_string(tensor.name) || !reader.get_u32(type) || !reader.get_u32(data_type) ||
+                    !reader.get_u32(rank) || rank > 8)
+                    return false;
+                tensor.dims.resize(rank);
+                for (uint32_t &dim : tensor.dims)
+                    if (!reader.get_u32(dim))
+                        return false;
+                if (!reader.get_u32(weight))
+                    return false;
+
+                tensor.id = t + 1;
+                tensor.type = static_cast<Qnn_TensorType_t>(type);
+                tensor.data_type = static_cast<Qnn_DataType_t>(data_type);
+                tensor.weight = static_cast<int32_t>(weight);
+                if (tensor.type == QNN_TENSOR_TYPE_STATIC &&
+                    (tensor.weight < 0 || static_cast<uint32_t>(tensor.weight) >= num_weights))
+                    return false;
+            }
+
+            uint32_t num_nodes = 0;
+            if (!reader.get_u32(num_nodes))
+                return false;
+            graph->nodes.resize(num_nodes);
+            for (StubNode &node : graph->nodes)
+            {
+                uint32_t transpose = 0, num_inputs = 0, num_outputs = 0;
+                if (!reader.get_string(node.name) || !reader.get_string(node.type) ||
+                    !reader.get_u32(transpose) || !reader.get_u32(num_inputs) || num_inputs > num_tensors)
+                    return false;
+                node.transpose_in1 = transpose != 0;
+                node.inputs.resize(num_inputs);
+                for (uint32_t &index : node.inputs)
+                    if (!reader.get_u32(index) || index >= num_tensors)
+                        return false;
+                if (!reader.get_u32(num_outputs) || num_outputs > num_tensors)
+                    return false;
+                node.outputs.resize(num_outputs);
+                for (uint32_t &index : node.outputs)
+                    if (!reader.get_u32(index) || index >= num_tensors)
+                        return false;
+                if (!check_node(*graph, node))
+                    return false;
+            }
+            context.graphs.push_back(std::move(graph));
+        }
+        return true;
+    }
+
+    void prepare_scratch(StubGraph &graph)
+    {
+        graph.scratch.resize(graph.tensors.size());
+        for (size_t i = 0; i < graph.tensors.size(); i++)
+            if (graph.tensors[i].type == QNN_TENSOR_TYPE_NATIVE)
+                graph.scratch[i].resize(graph.tensors[i].elements());
+    }
+
+    // ---------------------------------------------------------------
+    // Profiling
+    // ---------------------------------------------------------------
+    struct StubEvent
+    {
+        QnnProfile_EventData_t data;
+        uint64_t timestamp;
+        std::string identifier;
+        std::vector<QnnProfile_EventId_t> sub_events;
+    };
+
+    struct StubProfile
+    {
+        QnnProfile_Level_t level;
+        uint64_t max_events{0}; // 0 is unbounded
+        std::vector<QnnProfile_EventId_t> events; // top level, oldest first
+        std::vector<QnnProfile_EventId_t> owned;  // every event, freed with the profile
+    };
+
+    std::mutex g_profile_mutex;
+    std::unordered_map<QnnProfile_EventId_t, StubEvent> g_events;
+    QnnProfile_EventId_t g_next_event = 1;
+
+    // Caller holds g_profile_mutex
+    QnnProfile_EventId_t add_event(StubProfile &profile, QnnProfile_EventType_t type, const std::string &identifier,
+                                   uint64_t value_us, uint64_t timestamp)
+    {
+        QnnProfile_EventId_t id = g_next_event++;
+        StubEvent &event = g_events[id];
+        event.identifier = identifier;
+        event.timestamp = timestamp;
+        event.data.type = type;
+        event.data.value = value_us;
+        event.data.identifier = event.identifier.c_str();
+        event.data.unit = QNN_PROFILE_EVENTUNIT_MICROSEC;
+        profile.owned.push_back(id);
+        return id;
+    }
+
+    struct NodeTime
+    {
+        const StubNode *node;
+        uint64_t us;
+    };
+
+    void record_execute(StubProfile &profile, uint64_t start_us, uint64_t device_start_us, uint64_t end_us,
+                        const std::vector<NodeTime> &nodes)
+    {
+        std::lock_guard<std::mutex> lock(g_profile_mutex);
+        if (profile.max_events && profile.events.size() >= profile.max_events)
+            return;
+
+        QnnProfile_EventId_t execute = add_event(profile, QNN_PROFILE_EVENTTYPE_EXECUTE, "QNN (execute) time",
+                                                 end_us - start_us, start_us);
+        QnnProfile_EventId_t device = add_event(profile, QNN_PROFILE_EVENTTYPE_EXECUTE, "Accelerator (execute) time",
+                                                end_us - device_start_us, device_start_us);
+        g_events[execute].sub_events.push_back(device);
+
+        if (profile.level == QNN_PROFILE_LEVEL_DETAILED)
+        {
+            for (const NodeTime &node : nodes)
+            {
+                QnnProfile_EventId_t id = add_event(profile, QNN_PROFILE_EVENTTYPE_NODE, node.node->name, node.us,
+                                                    device_start_us);
+                g_events[device].sub_events.push_back(id);
+            }
+        }
+        profile.events.push_back(execute);
+    }
+
+    // ---------------------------------------------------------------
+    // HTP perf infrastructure: votes are accepted and logged
+    // ---------------------------------------------------------------
+    std::mutex g_perf_mutex;
+    uint32_t g_next_power_config_id = 1;
+
+    Qnn_ErrorHandle_t stub_create_power_config_id(uint32_t device_id, uint32_t core_id, uint32_t *id)
+    {
+        std::lock_guard<std::mutex> lock(g_perf_mutex);
+        *id = g_next_power_config_id++;
+        stub_log(QNN_LOG_LEVEL_INFO, "stub: power config id %u for device %u core %u\n", *id, device_id, core_id);
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_destroy_power_config_id(uint32_t)
+    {
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_set_power_config(uint32_t id, const QnnHtpPerfInfrastructure_PowerConfig_t **configs)
+    {
+        if (configs == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        for (; *configs; configs++)
+        {
+            const QnnHtpPerfInfrastructure_PowerConfig_t &config = **configs;
+            if (config.option == QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_DCVS_V3)
+                stub_log(QNN_LOG_LEVEL_INFO, "stub: power config %u: dcvs %u, power mode %d, corner 0x%x\n", id,
+                         config.dcvsV3Config.dcvsEnable, config.dcvsV3Config.powerMode,
+                         config.dcvsV3Config.coreVoltageCornerTarget);
+            else if (config.option == QNN_HTP_PERF_INFRASTRUCTURE_POWER_CONFIGOPTION_RPC_POLLING_TIME)
+                stub_log(QNN_LOG_LEVEL_INFO, "stub: power config %u: rpc polling %u us\n", id,
+                         config.rpcPollingTimeConfig);
+        }
+        return QNN_SUCCESS;
+    }
+
+    QnnHtpDevice_Infrastructure_t &perf_infrastructure()
+    {
+        static QnnHtpDevice_Infrastructure_t infra = []
+        {
+            QnnHtpDevice_Infrastructure_t i = {};
+            i.infraType = QNN_HTP_DEVICE_INFRASTRUCTURE_TYPE_PERF;
+            i.perfInfra.createPowerConfigId = stub_create_power_config_id;
+            i.perfInfra.destroyPowerConfigId = stub_destroy_power_config_id;
+            i.perfInfra.setPowerConfig = stub_set_power_config;
+            return i;
+        }();
+        return infra;
+    }
+
+    // ---------------------------------------------------------------
+    // QnnInterface
+    // ---------------------------------------------------------------
+    Qnn_ErrorHandle_t stub_property_has_capability(uint32_t key)
+    {
+        return key == QNN_PROPERTY_GROUP_DEVICE ? QNN_PROPERTY_SUPPORTED : QNN_PROPERTY_NOT_SUPPORTED;
+    }
+
+    Qnn_ErrorHandle_t stub_log_create(QnnLog_Callback_t callback, QnnLog_Level_t level, Qnn_LogHandle_t *logger)
+    {
+        if (logger == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        auto *log = new StubLogger{callback, level};
+        {
+            std::lock_guard<std::mutex> lock(g_log_mutex);
+            g_logger = log;
+        }
+        *logger = log;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_log_free(Qnn_LogHandle_t logger)
+    {
+        auto *log = static_cast<StubLogger *>(logger);
+        {
+            std::lock_guard<std::mutex> lock(g_log_mutex);
+            if (g_logger == log)
+                g_logger = nullptr;
+        }
+        delete log;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_backend_create(Qnn_LogHandle_t, const QnnBackend_Config_t **, Qnn_BackendHandle_t *backend)
+    {
+        if (backend == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        *backend = new StubBackend();
+        const StubSettings &stub = settings();
+        stub_log(QNN_LOG_LEVEL_INFO, "stub: backend created, device latency %lu us, compute %s\n",
+                 static_cast<uint64_t>(stub.exec_latency.count()), stub.compute ? "on" : "off");
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_backend_free(Qnn_BackendHandle_t backend)
+    {
+        delete static_cast<StubBackend *>(backend);
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_device_create(Qnn_LogHandle_t, const QnnDevice_Config_t **, Qnn_DeviceHandle_t *device)
+    {
+        if (device == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        // Device configs (SoC, arch) mean nothing here
+        static int stub_device;
+        *device = &stub_device;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_device_free(Qnn_DeviceHandle_t)
+    {
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_device_get_infrastructure(const QnnDevice_Infrastructure_t *infra)
+    {
+        if (infra == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        *const_cast<QnnDevice_Infrastructure_t *>(infra) = reinterpret_cast<QnnDevice_Infrastructure_t>(&perf_infrastructure());
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_context_create(Qnn_BackendHandle_t backend, Qnn_DeviceHandle_t, const QnnContext_Config_t **,
+                                          Qnn_ContextHandle_t *context)
+    {
+        if (backend == nullptr || context == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        static_cast<StubBackend *>(backend)->contexts++;
+        *context = new StubContext();
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_context_get_binary_size(Qnn_ContextHandle_t handle, Qnn_ContextBinarySize_t *size)
+    {
+        StubContext *context = to_context(handle);
+        if (context == nullptr || size == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        write_binary(*context, context->binary);
+        *size = context->binary.size();
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_context_get_binary(Qnn_ContextHandle_t handle, void *buffer, Qnn_ContextBinarySize_t buffer_size,
+                                              Qnn_ContextBinarySize_t *written)
+    {
+        StubContext *context = to_context(handle);
+        if (context == nullptr || buffer == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        if (context->binary.empty())
+            write_binary(*context, context->binary);
+        if (buffer_size < context->binary.size())
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        memcpy(buffer, context->binary.data(), context->binary.size());
+        if (written)
+            *written = context->binary.size();
+        std::vector<uint8_t>().swap(context->binary);
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_context_create_from_binary(Qnn_BackendHandle_t backend, Qnn_DeviceHandle_t,
+                                                      const QnnContext_Config_t **, const void *buffer,
+                                                      Qnn_ContextBinarySize_t size, Qnn_ContextHandle_t *context,
+                                                      Qnn_ProfileHandle_t)
+    {
+        if (backend == nullptr || buffer == nullptr || context == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        std::unique_ptr<StubContext> loaded(new StubContext());
+        if (!read_binary(buffer, size, true, *loaded))
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        for (auto &graph : loaded->graphs)
+            prepare_scratch(*graph);
+
+        stub_log(QNN_LOG_LEVEL_INFO, "stub: context loaded, %zu graph(s), %zu weight(s)\n",
+                 loaded->graphs.size(), loaded->weights.size());
+        static_cast<StubBackend *>(backend)->contexts++;
+        *context = loaded.release();
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_context_free(Qnn_ContextHandle_t handle, Qnn_ProfileHandle_t)
+    {
+        StubContext *context = to_context(handle);
+        if (context == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        // Handles still registered against the context go with it
+        {
+            std::lock_guard<std::mutex> lock(g_mem_mutex);
+            for (auto it = g_mems.begin(); it != g_mems.end();)
+            {
+                if ((*it)->context == context)
+                {
+                    delete *it;
+                    it = g_mems.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+        delete context;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_graph_create(Qnn_ContextHandle_t handle, const char *name, const QnnGraph_Config_t **,
+                                        Qnn_GraphHandle_t *graph)
+    {
+        StubContext *context = to_context(handle);
+        if (context == nullptr || name == nullptr || graph == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        for (const auto &existing : context->graphs)
+            if (existing->name == name)
+                return QNN_GRAPH_ERROR_INVALID_NAME;
+
+        std::unique_ptr<StubGraph> created(new StubGraph());
+        created->context = context;
+        created->name = name;
+        *graph = created.get();
+        context->graphs.push_back(std::move(created));
+        return QNN_SUCCESS;
+    }
+
+    // HTP graph configs (precision, VTCM, HVX threads, optimization level) do not apply
+    Qnn_ErrorHandle_t stub_graph_set_config(Qnn_GraphHandle_t graph, const QnnGraph_Config_t **)
+    {
+        return graph ? QNN_SUCCESS : QNN_COMMON_ERROR_INVALID_ARGUMENT;
+    }
+
+    Qnn_ErrorHandle_t stub_graph_get_property(Qnn_GraphHandle_t graph, QnnGraph_Property_t **)
+    {
+        return graph ? QNN_SUCCESS : QNN_COMMON_ERROR_INVALID_ARGUMENT;
+    }
+
+    Qnn_ErrorHandle_t stub_tensor_create_graph_tensor(Qnn_GraphHandle_t handle, Qnn_Tensor_t *tensor)
+    {
+        StubGraph *graph = to_graph(handle);
+        if (graph == nullptr || tensor == nullptr || graph->finalized)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        // V2 only appends fields to V1, the shared ones are read through v1
+        Qnn_TensorV1_t &v1 = tensor->v1;
+        if (v1.name == nullptr || (v1.rank > 0 && v1.dimensions == nullptr))
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        for (const StubTensor &existing : graph->tensors)
+            if (existing.name == v1.name)
+                return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        StubTensor created;
+        created.id = static_cast<uint32_t>(graph->tensors.size()) + 1;
+        created.name = v1.name;
+        created.type = v1.type;
+        created.data_type = v1.dataType;
+        created.dims.assign(v1.dimensions, v1.dimensions + v1.rank);
+
+        if (created.type == QNN_TENSOR_TYPE_STATIC)
+        {
+            StubContext &context = *graph->context;
+            for (size_t i = 0; i < context.weight_names.size(); i++)
+            {
+                if (context.weight_names[i] == created.name && context.weights[i].size() == created.elements())
+                {
+                    created.weight = static_cast<int32_t>(i);
+                    break;
+                }
+            }
+            if (created.weight < 0)
+            {
+                std::vector<uint16_t> weight;
+                if (!dequantize_weight(v1, created.elements(), weight))
+                {
+                    stub_log(QNN_LOG_LEVEL_ERROR, "stub: static tensor %s has an unsupported type or encoding\n", v1.name);
+                    return QNN_GRAPH_ERROR_UNSUPPORTED_FEATURE;
+                }
+                created.weight = static_cast<int32_t>(context.weights.size());
+                context.weight_names.push_back(created.name);
+                context.weights.push_back(std::move(weight));
+            }
+            created.data_type = QNN_DATATYPE_FLOAT_16;
+        }
+
+        v1.id = created.id;
+        graph->tensors.push_back(std::move(created));
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_graph_add_node(Qnn_GraphHandle_t handle, Qnn_OpConfig_t op)
+    {
+        StubGraph *graph = to_graph(handle);
+        if (graph == nullptr || graph->finalized || op.v1.typeName == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        StubNode node;
+        node.name = op.v1.name ? op.v1.name : "";
+        node.type = op.v1.typeName;
+        for (uint32_t i = 0; i < op.v1.numOfParams; i++)
+        {
+            const Qnn_Param_t &param = op.v1.params[i];
+            if (param.paramType != QNN_PARAMTYPE_SCALAR || param.name == nullptr)
+                continue;
+            bool value = param.scalarParam.dataType == QNN_DATATYPE_BOOL_8 ? param.scalarParam.bool8Value != 0
+                                                                           : param.scalarParam.uint32Value != 0;
+            if (!strcmp(param.name, QNN_OP_MAT_MUL_PARAM_TRANSPOSE_IN1))
+                node.transpose_in1 = value;
+            else if (!strcmp(param.name, QNN_OP_MAT_MUL_PARAM_TRANSPOSE_IN0) && value)
+                return QNN_GRAPH_ERROR_UNSUPPORTED_FEATURE;
+        }
+
+        for (uint32_t i = 0; i < op.v1.numOfInputs; i++)
+        {
+            const StubTensor *tensor = graph->find(op.v1.inputTensors[i].v1.id);
+            if (tensor == nullptr)
+                return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+            node.inputs.push_back(tensor->id - 1);
+        }
+        for (uint32_t i = 0; i < op.v1.numOfOutputs; i++)
+        {
+            const StubTensor *tensor = graph->find(op.v1.outputTensors[i].v1.id);
+            if (tensor == nullptr)
+                return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+            node.outputs.push_back(tensor->id - 1);
+        }
+
+        if (!check_node(*graph, node))
+        {
+            stub_log(QNN_LOG_LEVEL_ERROR, "stub: node %s (%s) does not fit its tensors\n", node.name.c_str(), node.type.c_str());
+            return QNN_GRAPH_ERROR_UNSUPPORTED_FEATURE;
+        }
+        graph->nodes.push_back(std::move(node));
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_graph_finalize(Qnn_GraphHandle_t handle, Qnn_ProfileHandle_t, Qnn_SignalHandle_t)
+    {
+        StubGraph *graph = to_graph(handle);
+        if (graph == nullptr || graph->nodes.empty())
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        prepare_scratch(*graph);
+        graph->finalized = true;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_graph_retrieve(Qnn_ContextHandle_t handle, const char *name, Qnn_GraphHandle_t *graph)
+    {
+        StubContext *context = to_context(handle);
+        if (context == nullptr || name == nullptr || graph == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        for (const auto &candidate : context->graphs)
+        {
+            if (candidate->finalized && candidate->name == name)
+            {
+                *graph = candidate.get();
+                return QNN_SUCCESS;
+            }
+        }
+        return QNN_GRAPH_ERROR_INVALID_NAME;
+    }
+
+    // Resolve one app tensor to its memory: client buffer or registered handle
+    Qnn_ErrorHandle_t bind_tensor(const StubGraph &graph, const Qnn_Tensor_t &tensor, std::vector<void *> &data)
+    {
+        const StubTensor *stub = graph.find(tensor.v1.id);
+        if (stub == nullptr || stub->type == QNN_TENSOR_TYPE_STATIC || stub->type == QNN_TENSOR_TYPE_NATIVE)
+        {
+            stub_log(QNN_LOG_LEVEL_ERROR, "stub: %s is not an app tensor of graph %s\n",
+                     tensor.v1.name ? tensor.v1.name : "(unnamed)", graph.name.c_str());
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        }
+
+        uint64_t bytes = tensor_bytes(*stub);
+        void *ptr = nullptr;
+        if (tensor.v1.memType == QNN_TENSORMEMTYPE_MEMHANDLE)
+        {
+            auto *mem = static_cast<StubMem *>(tensor.v1.memHandle);
+            std::lock_guard<std::mutex> lock(g_mem_mutex);
+            if (g_mems.count(mem) && mem->context == graph.context && mem->size >= bytes)
+                ptr = mem->data;
+        }
+        else if (tensor.v1.clientBuf.dataSize >= bytes)
+        {
+            ptr = tensor.v1.clientBuf.data;
+        }
+
+        if (ptr == nullptr)
+        {
+            stub_log(QNN_LOG_LEVEL_ERROR, "stub: tensor %s has no buffer of %lu bytes\n", stub->name.c_str(), bytes);
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        }
+        data[stub->id - 1] = ptr;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_graph_execute(Qnn_GraphHandle_t handle, const Qnn_Tensor_t *inputs, uint32_t num_inputs,
+                                         Qnn_Tensor_t *outputs, uint32_t num_outputs, Qnn_ProfileHandle_t profile,
+                                         Qnn_SignalHandle_t)
+    {
+        uint64_t start_us = now_us();
+        StubGraph *graph = to_graph(handle);
+        if (graph == nullptr || !graph->finalized)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        thread_local std::vector<void *> data;
+        data.assign(graph->tensors.size(), nullptr);
+        for (uint32_t i = 0; i < num_inputs; i++)
+        {
+            Qnn_ErrorHandle_t err = bind_tensor(*graph, inputs[i], data);
+            if (err != QNN_SUCCESS)
+                return err;
+        }
+        for (uint32_t i = 0; i < num_outputs; i++)
+        {
+            Qnn_ErrorHandle_t err = bind_tensor(*graph, outputs[i], data);
+            if (err != QNN_SUCCESS)
+                return err;
+        }
+
+        for (size_t i = 0; i < graph->tensors.size(); i++)
+        {
+            const StubTensor &tensor = graph->tensors[i];
+            if (tensor.type == QNN_TENSOR_TYPE_STATIC)
+                data[i] = graph->context->weights[tensor.weight].data();
+            else if (tensor.type == QNN_TENSOR_TYPE_NATIVE)
+                data[i] = graph->scratch[i].data();
+            else if (data[i] == nullptr)
+            {
+                stub_log(QNN_LOG_LEVEL_ERROR, "stub: tensor %s of graph %s is not bound\n",
+                         tensor.name.c_str(), graph->name.c_str());
+                return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+            }
+        }
+
+        const StubSettings &stub = settings();
+        thread_local std::vector<NodeTime> node_times;
+        node_times.clear();
+        uint64_t device_start_us;
+        {
+            std::lock_guard<std::mutex> device(g_device_mutex);
+            auto device_start = std::chrono::steady_clock::now();
+            device_start_us = now_us();
+            if (stub.compute)
+            {
+                for (const StubNode &node : graph->nodes)
+                {
+                    uint64_t node_start = now_us();
+                    run_node(node, data);
+                    node_times.push_back({&node, now_us() - node_start});
+                }
+            }
+
+            auto deadline = device_start + stub.exec_latency;
+            if (deadline - std::chrono::steady_clock::now() > SPIN_US)
+                std::this_thread::sleep_until(deadline - SPIN_US);
+            while (std::chrono::steady_clock::now() < deadline)
+                ;
+        }
+
+        if (profile)
+            record_execute(*static_cast<StubProfile *>(profile), start_us, device_start_us, now_us(), node_times);
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_mem_register(Qnn_ContextHandle_t handle, const Qnn_MemDescriptor_t *descriptors,
+                                        uint32_t num_descriptors, Qnn_MemHandle_t *mem_handles)
+    {
+        StubContext *context = to_context(handle);
+        if (context == nullptr || descriptors == nullptr || mem_handles == nullptr)
+            return QNN_MEM_ERROR_INVALID_ARGUMENT;
+
+        // The host libcdsprpc stub maps fds back to its blocks; SharedBuffer loads it RTLD_GLOBAL
+        using FdToAddrFn_t = void *(*)(int);
+        auto fd_to_addr = reinterpret_cast<FdToAddrFn_t>(dlsym(RTLD_DEFAULT, "rpcmem_stub_fd_to_addr"));
+        if (fd_to_addr == nullptr)
+        {
+            stub_log(QNN_LOG_LEVEL_ERROR, "stub: memRegister needs the host libcdsprpc.so\n");
+            return QNN_MEM_ERROR_INVALID_ARGUMENT;
+        }
+
+        for (uint32_t i = 0; i < num_descriptors; i++)
+        {
+            const Qnn_MemDescriptor_t &descriptor = descriptors[i];
+            uint64_t size = data_type_size(descriptor.dataType);
+            for (uint32_t d = 0; d < descriptor.memShape.numDim; d++)
+                size *= descriptor.memShape.dimSize[d];
+
+            uint8_t *data = nullptr;
+            if (descriptor.memType == QNN_MEM_TYPE_ION)
+            {
+                data = static_cast<uint8_t *>(fd_to_addr(descriptor.ionInfo.fd));
+            }
+            else if (descriptor.memType == QNN_MEM_TYPE_CUSTOM && descriptor.customInfo)
+            {
+                auto *htp = static_cast<const QnnMemHtp_Descriptor_t *>(descriptor.customInfo);
+                if (htp->type == QNN_HTP_MEM_SHARED_BUFFER && htp->sharedBufferConfig.offset + size <= htp->size)
+                {
+                    data = static_cast<uint8_t *>(fd_to_addr(htp->sharedBufferConfig.fd));
+                    if (data)
+                        data += htp->sharedBufferConfig.offset;
+                }
+            }
+
+            if (data == nullptr)
+            {
+                stub_log(QNN_LOG_LEVEL_ERROR, "stub: memRegister of descriptor %u failed\n", i);
+                // Roll back what this call registered
+                std::lock_guard<std::mutex> lock(g_mem_mutex);
+                for (uint32_t j = 0; j < i; j++)
+                {
+                    g_mems.erase(static_cast<StubMem *>(mem_handles[j]));
+                    delete static_cast<StubMem *>(mem_handles[j]);
+                    mem_handles[j] = nullptr;
+                }
+                return QNN_MEM_ERROR_INVALID_ARGUMENT;
+            }
+
+            auto *mem = new StubMem{context, data, size};
+            {
+                std::lock_guard<std::mutex> lock(g_mem_mutex);
+                g_mems.insert(mem);
+            }
+            mem_handles[i] = mem;
+        }
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_mem_deregister(const Qnn_MemHandle_t *mem_handles, uint32_t num_handles)
+    {
+        if (mem_handles == nullptr)
+            return QNN_MEM_ERROR_INVALID_ARGUMENT;
+
+        std::lock_guard<std::mutex> lock(g_mem_mutex);
+        Qnn_ErrorHandle_t result = QNN_SUCCESS;
+        for (uint32_t i = 0; i < num_handles; i++)
+        {
+            auto *mem = static_cast<StubMem *>(mem_handles[i]);
+            if (g_mems.erase(mem) == 0)
+            {
+                result = QNN_MEM_ERROR_INVALID_ARGUMENT;
+                continue;
+            }
+            delete mem;
+        }
+        return result;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_create(Qnn_BackendHandle_t backend, QnnProfile_Level_t level, Qnn_ProfileHandle_t *profile)
+    {
+        if (backend == nullptr || profile == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        auto *created = new StubProfile();
+        created->level = level;
+        *profile = created;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_set_config(Qnn_ProfileHandle_t handle, const QnnProfile_Config_t **configs)
+    {
+        auto *profile = static_cast<StubProfile *>(handle);
+        if (profile == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        std::lock_guard<std::mutex> lock(g_profile_mutex);
+        for (; configs && *configs; configs++)
+            if ((*configs)->option == QNN_PROFILE_CONFIG_OPTION_MAX_EVENTS)
+                profile->max_events = (*configs)->numMaxEvents;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_get_events(Qnn_ProfileHandle_t handle, const QnnProfile_EventId_t **events,
+                                              uint32_t *num_events)
+    {
+        auto *profile = static_cast<StubProfile *>(handle);
+        if (profile == nullptr || events == nullptr || num_events == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        std::lock_guard<std::mutex> lock(g_profile_mutex);
+        *events = profile->events.data();
+        *num_events = static_cast<uint32_t>(profile->events.size());
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_get_sub_events(QnnProfile_EventId_t id, const QnnProfile_EventId_t **events,
+                                                  uint32_t *num_events)
+    {
+        if (events == nullptr || num_events == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        std::lock_guard<std::mutex> lock(g_profile_mutex);
+        auto it = g_events.find(id);
+        if (it == g_events.end())
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        *events = it->second.sub_events.data();
+        *num_events = static_cast<uint32_t>(it->second.sub_events.size());
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_get_event_data(QnnProfile_EventId_t id, QnnProfile_EventData_t *data)
+    {
+        if (data == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        std::lock_guard<std::mutex> lock(g_profile_mutex);
+        auto it = g_events.find(id);
+        if (it == g_events.end())
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        *data = it->second.data;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_get_extended_event_data(QnnProfile_EventId_t id, QnnProfile_ExtendedEventData_t *data)
+    {
+        if (data == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        std::lock_guard<std::mutex> lock(g_profile_mutex);
+        auto it = g_events.find(id);
+        if (it == g_events.end())
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        const StubEvent &event = it->second;
+        data->version = QNN_PROFILE_DATA_VERSION_1;
+        data->v1.type = event.data.type;
+        data->v1.value.dataType = QNN_DATATYPE_UINT_32;
+        data->v1.value.uint32Value = static_cast<uint32_t>(event.data.value);
+        data->v1.timestamp = event.timestamp;
+        data->v1.identifier = event.data.identifier;
+        data->v1.unit = event.data.unit;
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_profile_free(Qnn_ProfileHandle_t handle)
+    {
+        auto *profile = static_cast<StubProfile *>(handle);
+        if (profile == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        {
+            std::lock_guard<std::mutex> lock(g_profile_mutex);
+            for (QnnProfile_EventId_t id : profile->owned)
+                g_events.erase(id);
+        }
+        delete profile;
+        return QNN_SUCCESS;
+    }
+
+    // ---------------------------------------------------------------
+    // QnnSystemInterface
+    // ---------------------------------------------------------------
+    struct StubSystemContext
+    {
+        StubContext parsed; // graphs of the last binary, without the weights
+        std::vector<std::vector<Qnn_Tensor_t>> inputs;
+        std::vector<std::vector<Qnn_Tensor_t>> outputs;
+        std::vector<QnnSystemContext_GraphInfo_t> graphs;
+        QnnSystemContext_BinaryInfo_t info;
+    };
+
+    Qnn_Tensor_t graph_info_tensor(const StubTensor &stub)
+    {
+        Qnn_Tensor_t tensor;
+        memset(&tensor, 0, sizeof(tensor));
+        tensor.version = QNN_TENSOR_VERSION_2;
+        tensor.v2.id = stub.id;
+        tensor.v2.name = stub.name.c_str();
+        tensor.v2.type = stub.type;
+        tensor.v2.dataFormat = QNN_TENSOR_DATA_FORMAT_DENSE;
+        tensor.v2.dataType = stub.data_type;
+        tensor.v2.quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
+        tensor.v2.rank = static_cast<uint32_t>(stub.dims.size());
+        tensor.v2.dimensions = const_cast<uint32_t *>(stub.dims.data());
+        tensor.v2.memType = QNN_TENSORMEMTYPE_RAW;
+        return tensor;
+    }
+
+    Qnn_ErrorHandle_t stub_system_context_create(QnnSystemContext_Handle_t *handle)
+    {
+        if (handle == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        *handle = new StubSystemContext();
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_system_context_get_binary_info(QnnSystemContext_Handle_t handle, void *buffer, uint64_t size,
+                                                          const QnnSystemContext_BinaryInfo_t **info,
+                                                          Qnn_ContextBinarySize_t *info_size)
+    {
+        auto *system = static_cast<StubSystemContext *>(handle);
+        if (system == nullptr || buffer == nullptr || info == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        // The pointers handed out stay valid until the next call or systemContextFree
+        system->parsed = StubContext();
+        system->inputs.clear();
+        system->outputs.clear();
+        system->graphs.clear();
+        if (!read_binary(buffer, size, false, system->parsed))
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+
+        size_t num_graphs = system->parsed.graphs.size();
+        system->inputs.resize(num_graphs);
+        system->outputs.resize(num_graphs);
+        system->graphs.resize(num_graphs);
+        for (size_t g = 0; g < num_graphs; g++)
+        {
+            const StubGraph &graph = *system->parsed.graphs[g];
+            for (const StubTensor &tensor : graph.tensors)
+            {
+                if (tensor.type == QNN_TENSOR_TYPE_APP_WRITE)
+                    system->inputs[g].push_back(graph_info_tensor(tensor));
+                else if (tensor.type == QNN_TENSOR_TYPE_APP_READ)
+                    system->outputs[g].push_back(graph_info_tensor(tensor));
+            }
+
+            QnnSystemContext_GraphInfo_t &graph_info = system->graphs[g];
+            memset(&graph_info, 0, sizeof(graph_info));
+            graph_info.version = QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_1;
+            graph_info.graphInfoV1.graphName = graph.name.c_str();
+            graph_info.graphInfoV1.numGraphInputs = static_cast<uint32_t>(system->inputs[g].size());
+            graph_info.graphInfoV1.graphInputs = system->inputs[g].data();
+            graph_info.graphInfoV1.numGraphOutputs = static_cast<uint32_t>(system->outputs[g].size());
+            graph_info.graphInfoV1.graphOutputs = system->outputs[g].data();
+        }
+
+        memset(&system->info, 0, sizeof(system->info));
+        system->info.version = QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_1;
+        system->info.contextBinaryInfoV1.backendId = STUB_BACKEND_ID;
+        system->info.contextBinaryInfoV1.buildId = "stub";
+        system->info.contextBinaryInfoV1.numGraphs = static_cast<uint32_t>(num_graphs);
+        system->info.contextBinaryInfoV1.graphs = system->graphs.data();
+
+        *info = &system->info;
+        if (info_size)
+            *info_size = sizeof(system->info);
+        return QNN_SUCCESS;
+    }
+
+    Qnn_ErrorHandle_t stub_system_context_free(QnnSystemContext_Handle_t handle)
+    {
+        delete static_cast<StubSystemContext *>(handle);
+        return QNN_SUCCESS;
+    }
+
+    QnnInterface_t make_interface()
+    {
+        QnnInterface_t provider;
+        memset(&provider, 0, sizeof(provider));
+        provider.backendId = STUB_BACKEND_ID;
+        provider.providerName = "STUB_QTI_AISW";
+        provider.apiVersion.coreApiVersion = {QNN_API_VERSION_MAJOR, QNN_API_VERSION_MINOR, 0};
+        provider.apiVersion.backendApiVersion = {1, 0, 0};
+
+        QNN_INTERFACE_VER_TYPE &api = provider.QNN_INTERFACE_VER_NAME;
+        api.propertyHasCapability = stub_property_has_capability;
+        api.backendCreate = stub_backend_create;
+        api.backendFree = stub_backend_free;
+        api.contextCreate = stub_context_create;
+        api.contextGetBinarySize = stub_context_get_binary_size;
+        api.contextGetBinary = stub_context_get_binary;
+        api.contextCreateFromBinary = stub_context_create_from_binary;
+        api.contextFree = stub_context_free;
+        api.graphCreate = stub_graph_create;
+        api.graphSetConfig = stub_graph_set_config;
+        api.graphGetProperty = stub_graph_get_property;
+        api.graphAddNode = stub_graph_add_node;
+        api.graphFinalize = stub_graph_finalize;
+        api.graphRetrieve = stub_graph_retrieve;
+        api.graphExecute = stub_graph_execute;
+        api.graphExecuteAsync = nullptr;
+        api.tensorCreateGraphTensor = stub_tensor_create_graph_tensor;
+        api.logCreate = stub_log_create;
+        api.logFree = stub_log_free;
+        api.profileCreate = stub_profile_create;
+        api.profileSetConfig = stub_profile_set_config;
+        api.profileGetEvents = stub_profile_get_events;
+        api.profileGetSubEvents = stub_profile_get_sub_events;
+        api.profileGetEventData = stub_profile_get_event_data;
+        api.profileGetExtendedEventData = stub_profile_get_extended_event_data;
+        api.profileFree = stub_profile_free;
+        api.memRegister = stub_mem_register;
+        api.memDeRegister = stub_mem_deregister;
+        api.deviceGetInfrastructure = stub_device_get_infrastructure;
+        api.deviceCreate = stub_device_create;
+        api.deviceFree = stub_device_free;
+        return provider;
+    }
+
+    QnnSystemInterface_t make_system_interface()
+    {
+        QnnSystemInterface_t provider;
+        memset(&provider, 0, sizeof(provider));
+        provider.backendId = STUB_BACKEND_ID;
+        provider.providerName = "STUB_QTI_SYSTEM";
+        provider.systemApiVersion = {{1, 4, 0}, {1, 0, 0}};
+
+        QNN_SYSTEM_INTERFACE_VER_TYPE &api = provider.QNN_SYSTEM_INTERFACE_VER_NAME;
+        api.systemContextCreate = stub_system_context_create;
+        api.systemContextGetBinaryInfo = stub_system_context_get_binary_info;
+        api.systemContextFree = stub_system_context_free;
+        return provider;
+    }
+}
+
+extern "C"
+{
+    __attribute__((visibility("default")))
+    Qnn_ErrorHandle_t QnnInterface_getProviders(const QnnInterface_t ***providers, uint32_t *num_providers)
+    {
+        static const QnnInterface_t provider = make_interface();
+        static const QnnInterface_t *list[] = {&provider};
+        if (providers == nullptr || num_providers == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        *providers = list;
+        *num_providers = 1;
+        return QNN_SUCCESS;
+    }
+
+    __attribute__((visibility("default")))
+    Qnn_ErrorHandle_t QnnSystemInterface_getProviders(const QnnSystemInterface_t ***providers, uint32_t *num_providers)
+    {
+        static const QnnSystemInterface_t provider = make_system_interface();
+        static const QnnSystemInterface_t *list[] = {&provider};
+        if (providers == nullptr || num_providers == nullptr)
+            return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+        *providers = list;
+        *num_providers = 1;
+        return QNN_SUCCESS;
+    }
+}
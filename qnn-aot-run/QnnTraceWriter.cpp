@@ -0,0 +1,183 @@
+#include "QnnTraceWriter.h"
+#include "QnnProfileCollector.h"
+#include <cstdio>
+
+static constexpr uint32_t HOST_TID = 1;
+
+static std::string json_escape(const std::string &text)
+{
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static bool is_time_unit(QnnProfile_EventUnit_t unit)
+{
+    return unit == QNN_PROFILE_EVENTUNIT_MICROSEC || unit == QNN_PROFILE_EVENTUNIT_CYCLES;
+}
+
+TraceWriter::TraceWriter(bool enabled)
+    : enabled_(enabled), origin_(std::chrono::steady_clock::now())
+{
+    tracks_["host"] = HOST_TID;
+}
+
+double TraceWriter::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin_).count();
+}
+
+void TraceWriter::add_span(const std::string &name, double start_us, double end_us, const char *category)
+{
+    if (!enabled_)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back({name, category, start_us, end_us - start_us, HOST_TID, ""});
+}
+
+uint32_t TraceWriter::device_track(const std::string &name)
+{
+    auto iter = tracks_.find(name);
+    if (iter != tracks_.end())
+        return iter->second;
+
+    uint32_t tid = HOST_TID + static_cast<uint32_t>(tracks_.size());
+    tracks_.insert({name, tid});
+    return tid;
+}
+
+void TraceWriter::add_profile_event(const QnnInterface_t *interface, QnnProfile_EventId_t event,
+                                    const QnnProfile_EventData_t &data, double start_us, double dur_us, uint32_t tid)
+{
+    const char *identifier = data.identifier ? data.identifier : "(unnamed)";
+    char value[96];
+    snprintf(value, sizeof(value), "\"value\": %lu, \"unit\": \"%s\"", data.value, profile_unit_name(data.unit));
+
+    size_t index = events_.size();
+    events_.push_back({identifier, "device", start_us, dur_us, tid, value});
+
+    const QnnProfile_EventId_t *sub_events = nullptr;
+    uint32_t num_sub_events = 0;
+    if (interface->QNN_INTERFACE_VER_NAME.profileGetSubEvents(event, &sub_events, &num_sub_events) != QNN_SUCCESS)
+        return;
+
+    std::vector<QnnProfile_EventData_t> sub_data(num_sub_events);
+    double total_us = 0.0;
+    double total_cycles = 0.0;
+    for (uint32_t i = 0; i < num_sub_events; i++)
+    {
+        if (interface->QNN_INTERFACE_VER_NAME.profileGetEventData(sub_events[i], &sub_data[i]) != QNN_SUCCESS)
+        {
+            sub_data[i].unit = QNN_PROFILE_EVENTUNIT_BACKEND;
+            sub_data[i].value = 0;
+            sub_data[i].identifier = nullptr;
+        }
+
+        if (sub_data[i].unit == QNN_PROFILE_EVENTUNIT_MICROSEC)
+            total_us += sub_data[i].value;
+        else if (sub_data[i].unit == QNN_PROFILE_EVENTUNIT_CYCLES)
+            total_cycles += sub_data[i].value;
+    }
+
+    double us_scale = total_us > dur_us ? dur_us / total_us : 1.0;
+    double cycle_scale = total_cycles > 0 ? dur_us / total_cycles : 0.0;
+    double cursor = start_us;
+    for (uint32_t i = 0; i < num_sub_events; i++)
+    {
+        const QnnProfile_EventData_t &sub = sub_data[i];
+        if (!is_time_unit(sub.unit))
+        {
+            if (sub.identifier)
+            {
+                char arg[64];
+                snprintf(arg, sizeof(arg), ": %lu", sub.value);
+                events_[index].args += ", \"" + json_escape(sub.identifier) + "\"" + arg;
+            }
+            continue;
+        }
+
+        double width = sub.value * (sub.unit == QNN_PROFILE_EVENTUNIT_MICROSEC ? us_scale : cycle_scale);
+        add_profile_event(interface, sub_events[i], sub, cursor, width, tid);
+        cursor += width;
+    }
+}
+
+void TraceWriter::add_profile_events(const QnnInterface_t *interface, const std::vector<QnnProfile_EventId_t> &events,
+                                     double start_us, double end_us)
+{
+    if (!enabled_)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    double span_us = end_us - start_us;
+    for (QnnProfile_EventId_t event : events)
+    {
+        QnnProfile_EventData_t data;
+        if (interface->QNN_INTERFACE_VER_NAME.profileGetEventData(event, &data) != QNN_SUCCESS || !is_time_unit(data.unit))
+            continue;
+
+        // Each top-level event on its own track, they overlap in time
+        uint32_t tid = device_track(data.identifier ? data.identifier : "(unnamed)");
+        double dur_us = span_us;
+        if (data.unit == QNN_PROFILE_EVENTUNIT_MICROSEC && data.value < span_us)
+            dur_us = static_cast<double>(data.value);
+        add_profile_event(interface, event, data, start_us, dur_us, tid);
+    }
+}
+
+bool TraceWriter::write(const std::string &path) const
+{
+    if (!enabled_)
+        return true;
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        printf("Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    fprintf(file, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"qnn-aot-run\"}}");
+    for (const auto &track : tracks_)
+    {
+        fprintf(file, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                track.second, json_escape(track.first).c_str());
+        fprintf(file, ",\n  {\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"sort_index\": %u}}",
+                track.second, track.second);
+    }
+
+    for (const Event &event : events_)
+    {
+        fprintf(file, ",\n  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+                json_escape(event.name).c_str(), event.category, event.tid, event.start_us, event.dur_us);
+        if (!event.args.empty())
+            fprintf(file, ", \"args\": {%s}", event.args.c_str());
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Trace with %zu events written to %s\n", events_.size(), path.c_str());
+    return true;
+}
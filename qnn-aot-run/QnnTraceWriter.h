@@ -0,0 +1,85 @@
+#pragma once
+
+#include "QnnInterface.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Chrome trace (chrome://tracing, ui.perfetto.dev) timeline of one run.
+ *
+ * Host spans (load, register, fill, iteration/execute/profile) are
+ * complete events on the host track, timed with steady_clock relative to
+ * the writer's creation. Profile events of an execution are attached to
+ * the execute span that produced them, one track per top-level event
+ * ("Accelerator (execute) time", ...) with the op-trace sub-events nested
+ * below.
+ *
+ * The backend does not report device timestamps on the host clock, so
+ * each event's sub-events are laid out back to back in reported order
+ * from the parent's start: microsecond events keep their duration (scaled
+ * down only if they overflow the parent), cycle events share the parent's
+ * duration in proportion to their cycles. Byte/count events become args
+ * of their parent slice.
+ */
+class TraceWriter
+{
+public:
+    // A disabled writer records nothing, so call sites need no checks
+    explicit TraceWriter(bool enabled = true);
+
+    bool enabled() const { return enabled_; }
+
+    // Microseconds since the writer was created
+    double now() const;
+
+    void add_span(const std::string &name, double start_us, double end_us, const char *category = "host");
+    void add_profile_events(const QnnInterface_t *interface, const std::vector<QnnProfile_EventId_t> &events,
+                            double start_us, double end_us);
+
+    bool write(const std::string &path) const;
+
+private:
+    struct Event
+    {
+        std::string name;
+        const char *category;
+        double start_us;
+        double dur_us;
+        uint32_t tid;
+        std::string args; // JSON object members, may be empty
+    };
+
+    void add_profile_event(const QnnInterface_t *interface, QnnProfile_EventId_t event,
+                           const QnnProfile_EventData_t &data, double start_us, double dur_us, uint32_t tid);
+    uint32_t device_track(const std::string &name);
+
+    bool enabled_;
+    std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<Event> events_;
+    std::map<std::string, uint32_t> tracks_; // track name -> tid
+};
+
+/**
+ * Records [construction, destruction) as one host span.
+ */
+class TraceSpan
+{
+public:
+    TraceSpan(TraceWriter &trace, const std::string &name)
+        : trace_(trace), name_(name), start_(trace.enabled() ? trace.now() : 0.0) {}
+    ~TraceSpan()
+    {
+        if (trace_.enabled())
+            trace_.add_span(name_, start_, trace_.now());
+    }
+
+private:
+    TraceWriter &trace_;
+    std::string name_;
+    double start_;
+};
@@ -1,11 +1,11 @@
 #include "QnnUtils.h"
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
 
-extern uint32_t input_shape;
-extern uint32_t output_shape;
-
-void parse_arg(int argc, char **argv)
+void parse_arg(int argc, char **argv, uint32_t &input_shape, uint32_t &output_shape)
 {
 	if (argc < 2)
 		return;
@@ -23,13 +23,365 @@ void parse_arg(int argc, char **argv)
 	}
 }
 
+const char *profile_mode_name(ProfileMode mode)
+{
+	switch (mode)
+	{
+	case ProfileMode::OFF:
+		return "off";
+	case ProfileMode::BASIC:
+		return "basic";
+	case ProfileMode::DETAILED:
+		return "detailed";
+	case ProfileMode::SAMPLED:
+		return "sampled";
+	}
+	return "";
+}
+
+const char *backend_type_name(BackendType type)
+{
+	switch (type)
+	{
+	case BackendType::HTP:
+		return "htp";
+	case BackendType::HTP_SIMULATOR:
+		return "htp-sim";
+	case BackendType::CPU:
+		return "cpu";
+	case BackendType::STUB:
+		return "stub";
+	}
+	return "";
+}
+
+bool parse_backend_type(const char *name, BackendType &type)
+{
+	const BackendType types[] = {BackendType::HTP, BackendType::HTP_SIMULATOR, BackendType::CPU, BackendType::STUB};
+	for (BackendType candidate : types)
+	{
+		if (!strcmp(name, backend_type_name(candidate)))
+		{
+			type = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *backend_library(BackendType type)
+{
+	switch (type)
+	{
+	case BackendType::CPU:
+		return "libQnnCpu.so";
+	case BackendType::STUB:
+		return "libQnnStub.so";
+	case BackendType::HTP:
+	case BackendType::HTP_SIMULATOR:
+		break;
+	}
+	return "libQnnHtp.so";
+}
+
+const char *system_library(BackendType type)
+{
+	return type == BackendType::STUB ? "libQnnStub.so" : "libQnnSystem.so";
+}
+
+bool parse_htp_arch(const char *name, uint32_t &arch)
+{
+	if (!strcmp(name, "none"))
+	{
+		arch = 0;
+		return true;
+	}
+
+	uint32_t value = static_cast<uint32_t>(atoi(name[0] == 'v' || name[0] == 'V' ? name + 1 : name));
+	if (value != 68 && value != 69 && value != 73 && value != 75 && value != 79)
+		return false;
+	arch = value;
+	return true;
+}
+
+const char *perf_mode_name(PerfMode mode)
+{
+	switch (mode)
+	{
+	case PerfMode::DEFAULT:
+		return "default";
+	case PerfMode::BURST:
+		return "burst";
+	case PerfMode::SUSTAINED:
+		return "sustained";
+	case PerfMode::BALANCED:
+		return "balanced";
+	case PerfMode::POWER_SAVER:
+		return "power-saver";
+	}
+	return "";
+}
+
+bool parse_perf_mode(const char *name, PerfMode &mode)
+{
+	const PerfMode modes[] = {PerfMode::DEFAULT, PerfMode::BURST, PerfMode::SUSTAINED,
+							  PerfMode::BALANCED, PerfMode::POWER_SAVER};
+	for (PerfMode candidate : modes)
+	{
+		if (!strcmp(name, perf_mode_name(candidate)))
+		{
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void parse_run_arg(int argc, char **argv, RunOptions &options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--bin") && i + 1 < argc)
+		{
+			options.context_bin = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--backend") && i + 1 < argc)
+		{
+			i++;
+			if (!parse_backend_type(argv[i], options.backend))
+				printf("Unknown backend: %s\n", argv[i]);
+		}
+		else if (!strcmp(argv[i], "--load") && i + 1 < argc)
+		{
+			i++;
+			if (!strcmp(argv[i], "mmap"))
+				options.use_mmap = true;
+			else if (!strcmp(argv[i], "read"))
+				options.use_mmap = false;
+			else
+				printf("Unknown load path: %s\n", argv[i]);
+		}
+		else if (!strcmp(argv[i], "--graph") && i + 1 < argc)
+		{
+			options.graph_name = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--rows") && i + 1 < argc)
+		{
+			options.rows = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--bucket-bench"))
+		{
+			options.bucket_bench = true;
+		}
+		else if (!strcmp(argv[i], "--sweep") && i + 1 < argc)
+		{
+			options.sweep_list = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--shard-bench"))
+		{
+			options.shard_bench = true;
+		}
+		else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+		{
+			options.warmup = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--iters") && i + 1 < argc)
+		{
+			options.iterations = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+		{
+			options.json_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--csv") && i + 1 < argc)
+		{
+			options.csv_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--async") && i + 1 < argc)
+		{
+			options.async_depth = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--pipeline") && i + 1 < argc)
+		{
+			options.pipeline_depth = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+		{
+			options.serve_wait_us = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+		{
+			options.serve_rate = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+		{
+			options.trace_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--profile") && i + 1 < argc)
+		{
+			i++;
+			if (!strcmp(argv[i], "off"))
+				options.profile_mode = ProfileMode::OFF;
+			else if (!strcmp(argv[i], "basic"))
+				options.profile_mode = ProfileMode::BASIC;
+			else if (!strcmp(argv[i], "detailed"))
+				options.profile_mode = ProfileMode::DETAILED;
+			else if (!strncmp(argv[i], "sampled:", 8) && atoi(argv[i] + 8) > 0)
+			{
+				options.profile_mode = ProfileMode::SAMPLED;
+				options.profile_every = static_cast<uint32_t>(atoi(argv[i] + 8));
+			}
+			else
+				printf("Unknown profile mode: %s\n", argv[i]);
+		}
+		else if (!strcmp(argv[i], "--profile-bench"))
+		{
+			options.profile_bench = true;
+		}
+		else if (!strcmp(argv[i], "--perf") && i + 1 < argc)
+		{
+			i++;
+			if (!parse_perf_mode(argv[i], options.perf_mode))
+				printf("Unknown perf mode: %s\n", argv[i]);
+		}
+		else if (!strcmp(argv[i], "--serve-perf") && i + 1 < argc)
+		{
+			i++;
+			if (!parse_perf_mode(argv[i], options.serve_perf_mode))
+				printf("Unknown perf mode: %s\n", argv[i]);
+		}
+		else if (!strcmp(argv[i], "--perf-relax") && i + 1 < argc)
+		{
+			options.perf_relax_ms = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--perf-bench"))
+		{
+			options.perf_bench = true;
+		}
+		else if (!strcmp(argv[i], "--staging-threads") && i + 1 < argc)
+		{
+			options.staging_threads = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "--ion"))
+		{
+			options.ion_buffers = true;
+		}
+	}
+	parse_arch_arg(argc, argv, options.htp_arch);
+	parse_backend_lib_arg(argc, argv, options.backend_lib);
+}
+
+void parse_bucket_arg(int argc, char **argv, std::vector<uint32_t> &buckets)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--buckets") || i + 1 >= argc)
+			continue;
+
+		buckets.clear();
+		char *cursor = argv[i + 1];
+		while (*cursor)
+		{
+			char *end = nullptr;
+			unsigned long batch = strtoul(cursor, &end, 10);
+			if (end == cursor)
+				break;
+			if (batch > 0)
+				buckets.push_back(static_cast<uint32_t>(batch));
+			cursor = *end == ',' ? end + 1 : end;
+		}
+	}
+}
+
+void parse_arch_arg(int argc, char **argv, uint32_t &arch)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--arch") || i + 1 >= argc)
+			continue;
+
+		if (!parse_htp_arch(argv[++i], arch))
+			printf("Unknown HTP arch: %s\n", argv[i]);
+	}
+}
+
+void parse_backend_lib_arg(int argc, char **argv, std::string &lib)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--backend-lib") && i + 1 < argc)
+			lib = argv[++i];
+	}
+}
+
+uint64_t get_peak_rss_kb()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// ru_maxrss is already in KiB on Linux/Android
+	return static_cast<uint64_t>(usage.ru_maxrss);
+}
+
+uint64_t get_current_rss_kb()
+{
+	FILE *file = fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return 0;
+
+	unsigned long pages = 0;
+	unsigned long resident = 0;
+	int n = fscanf(file, "%lu %lu", &pages, &resident);
+	fclose(file);
+	if (n != 2)
+		return 0;
+
+	return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// Round to nearest even, subnormals kept, overflow to inf, NaN quieted with
+// the top payload bits kept (what F16C and aarch64 FCVT produce)
 uint16_t fp32_to_fp16(float f)
 {
-	uint32_t x = *(uint32_t *)&f;
-	uint16_t h = ((x >> 16) & 0x8000) |
-				 ((((x & 0x7f800000) - 0x38000000) >> 13) & 0x7c00) |
-				 ((x >> 13) & 0x03ff);
-	return h;
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+
+	uint16_t sign = (x >> 16) & 0x8000;
+	uint32_t abs = x & 0x7fffffff;
+
+	if (abs > 0x7f800000)
+		return sign | 0x7e00 | ((abs >> 13) & 0x03ff);
+	if (abs >= 0x47800000) // 65536 and up, 65520..65535 carry into inf below
+		return sign | 0x7c00;
+
+	uint32_t h;
+	uint32_t rem;
+	uint32_t half;
+	if (abs < 0x38800000)
+	{
+		// Half subnormal: value = m * 2^-24 after shifting out the extra bits
+		uint32_t exp = abs >> 23;
+		if (exp < 102) // below 2^-25, rounds to zero
+			return sign;
+
+		uint32_t mant = (abs & 0x007fffff) | 0x00800000;
+		uint32_t shift = 126 - exp;
+		h = mant >> shift;
+		rem = mant & ((1u << shift) - 1);
+		half = 1u << (shift - 1);
+	}
+	else
+	{
+		h = (abs - 0x38000000) >> 13;
+		rem = abs & 0x1fff;
+		half = 0x1000;
+	}
+
+	// A carry out of the mantissa bumps the exponent, which is the right encoding
+	if (rem > half || (rem == half && (h & 1)))
+		h++;
+	return sign | static_cast<uint16_t>(h);
 }
 
 float fp16_to_fp32(uint16_t h)
@@ -39,10 +391,32 @@ float fp16_to_fp32(uint16_t h)
 	uint32_t mant = (h & 0x03ff);
 
 	uint32_t f;
-	if (exp == 0)
-		f = sign;
+	if (exp == 0x1f)
+	{
+		f = sign | 0x7f800000 | (mant << 13) | (mant ? 0x00400000 : 0);
+	}
+	else if (exp == 0)
+	{
+		if (mant == 0)
+		{
+			f = sign;
+		}
+		else
+		{
+			// Subnormal half is a normal float, normalize the mantissa
+			uint32_t e = 113;
+			while (!(mant & 0x0400))
+			{
+				mant <<= 1;
+				e--;
+			}
+			f = sign | (e << 23) | ((mant & 0x03ff) << 13);
+		}
+	}
 	else
+	{
 		f = sign | ((exp + 112) << 23) | (mant << 13);
+	}
 
 	float out;
 	memcpy(&out, &f, sizeof(out));
@@ -2,8 +2,100 @@
 #define __QNN_UTILS_H__
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
-void parse_arg(int argc, char** argv);
+// off: no profile handle at all, sampled: detailed on every Nth execution only
+enum class ProfileMode
+{
+	OFF,
+	BASIC,
+	DETAILED,
+	SAMPLED,
+};
+
+const char *profile_mode_name(ProfileMode mode);
+
+// Backend library the runners load; the simulator is the x86 build of the HTP library,
+// stub is libQnnStub.so (QnnStubBackend.cpp) for host-side overhead runs
+enum class BackendType
+{
+	HTP,
+	HTP_SIMULATOR,
+	CPU,
+	STUB,
+};
+
+const char *backend_type_name(BackendType type);
+// htp, htp-sim, cpu or stub; false for anything else
+bool parse_backend_type(const char *name, BackendType &type);
+const char *backend_library(BackendType type);
+// The stub parses its own context binaries, every other backend goes through libQnnSystem.so
+const char *system_library(BackendType type);
+// v68, v69, v73, v75, v79 (or the bare number) and none (0); false for anything else
+bool parse_htp_arch(const char *name, uint32_t &arch);
+
+// HTP power votes, see PerfController; default votes nothing and leaves the clocks to DCVS
+enum class PerfMode
+{
+	DEFAULT,
+	BURST,
+	SUSTAINED,
+	BALANCED,
+	POWER_SAVER,
+};
+
+const char *perf_mode_name(PerfMode mode);
+// default, burst, sustained, balanced or power-saver; false for anything else
+bool parse_perf_mode(const char *name, PerfMode &mode);
+
+// Runtime options shared by the runners
+struct RunOptions
+{
+	std::string context_bin;
+	BackendType backend{BackendType::HTP}; // --backend htp|htp-sim|cpu|stub
+	std::string backend_lib; // --backend-lib <path>, empty uses the library of --backend
+	uint32_t htp_arch{73}; // --arch v68|...|v79|none, HTP device arch, none leaves it to the backend
+	bool use_mmap{true}; // --load mmap|read
+	std::string graph_name; // --graph, empty picks the batch bucket for `rows`
+	uint32_t rows{0}; // --rows N, 0 uses the runner's batch_size
+	bool bucket_bench{false}; // --bucket-bench
+	std::string sweep_list; // --sweep <list>, every binary of an AOT --sweep instead of --bin
+	bool shard_bench{false}; // --shard-bench, shard graphs of the layer against the monolithic graph
+	uint32_t warmup{3}; // --warmup N
+	uint32_t iterations{0}; // --iters N, 0 uses the runner's num_iter
+	std::string json_path; // --json <file>
+	std::string csv_path; // --csv <file>, appended
+	uint32_t async_depth{0}; // --async N, 0 skips the graphExecuteAsync pass
+	uint32_t pipeline_depth{0}; // --pipeline N, 0 skips the I/O ring pass
+	int32_t serve_wait_us{-1}; // --serve <max wait us>, -1 skips the batching server pass
+	double serve_rate{1000.0}; // --rate <rows/s> offered to the batching server
+	std::string trace_path; // --trace <file>, Chrome trace JSON of the run
+	ProfileMode profile_mode{ProfileMode::DETAILED}; // --profile off|basic|detailed|sampled:N
+	uint32_t profile_every{1}; // N of sampled:N
+	bool profile_bench{false}; // --profile-bench
+	PerfMode perf_mode{PerfMode::BURST}; // --perf <mode>, voted once the device is up
+	PerfMode serve_perf_mode{PerfMode::SUSTAINED}; // --serve-perf <mode> while the batching server runs
+	uint32_t perf_relax_ms{1000}; // --perf-relax <ms> without executions before the vote is dropped, 0 keeps it
+	bool perf_bench{false}; // --perf-bench
+	uint32_t staging_threads{0}; // --staging-threads N for input staging and readback, 0 uses every core
+	bool ion_buffers{false}; // --ion, one rpcmem buffer per tensor registered as ION instead of offsets in one custom buffer
+};
+
+// --shape IN OUT; leaves both untouched when absent
+void parse_arg(int argc, char** argv, uint32_t &input_shape, uint32_t &output_shape);
+void parse_run_arg(int argc, char **argv, RunOptions &options);
+// --buckets 1,2,4,...; leaves `buckets` untouched when absent
+void parse_bucket_arg(int argc, char **argv, std::vector<uint32_t> &buckets);
+// --arch v68|...|v79|none; leaves `arch` untouched when absent
+void parse_arch_arg(int argc, char **argv, uint32_t &arch);
+// --backend-lib <path>; leaves `lib` untouched when absent
+void parse_backend_lib_arg(int argc, char **argv, std::string &lib);
+
+// Peak resident set size of this process
+uint64_t get_peak_rss_kb();
+// Current resident set size of this process
+uint64_t get_current_rss_kb();
 
 uint16_t fp32_to_fp16(float f);
 float fp16_to_fp32(uint16_t h);
@@ -0,0 +1,540 @@
+#include "QnnWeightQuant.h"
+#include "QnnHalf.h"
+#include "QnnUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QNN_QUANT_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define QNN_QUANT_NEON 1
+#endif
+
+// 4-bit unsigned block scales, as the HTP expands them
+static constexpr uint32_t BLOCK_SCALE_BITS = 4;
+static constexpr uint32_t BLOCK_SCALE_MAX = (1u << BLOCK_SCALE_BITS) - 1;
+
+const char *weight_format_name(WeightFormat format)
+{
+    switch (format)
+    {
+    case WeightFormat::FP16:
+        return "fp16";
+    case WeightFormat::W8_CHANNEL:
+        return "w8";
+    case WeightFormat::W4_CHANNEL:
+        return "w4";
+    case WeightFormat::W8_BLOCK:
+        return "w8-block";
+    case WeightFormat::W4_BLOCK:
+        return "w4-block";
+    }
+    return "";
+}
+
+void parse_weight_quant_arg(int argc, char **argv, WeightQuantConfig &config)
+{
+    const WeightFormat formats[] = {WeightFormat::FP16, WeightFormat::W8_CHANNEL, WeightFormat::W4_CHANNEL,
+                                    WeightFormat::W8_BLOCK, WeightFormat::W4_BLOCK};
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--weights") && i + 1 < argc)
+        {
+            i++;
+            bool known = false;
+            for (WeightFormat format : formats)
+            {
+                if (!strcmp(argv[i], weight_format_name(format)))
+                {
+                    config.format = format;
+                    known = true;
+                }
+            }
+            if (!known)
+                printf("Unknown weight format: %s\n", argv[i]);
+        }
+        else if (!strcmp(argv[i], "--block") && i + 1 < argc)
+        {
+            config.block_size = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--random-weights"))
+        {
+            config.random_weights = true;
+        }
+    }
+}
+
+static bool is_int4(WeightFormat format)
+{
+    return format == WeightFormat::W4_CHANNEL || format == WeightFormat::W4_BLOCK;
+}
+
+static bool is_block(WeightFormat format)
+{
+    return format == WeightFormat::W8_BLOCK || format == WeightFormat::W4_BLOCK;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels: max |x| over a run, running per-column max |x|, and x * inv_scale
+// rounded to nearest even and clamped to [-qmax, qmax]
+// ---------------------------------------------------------------------------
+
+static float absmax_scalar(const float *x, size_t n)
+{
+    float m = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        m = std::max(m, std::fabs(x[i]));
+    return m;
+}
+
+static void absmax_accumulate_scalar(const float *x, float *acc, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        acc[i] = std::max(acc[i], std::fabs(x[i]));
+}
+
+static void quantize_scalar(const float *x, const float *inv_scale, int32_t qmax, int8_t *out, size_t n)
+{
+    float hi = static_cast<float>(qmax);
+    for (size_t i = 0; i < n; i++)
+    {
+        float v = std::min(std::max(x[i] * inv_scale[i], -hi), hi);
+        out[i] = static_cast<int8_t>(std::nearbyint(v));
+    }
+}
+
+#if QNN_QUANT_AVX2
+__attribute__((target("avx2"))) static float absmax_avx2(const float *x, size_t n)
+{
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 m0 = _mm256_setzero_ps();
+    __m256 m1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        m0 = _mm256_max_ps(m0, _mm256_and_ps(_mm256_loadu_ps(x + i), abs_mask));
+        m1 = _mm256_max_ps(m1, _mm256_and_ps(_mm256_loadu_ps(x + i + 8), abs_mask));
+    }
+    m0 = _mm256_max_ps(m0, m1);
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(m0), _mm256_extractf128_ps(m0, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return std::max(_mm_cvtss_f32(m), absmax_scalar(x + i, n - i));
+}
+
+__attribute__((target("avx2"))) static void absmax_accumulate_avx2(const float *x, float *acc, size_t n)
+{
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(acc + i, _mm256_max_ps(_mm256_loadu_ps(acc + i), _mm256_and_ps(_mm256_loadu_ps(x + i), abs_mask)));
+    absmax_accumulate_scalar(x + i, acc + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void quantize_avx2(const float *x, const float *inv_scale, int32_t qmax,
+                                                          int8_t *out, size_t n)
+{
+    const __m256 hi = _mm256_set1_ps(static_cast<float>(qmax));
+    const __m256 lo = _mm256_set1_ps(-static_cast<float>(qmax));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i q[4];
+        for (int j = 0; j < 4; j++)
+        {
+            __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x + i + 8 * j), _mm256_loadu_ps(inv_scale + i + 8 * j));
+            q[j] = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v, lo), hi)); // MXCSR default: nearest even
+        }
+        __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    quantize_scalar(x + i, inv_scale + i, qmax, out + i, n - i);
+}
+#endif
+
+#if QNN_QUANT_NEON
+static float absmax_neon(const float *x, size_t n)
+{
+    float32x4_t m0 = vdupq_n_f32(0.0f);
+    float32x4_t m1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        m0 = vmaxq_f32(m0, vabsq_f32(vld1q_f32(x + i)));
+        m1 = vmaxq_f32(m1, vabsq_f32(vld1q_f32(x + i + 4)));
+    }
+    return std::max(vmaxvq_f32(vmaxq_f32(m0, m1)), absmax_scalar(x + i, n - i));
+}
+
+static void absmax_accumulate_neon(const float *x, float *acc, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(acc + i, vmaxq_f32(vld1q_f32(acc + i), vabsq_f32(vld1q_f32(x + i))));
+    absmax_accumulate_scalar(x + i, acc + i, n - i);
+}
+
+static void quantize_neon(const float *x, const float *inv_scale, int32_t qmax, int8_t *out, size_t n)
+{
+    const float32x4_t hi = vdupq_n_f32(static_cast<float>(qmax));
+    const float32x4_t lo = vdupq_n_f32(-static_cast<float>(qmax));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        float32x4_t a = vmulq_f32(vld1q_f32(x + i), vld1q_f32(inv_scale + i));
+        float32x4_t b = vmulq_f32(vld1q_f32(x + i + 4), vld1q_f32(inv_scale + i + 4));
+        int32x4_t qa = vcvtnq_s32_f32(vminq_f32(vmaxq_f32(a, lo), hi));
+        int32x4_t qb = vcvtnq_s32_f32(vminq_f32(vmaxq_f32(b, lo), hi));
+        vst1_s8(out + i, vqmovn_s16(vcombine_s16(vqmovn_s32(qa), vqmovn_s32(qb))));
+    }
+    quantize_scalar(x + i, inv_scale + i, qmax, out + i, n - i);
+}
+#endif
+
+struct QuantKernels
+{
+    const char *path;
+    float (*absmax)(const float *, size_t);
+    void (*absmax_accumulate)(const float *, float *, size_t);
+    void (*quantize)(const float *, const float *, int32_t, int8_t *, size_t);
+};
+
+static QuantKernels select_kernels()
+{
+#if QNN_QUANT_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {"avx2", absmax_avx2, absmax_accumulate_avx2, quantize_avx2};
+#elif QNN_QUANT_NEON
+    return {"neon", absmax_neon, absmax_accumulate_neon, quantize_neon};
+#endif
+    return {"scalar", absmax_scalar, absmax_accumulate_scalar, quantize_scalar};
+}
+
+static const QuantKernels &kernels()
+{
+    static const QuantKernels selected = select_kernels();
+    return selected;
+}
+
+const char *weight_quant_path()
+{
+    return kernels().path;
+}
+
+// ---------------------------------------------------------------------------
+
+static float effective_scale(const QuantizedWeight &weight, uint32_t channel, uint32_t block)
+{
+    switch (weight.format)
+    {
+    case WeightFormat::W8_CHANNEL:
+        return weight.channel_scales[channel].scale;
+    case WeightFormat::W4_CHANNEL:
+        return weight.bw_scales[channel];
+    case WeightFormat::W8_BLOCK:
+    case WeightFormat::W4_BLOCK:
+        return weight.channel_scales[channel].scale * weight.block_scales[channel * weight.num_blocks + block];
+    case WeightFormat::FP16:
+        break;
+    }
+    return 1.0f;
+}
+
+Qnn_DataType_t QuantizedWeight::data_type() const
+{
+    return is_int4(format) ? QNN_DATATYPE_SFIXED_POINT_4 : QNN_DATATYPE_SFIXED_POINT_8;
+}
+
+Qnn_QuantizeParams_t QuantizedWeight::quantize_params()
+{
+    Qnn_QuantizeParams_t params = QNN_QUANTIZE_PARAMS_INIT;
+    params.encodingDefinition = QNN_DEFINITION_DEFINED;
+
+    uint32_t channels = axis == 0 ? rows : cols;
+    switch (format)
+    {
+    case WeightFormat::W8_CHANNEL:
+        params.quantizationEncoding = QNN_QUANTIZATION_ENCODING_AXIS_SCALE_OFFSET;
+        params.axisScaleOffsetEncoding.axis = static_cast<int32_t>(axis);
+        params.axisScaleOffsetEncoding.numScaleOffsets = channels;
+        params.axisScaleOffsetEncoding.scaleOffset = channel_scales.data();
+        break;
+    case WeightFormat::W4_CHANNEL:
+        params.quantizationEncoding = QNN_QUANTIZATION_ENCODING_BW_AXIS_SCALE_OFFSET;
+        params.bwAxisScaleOffsetEncoding.bitwidth = 4;
+        params.bwAxisScaleOffsetEncoding.axis = static_cast<int32_t>(axis);
+        params.bwAxisScaleOffsetEncoding.numElements = channels;
+        params.bwAxisScaleOffsetEncoding.scales = bw_scales.data();
+        params.bwAxisScaleOffsetEncoding.offsets = bw_offsets.data();
+        break;
+    case WeightFormat::W8_BLOCK:
+    case WeightFormat::W4_BLOCK:
+        blockwise.axis = static_cast<int32_t>(axis);
+        blockwise.scaleOffsets = channel_scales.data();
+        blockwise.numBlocksPerAxis = num_blocks;
+        blockwise.blockScaleBitwidth = BLOCK_SCALE_BITS;
+        blockwise.blockScaleStorageType = QNN_BLOCKWISE_EXPANSION_BITWIDTH_SCALE_STORAGE_8;
+        blockwise.blocksScale8 = block_scales.data();
+        params.quantizationEncoding = QNN_QUANTIZATION_ENCODING_BLOCKWISE_EXPANSION;
+        params.blockwiseExpansion = &blockwise;
+        break;
+    case WeightFormat::FP16:
+        return QNN_QUANTIZE_PARAMS_INIT;
+    }
+    return params;
+}
+
+float QuantizedWeight::dequantize(uint32_t row, uint32_t col) const
+{
+    uint64_t index = static_cast<uint64_t>(row) * cols + col;
+    int32_t q;
+    if (is_int4(format))
+    {
+        uint8_t nibble = (data[index / 2] >> ((index & 1) * 4)) & 0x0f;
+        q = nibble >= 8 ? static_cast<int32_t>(nibble) - 16 : nibble;
+    }
+    else
+    {
+        q = static_cast<int8_t>(data[index]);
+    }
+
+    uint32_t channel = axis == 0 ? row : col;
+    uint32_t k = axis == 0 ? col : row;
+    return q * effective_scale(*this, channel, k / block_size);
+}
+
+bool quantize_weight(const uint16_t *fp16, uint32_t rows, uint32_t cols, uint32_t axis,
+                     const WeightQuantConfig &config, QuantizedWeight &out)
+{
+    const QuantKernels &k = kernels();
+    uint32_t channels = axis == 0 ? rows : cols;
+    uint32_t length = axis == 0 ? cols : rows;
+
+    out.format = config.format;
+    out.rows = rows;
+    out.cols = cols;
+    out.axis = axis;
+    out.block_size = is_block(config.format) ? config.block_size : length;
+    if (config.format == WeightFormat::FP16 || out.block_size == 0 || length % out.block_size != 0)
+    {
+        printf("quantize_weight: %s with block %u does not fit %u x %u\n",
+               weight_format_name(config.format), config.block_size, rows, cols);
+        return false;
+    }
+    if (is_int4(config.format) && cols % 2 != 0)
+    {
+        printf("quantize_weight: INT4 packing needs an even number of columns, got %u\n", cols);
+        return false;
+    }
+    out.num_blocks = length / out.block_size;
+
+    // Pass 1: max |w| per (channel, block)
+    uint32_t num_blocks = out.num_blocks;
+    std::vector<float> block_max(static_cast<size_t>(channels) * num_blocks, 0.0f);
+    std::vector<float> row(cols);
+    if (axis == 0)
+    {
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            fp16_to_fp32_array(fp16 + static_cast<uint64_t>(r) * cols, row.data(), cols);
+            for (uint32_t b = 0; b < num_blocks; b++)
+                block_max[r * num_blocks + b] = k.absmax(row.data() + b * out.block_size, out.block_size);
+        }
+    }
+    else
+    {
+        std::vector<float> col_max(cols);
+        for (uint32_t b = 0; b < num_blocks; b++)
+        {
+            std::fill(col_max.begin(), col_max.end(), 0.0f);
+            for (uint32_t r = b * out.block_size; r < (b + 1) * out.block_size; r++)
+            {
+                fp16_to_fp32_array(fp16 + static_cast<uint64_t>(r) * cols, row.data(), cols);
+                k.absmax_accumulate(row.data(), col_max.data(), cols);
+            }
+            for (uint32_t c = 0; c < cols; c++)
+                block_max[c * num_blocks + b] = col_max[c];
+        }
+    }
+
+    // Scales: symmetric, so nothing inside [-max, max] clips
+    int32_t qmax = is_int4(config.format) ? 7 : 127;
+    out.channel_scales.assign(channels, {1.0f, 0});
+    out.bw_scales.clear();
+    out.bw_offsets.clear();
+    out.block_scales.clear();
+    if (is_block(config.format))
+    {
+        // Per channel float scale times a 4-bit integer per block, rounded up so blocks never clip
+        out.block_scales.assign(static_cast<size_t>(channels) * num_blocks, 1);
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            const float *maxes = block_max.data() + static_cast<size_t>(c) * num_blocks;
+            float channel_max = *std::max_element(maxes, maxes + num_blocks);
+            if (channel_max == 0.0f)
+                continue;
+
+            float scale = channel_max / qmax / BLOCK_SCALE_MAX;
+            out.channel_scales[c].scale = scale;
+            for (uint32_t b = 0; b < num_blocks; b++)
+            {
+                float steps = std::ceil(maxes[b] / qmax / scale);
+                out.block_scales[c * num_blocks + b] =
+                    static_cast<uint8_t>(std::min<float>(std::max(steps, 1.0f), BLOCK_SCALE_MAX));
+            }
+        }
+    }
+    else
+    {
+        for (uint32_t c = 0; c < channels; c++)
+            if (block_max[c] > 0.0f)
+                out.channel_scales[c].scale = block_max[c] / qmax;
+
+        if (config.format == WeightFormat::W4_CHANNEL)
+        {
+            for (const Qnn_ScaleOffset_t &so : out.channel_scales)
+                out.bw_scales.push_back(so.scale);
+            out.bw_offsets.assign(channels, 0);
+            out.channel_scales.clear();
+        }
+    }
+
+    // Pass 2: quantize row by row with the per element inverse scale
+    uint64_t elements = static_cast<uint64_t>(rows) * cols;
+    out.data.assign(is_int4(config.format) ? elements / 2 : elements, 0);
+    std::vector<float> inv_scale(cols);
+    std::vector<int8_t> q(cols);
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        if (axis == 0)
+        {
+            for (uint32_t c = 0; c < cols; c++)
+                inv_scale[c] = 1.0f / effective_scale(out, r, c / out.block_size);
+        }
+        else if (r % out.block_size == 0)
+        {
+            for (uint32_t c = 0; c < cols; c++)
+                inv_scale[c] = 1.0f / effective_scale(out, c, r / out.block_size);
+        }
+
+        uint64_t base = static_cast<uint64_t>(r) * cols;
+        fp16_to_fp32_array(fp16 + base, row.data(), cols);
+        k.quantize(row.data(), inv_scale.data(), qmax, q.data(), cols);
+
+        if (is_int4(config.format))
+        {
+            uint8_t *packed = out.data.data() + base / 2;
+            for (uint32_t c = 0; c < cols; c += 2)
+                packed[c / 2] = (static_cast<uint8_t>(q[c]) & 0x0f) | (static_cast<uint8_t>(q[c + 1]) << 4);
+        }
+        else
+        {
+            memcpy(out.data.data() + base, q.data(), cols);
+        }
+    }
+
+    return true;
+}
+
+WeightQuantError measure_quant_error(const uint16_t *fp16, const QuantizedWeight &weight,
+                                     uint32_t num_inputs, uint32_t num_channels)
+{
+    uint32_t channels = weight.axis == 0 ? weight.rows : weight.cols;
+    uint32_t length = weight.axis == 0 ? weight.cols : weight.rows;
+    num_channels = std::min(num_channels, channels);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<std::vector<float>> inputs(num_inputs, std::vector<float>(length));
+    for (auto &input : inputs)
+        for (float &x : input)
+            x = uniform(rng);
+
+    double w_err = 0.0;
+    double w_ref = 0.0;
+    double y_err = 0.0;
+    double y_ref = 0.0;
+    double y_max = 0.0;
+    std::vector<float> w(length);
+    std::vector<float> wq(length);
+    for (uint32_t i = 0; i < num_channels; i++)
+    {
+        uint32_t c = static_cast<uint32_t>(static_cast<uint64_t>(i) * channels / num_channels);
+        for (uint32_t k = 0; k < length; k++)
+        {
+            uint32_t r = weight.axis == 0 ? c : k;
+            uint32_t col = weight.axis == 0 ? k : c;
+            w[k] = fp16_to_fp32(fp16[static_cast<uint64_t>(r) * weight.cols + col]);
+            wq[k] = weight.dequantize(r, col);
+            w_err += (static_cast<double>(wq[k]) - w[k]) * (static_cast<double>(wq[k]) - w[k]);
+            w_ref += static_cast<double>(w[k]) * w[k];
+        }
+
+        for (const auto &input : inputs)
+        {
+            double ref = 0.0;
+            double got = 0.0;
+            for (uint32_t k = 0; k < length; k++)
+            {
+                ref += static_cast<double>(input[k]) * w[k];
+                got += static_cast<double>(input[k]) * wq[k];
+            }
+            y_err += (got - ref) * (got - ref);
+            y_ref += ref * ref;
+            y_max = std::max(y_max, std::fabs(got - ref));
+        }
+    }
+
+    WeightQuantError error;
+    error.weight_rel_rms = w_ref > 0 ? std::sqrt(w_err / w_ref) : 0.0;
+    error.output_rel_rms = y_ref > 0 ? std::sqrt(y_err / y_ref) : 0.0;
+    error.output_max_abs = y_max;
+    return error;
+}
+
+void fill_random_weights(std::vector<uint16_t> &weights, uint32_t fan_in)
+{
+    // Uniform with variance 1/fan_in; xorshift keeps a 1G element fill at memory speed
+    float bound = std::sqrt(3.0f / fan_in);
+    uint32_t state = 0x9e3779b9u;
+    std::vector<float> chunk(4096);
+    for (size_t base = 0; base < weights.size(); base += chunk.size())
+    {
+        size_t n = std::min(chunk.size(), weights.size() - base);
+        for (size_t i = 0; i < n; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            chunk[i] = (static_cast<float>(state) * (1.0f / 4294967296.0f) * 2.0f - 1.0f) * bound;
+        }
+        fp32_to_fp16_array(chunk.data(), weights.data() + base, n);
+    }
+}
+
+void print_weight_quant_report(const uint16_t *fp16, const QuantizedWeight &weight, double quantize_ms)
+{
+    uint64_t fp16_bytes = static_cast<uint64_t>(weight.rows) * weight.cols * sizeof(uint16_t);
+    uint64_t scale_bytes = weight.channel_scales.size() * sizeof(Qnn_ScaleOffset_t) +
+                           weight.bw_scales.size() * (sizeof(float) + sizeof(int32_t)) +
+                           weight.block_scales.size();
+
+    printf("Weights %s [%u x %u, axis %u", weight_format_name(weight.format), weight.rows, weight.cols, weight.axis);
+    if (is_block(weight.format))
+        printf(", block %u", weight.block_size);
+    printf("]: %lu bytes + %lu bytes of scales (fp16 %lu bytes, %.2fx smaller), quantized in %.1f ms (%s)\n",
+           static_cast<uint64_t>(weight.data.size()), scale_bytes, fp16_bytes,
+           static_cast<double>(fp16_bytes) / (weight.data.size() + scale_bytes), quantize_ms, weight_quant_path());
+
+    WeightQuantError error = measure_quant_error(fp16, weight);
+    printf("Accuracy vs fp16: weight rel RMS %.3e, output rel RMS %.3e, output max abs %.3e\n",
+           error.weight_rel_rms, error.output_rel_rms, error.output_max_abs);
+}
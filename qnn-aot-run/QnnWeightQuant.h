@@ -0,0 +1,83 @@
+#pragma once
+
+#include "QnnTypes.h"
+#include <cstdint>
+#include <vector>
+
+// --weights fp16|w8|w4|w8-block|w4-block
+enum class WeightFormat
+{
+    FP16,
+    W8_CHANNEL, // INT8, one scale per output channel
+    W4_CHANNEL, // INT4 packed two per byte, one scale per output channel
+    W8_BLOCK,   // INT8, per channel scale expanded by a 4-bit scale per block
+    W4_BLOCK,   // INT4 packed, same block scales (LPBQ)
+};
+
+struct WeightQuantConfig
+{
+    WeightFormat format{WeightFormat::FP16};
+    uint32_t block_size{64}; // --block N, along the input dimension
+    bool random_weights{false}; // --random-weights instead of all ones, which quantize exactly
+};
+
+const char *weight_format_name(WeightFormat format);
+// --weights, --block and --random-weights; leaves `config` untouched when absent
+void parse_weight_quant_arg(int argc, char **argv, WeightQuantConfig &config);
+
+/**
+ * Static weight quantized on the host, symmetric (offset 0) so the HTP can
+ * run it as W8A16/W4A16 against FP16 activations.
+ *
+ * The weight is a row-major [rows, cols] matrix whose output channels lie
+ * along `axis` (0 for FullyConnected [N, K], 1 for MatMul [K, N]); blocks
+ * run along the other axis. INT4 values are packed two per byte, low
+ * nibble first, in row-major element order.
+ *
+ * quantize_params() points into this object, which must outlive the
+ * tensorCreateGraphTensor calls that use it.
+ */
+struct QuantizedWeight
+{
+    WeightFormat format;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t axis;
+    uint32_t block_size;
+    uint32_t num_blocks; // per channel, 1 for per-channel formats
+
+    std::vector<uint8_t> data;
+    std::vector<Qnn_ScaleOffset_t> channel_scales; // W8_CHANNEL, block formats
+    std::vector<float> bw_scales;                  // W4_CHANNEL
+    std::vector<int32_t> bw_offsets;               // W4_CHANNEL
+    std::vector<uint8_t> block_scales;             // [channel][block], block formats
+    Qnn_BlockwiseExpansion_t blockwise;
+
+    Qnn_DataType_t data_type() const;
+    Qnn_QuantizeParams_t quantize_params();
+    // Value the backend reconstructs for element (row, col)
+    float dequantize(uint32_t row, uint32_t col) const;
+};
+
+bool quantize_weight(const uint16_t *fp16, uint32_t rows, uint32_t cols, uint32_t axis,
+                     const WeightQuantConfig &config, QuantizedWeight &out);
+
+struct WeightQuantError
+{
+    double weight_rel_rms;   // ||W_q - W|| / ||W|| over the sampled channels
+    double output_rel_rms;   // same for x . W against random inputs
+    double output_max_abs;
+};
+
+// Seeded uniform weights with variance 1/fan_in
+void fill_random_weights(std::vector<uint16_t> &weights, uint32_t fan_in);
+
+// Accuracy against the FP16 weight on `num_channels` evenly spaced channels
+WeightQuantError measure_quant_error(const uint16_t *fp16, const QuantizedWeight &weight,
+                                     uint32_t num_inputs = 4, uint32_t num_channels = 256);
+
+// "avx2", "neon" or "scalar"
+const char *weight_quant_path();
+
+// Sizes, quantization time and measure_quant_error()
+void print_weight_quant_report(const uint16_t *fp16, const QuantizedWeight &weight, double quantize_ms);
@@ -0,0 +1,499 @@
+#include "QnnWeightSource.h"
+#include "QnnHalf.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Elements converted between page drops
+static constexpr uint64_t CHUNK_ELEMS = 1u << 20;
+// Source rows per block when transposing
+static constexpr uint32_t TRANSPOSE_ROWS = 64;
+
+const char *weight_dtype_name(WeightDType dtype)
+{
+    switch (dtype)
+    {
+    case WeightDType::F16:
+        return "f16";
+    case WeightDType::BF16:
+        return "bf16";
+    case WeightDType::F32:
+        return "f32";
+    }
+    return "";
+}
+
+void parse_weight_source_arg(int argc, char **argv, WeightSourceConfig &config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--weight-file") && i + 1 < argc)
+            config.path = argv[++i];
+        else if (!strcmp(argv[i], "--weight-name") && i + 1 < argc)
+            config.weight_name = argv[++i];
+        else if (!strcmp(argv[i], "--bias-name") && i + 1 < argc)
+            config.bias_name = argv[++i];
+        else if (!strcmp(argv[i], "--weight-transposed"))
+            config.transposed = true;
+    }
+}
+
+static uint32_t dtype_bytes(WeightDType dtype)
+{
+    return dtype == WeightDType::F32 ? 4 : 2;
+}
+
+bool WeightFile::open(const std::string &path)
+{
+    release();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        printf("Failed to open weight file %s\n", path.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        printf("Failed to stat weight file %s\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        printf("Failed to mmap weight file %s\n", path.c_str());
+        return false;
+    }
+
+    // Tensors are consumed front to back
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+    path_ = path;
+    data_ = static_cast<uint8_t *>(addr);
+    size_ = st.st_size;
+
+    bool is_npy = size_ >= 6 && memcmp(data_, "\x93NUMPY", 6) == 0;
+    if (!(is_npy ? parse_npy() : parse_safetensors()))
+    {
+        printf("Failed to parse %s as %s\n", path.c_str(), is_npy ? ".npy" : ".safetensors");
+        release();
+        return false;
+    }
+
+    printf("Mapped %s: %zu tensor(s), %lu bytes\n", path.c_str(), tensors_.size(), size_);
+    return true;
+}
+
+void WeightFile::release()
+{
+    if (data_)
+        munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    tensors_.clear();
+}
+
+const WeightTensor *WeightFile::find(const std::string &name) const
+{
+    if (tensors_.size() == 1 && tensors_[0].name.empty())
+        return &tensors_[0];
+
+    for (const WeightTensor &tensor : tensors_)
+        if (tensor.name == name)
+            return &tensor;
+    return nullptr;
+}
+
+bool WeightFile::matrix_shape(const std::string &name, bool transposed, uint32_t &rows, uint32_t &cols) const
+{
+    const WeightTensor *tensor = find(name);
+    if (tensor == nullptr || tensor->shape.size() != 2)
+        return false;
+
+    rows = static_cast<uint32_t>(tensor->shape[transposed ? 1 : 0]);
+    cols = static_cast<uint32_t>(tensor->shape[transposed ? 0 : 1]);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// .npy: magic, version, header length, then a Python dict literal such as
+// {'descr': '<f4', 'fortran_order': False, 'shape': (4096, 1024), }
+// ---------------------------------------------------------------------------
+
+bool WeightFile::parse_npy()
+{
+    if (size_ < 10)
+        return false;
+
+    uint8_t major = data_[6];
+    uint64_t header_len;
+    uint64_t header_start;
+    if (major == 1)
+    {
+        header_len = data_[8] | (data_[9] << 8);
+        header_start = 10;
+    }
+    else
+    {
+        if (size_ < 12)
+            return false;
+        header_len = data_[8] | (data_[9] << 8) | (data_[10] << 16) | (static_cast<uint64_t>(data_[11]) << 24);
+        header_start = 12;
+    }
+    if (header_start + header_len > size_)
+        return false;
+
+    std::string header(reinterpret_cast<const char *>(data_ + header_start), header_len);
+
+    WeightTensor tensor;
+    size_t descr = header.find("'descr'");
+    if (descr == std::string::npos)
+        return false;
+    size_t quote = header.find('\'', header.find(':', descr));
+    std::string type = header.substr(quote + 1, header.find('\'', quote + 1) - quote - 1);
+    if (type == "<f2" || type == "|f2")
+        tensor.dtype = WeightDType::F16;
+    else if (type == "<f4")
+        tensor.dtype = WeightDType::F32;
+    else
+    {
+        printf("Unsupported npy dtype %s\n", type.c_str());
+        return false;
+    }
+
+    size_t shape = header.find("'shape'");
+    if (shape == std::string::npos)
+        return false;
+    const char *cursor = header.c_str() + header.find('(', shape) + 1;
+    while (*cursor && *cursor != ')')
+    {
+        if (*cursor >= '0' && *cursor <= '9')
+        {
+            char *next;
+            tensor.shape.push_back(strtoull(cursor, &next, 10));
+            cursor = next;
+        }
+        else
+        {
+            cursor++;
+        }
+    }
+
+    // Column-major on disk is the row-major transpose
+    size_t order = header.find("'fortran_order'");
+    if (order != std::string::npos && header.compare(header.find(':', order) + 2, 4, "True") == 0)
+        std::reverse(tensor.shape.begin(), tensor.shape.end());
+
+    uint64_t elements = 1;
+    for (uint64_t dim : tensor.shape)
+        elements *= dim;
+
+    tensor.data = data_ + header_start + header_len;
+    tensor.bytes = elements * dtype_bytes(tensor.dtype);
+    if (header_start + header_len + tensor.bytes > size_)
+        return false;
+
+    tensors_.push_back(tensor);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// safetensors: u64 header size, JSON header mapping names to
+// {"dtype": "F16", "shape": [..], "data_offsets": [begin, end]}, then data.
+// Only the subset of JSON the format uses is understood.
+// ---------------------------------------------------------------------------
+
+namespace
+{
+struct JsonCursor
+{
+    const char *p;
+    const char *end;
+
+    void skip_ws()
+    {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+            p++;
+    }
+
+    bool consume(char c)
+    {
+        skip_ws();
+        if (p < end && *p == c)
+        {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    bool string(std::string &out)
+    {
+        out.clear();
+        if (!consume('"'))
+            return false;
+        while (p < end && *p != '"')
+        {
+            if (*p == '\\' && p + 1 < end)
+                p++;
+            out += *p++;
+        }
+        return consume('"');
+    }
+
+    bool number(uint64_t &out)
+    {
+        skip_ws();
+        char *next;
+        out = strtoull(p, &next, 10);
+        if (next == p)
+            return false;
+        p = next;
+        return true;
+    }
+
+    bool numbers(std::vector<uint64_t> &out)
+    {
+        out.clear();
+        if (!consume('['))
+            return false;
+        if (consume(']'))
+            return true;
+        do
+        {
+            uint64_t value;
+            if (!number(value))
+                return false;
+            out.push_back(value);
+        } while (consume(','));
+        return consume(']');
+    }
+
+    // Any value, for keys we do not use (__metadata__)
+    bool skip()
+    {
+        skip_ws();
+        if (p >= end)
+            return false;
+        if (*p == '"')
+        {
+            std::string ignored;
+            return string(ignored);
+        }
+        if (*p == '{' || *p == '[')
+        {
+            char close = *p == '{' ? '}' : ']';
+            p++;
+            if (consume(close))
+                return true;
+            do
+            {
+                if (close == '}')
+                {
+                    std::string key;
+                    if (!string(key) || !consume(':'))
+                        return false;
+                }
+                if (!skip())
+                    return false;
+            } while (consume(','));
+            return consume(close);
+        }
+        while (p < end && *p != ',' && *p != '}' && *p != ']')
+            p++;
+        return true;
+    }
+};
+} // namespace
+
+bool WeightFile::parse_safetensors()
+{
+    if (size_ < 8)
+        return false;
+
+    uint64_t header_len = 0;
+    memcpy(&header_len, data_, sizeof(header_len));
+    if (8 + header_len > size_)
+        return false;
+
+    const uint8_t *payload = data_ + 8 + header_len;
+    uint64_t payload_size = size_ - 8 - header_len;
+
+    JsonCursor json{reinterpret_cast<const char *>(data_ + 8), reinterpret_cast<const char *>(payload)};
+    if (!json.consume('{'))
+        return false;
+    if (json.consume('}'))
+        return true;
+
+    do
+    {
+        std::string name;
+        if (!json.string(name) || !json.consume(':'))
+            return false;
+        if (name == "__metadata__")
+        {
+            if (!json.skip())
+                return false;
+            continue;
+        }
+
+        WeightTensor tensor;
+        tensor.name = name;
+        std::string dtype;
+        std::vector<uint64_t> offsets;
+        if (!json.consume('{'))
+            return false;
+        do
+        {
+            std::string key;
+            if (!json.string(key) || !json.consume(':'))
+                return false;
+            bool ok = key == "dtype"          ? json.string(dtype)
+                      : key == "shape"        ? json.numbers(tensor.shape)
+                      : key == "data_offsets" ? json.numbers(offsets)
+                                              : json.skip();
+            if (!ok)
+                return false;
+        } while (json.consume(','));
+        if (!json.consume('}') || offsets.size() != 2 || offsets[0] > offsets[1] || offsets[1] > payload_size)
+            return false;
+
+        if (dtype == "F16")
+            tensor.dtype = WeightDType::F16;
+        else if (dtype == "BF16")
+            tensor.dtype = WeightDType::BF16;
+        else if (dtype == "F32")
+            tensor.dtype = WeightDType::F32;
+        else
+        {
+            // Other tensors of the checkpoint (int ids, ...) are not weights we compile
+            printf("Skipping %s: dtype %s\n", name.c_str(), dtype.c_str());
+            continue;
+        }
+
+        tensor.data = payload + offsets[0];
+        tensor.bytes = offsets[1] - offsets[0];
+        tensors_.push_back(tensor);
+    } while (json.consume(','));
+
+    return json.consume('}');
+}
+
+// ---------------------------------------------------------------------------
+
+void WeightFile::drop_pages(const uint8_t *begin, uint64_t bytes)
+{
+    // Whole pages inside the range only, neighbours may still be needed
+    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) & ~(page - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(begin) + bytes) & ~(page - 1);
+    if (last > first)
+        madvise(reinterpret_cast<void *>(first), last - first, MADV_DONTNEED);
+}
+
+// `n` elements of `dtype` to FP16
+static void convert_to_fp16(const uint8_t *src, WeightDType dtype, uint16_t *dst, uint64_t n, std::vector<float> &scratch)
+{
+    switch (dtype)
+    {
+    case WeightDType::F16:
+        memcpy(dst, src, n * sizeof(uint16_t));
+        break;
+    case WeightDType::F32:
+        fp32_to_fp16_array(reinterpret_cast<const float *>(src), dst, n);
+        break;
+    case WeightDType::BF16:
+    {
+        // BF16 is the top half of an FP32
+        scratch.resize(n);
+        const uint16_t *bf16 = reinterpret_cast<const uint16_t *>(src);
+        uint32_t *bits = reinterpret_cast<uint32_t *>(scratch.data());
+        for (uint64_t i = 0; i < n; i++)
+            bits[i] = static_cast<uint32_t>(bf16[i]) << 16;
+        fp32_to_fp16_array(scratch.data(), dst, n);
+        break;
+    }
+    }
+}
+
+const uint16_t *WeightFile::fp16(const std::string &name, uint32_t rows, uint32_t cols, bool transposed,
+                                 std::vector<uint16_t> &storage)
+{
+    const WeightTensor *tensor = find(name);
+    if (tensor == nullptr)
+    {
+        printf("Tensor %s not found in %s\n", name.c_str(), path_.c_str());
+        return nullptr;
+    }
+
+    // A vector is a single row
+    std::vector<uint64_t> shape = tensor->shape;
+    if (shape.size() == 1)
+        shape.insert(shape.begin(), 1);
+
+    // The caller's flag picks the layout, the shape only has to agree with it
+    uint64_t expected_rows = transposed ? cols : rows;
+    uint64_t expected_cols = transposed ? rows : cols;
+    uint64_t elements = static_cast<uint64_t>(rows) * cols;
+    if (shape.size() != 2 || shape[0] != expected_rows || shape[1] != expected_cols ||
+        tensor->bytes != elements * dtype_bytes(tensor->dtype))
+    {
+        printf("Tensor %s (%s, %zu dims) does not fit [%lu, %lu]%s\n",
+               name.c_str(), weight_dtype_name(tensor->dtype), tensor->shape.size(), expected_rows, expected_cols,
+               transposed ? " (transposed)" : "");
+        return nullptr;
+    }
+
+    // Already what QNN wants: hand out the mapping itself
+    if (!transposed && tensor->dtype == WeightDType::F16)
+    {
+        printf("Tensor %s: f16 [%u, %u] used in place\n", name.c_str(), rows, cols);
+        return reinterpret_cast<const uint16_t *>(tensor->data);
+    }
+
+    storage.resize(elements);
+    std::vector<float> scratch;
+    uint32_t elem_bytes = dtype_bytes(tensor->dtype);
+    if (!transposed)
+    {
+        for (uint64_t begin = 0; begin < elements; begin += CHUNK_ELEMS)
+        {
+            uint64_t n = std::min(CHUNK_ELEMS, elements - begin);
+            const uint8_t *src = tensor->data + begin * elem_bytes;
+            convert_to_fp16(src, tensor->dtype, storage.data() + begin, n, scratch);
+            drop_pages(src, n * elem_bytes);
+        }
+    }
+    else
+    {
+        // Source is [cols, rows]: convert a block of its rows, then scatter them as destination columns
+        std::vector<uint16_t> block(static_cast<uint64_t>(TRANSPOSE_ROWS) * rows);
+        for (uint32_t k0 = 0; k0 < cols; k0 += TRANSPOSE_ROWS)
+        {
+            uint32_t kn = std::min(TRANSPOSE_ROWS, cols - k0);
+            const uint8_t *src = tensor->data + static_cast<uint64_t>(k0) * rows * elem_bytes;
+            convert_to_fp16(src, tensor->dtype, block.data(), static_cast<uint64_t>(kn) * rows, scratch);
+            for (uint32_t r = 0; r < rows; r++)
+            {
+                uint16_t *dst = storage.data() + static_cast<uint64_t>(r) * cols + k0;
+                for (uint32_t k = 0; k < kn; k++)
+                    dst[k] = block[static_cast<uint64_t>(k) * rows + r];
+            }
+            drop_pages(src, static_cast<uint64_t>(kn) * rows * elem_bytes);
+        }
+    }
+
+    printf("Tensor %s: %s [%lu, %lu] converted%s into f16 [%u, %u]\n", name.c_str(), weight_dtype_name(tensor->dtype),
+           shape[0], shape[1], transposed ? " and transposed" : "", rows, cols);
+    return storage.data();
+}
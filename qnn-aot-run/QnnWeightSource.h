@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class WeightDType
+{
+    F16,
+    BF16,
+    F32,
+};
+
+// --weight-file and friends of the AOT tools
+struct WeightSourceConfig
+{
+    std::string path;                  // --weight-file <.npy|.safetensors>, empty builds synthetic weights
+    std::string weight_name{"weight"}; // --weight-name, ignored for .npy
+    std::string bias_name{"bias"};     // --bias-name, zeros when the file has no such tensor
+    bool transposed{false};            // --weight-transposed, the file holds the graph weight as [cols, rows]
+};
+
+// Leaves `config` untouched when absent
+void parse_weight_source_arg(int argc, char **argv, WeightSourceConfig &config);
+
+// One tensor inside a mapped weight file
+struct WeightTensor
+{
+    std::string name;
+    WeightDType dtype;
+    std::vector<uint64_t> shape; // row-major; a Fortran-order .npy is reported transposed
+    const uint8_t *data;
+    uint64_t bytes;
+};
+
+/**
+ * Read-only mapping of a .npy or .safetensors checkpoint.
+ *
+ * Nothing is read until a tensor is requested. fp16() hands back a pointer
+ * into the mapping when the file already holds FP16 in the requested
+ * layout, so the weights exist once, as page cache. Other dtypes and
+ * transposed layouts are converted chunk by chunk into the caller's
+ * buffer, and the source pages of every finished chunk are dropped from
+ * the process, so peak RSS stays at one converted copy plus one chunk.
+ *
+ * Pointers stay valid until release(); QNN reads static tensor data up to
+ * graphFinalize.
+ */
+class WeightFile
+{
+public:
+    WeightFile() = default;
+    WeightFile(const WeightFile &) = delete;
+    WeightFile &operator=(const WeightFile &) = delete;
+    ~WeightFile() { release(); }
+
+    bool open(const std::string &path);
+    void release();
+
+    const std::vector<WeightTensor> &tensors() const { return tensors_; }
+    // A .npy holds one tensor, found under any name
+    const WeightTensor *find(const std::string &name) const;
+
+    // [rows, cols] of a 2-D tensor, swapped when `transposed`; false if missing or not 2-D
+    bool matrix_shape(const std::string &name, bool transposed, uint32_t &rows, uint32_t &cols) const;
+
+    /**
+     * `name` as a row-major FP16 [rows, cols] matrix. With `transposed` the
+     * tensor must be stored as [cols, rows] and is transposed on the way;
+     * the layout is never guessed from the shape, a square matrix looks the
+     * same either way. Returns nullptr when the tensor is missing or its
+     * shape does not match the layout.
+     */
+    const uint16_t *fp16(const std::string &name, uint32_t rows, uint32_t cols, bool transposed,
+                         std::vector<uint16_t> &storage);
+
+private:
+    bool parse_npy();
+    bool parse_safetensors();
+    void drop_pages(const uint8_t *begin, uint64_t bytes);
+
+    std::string path_;
+    uint8_t *data_{nullptr};
+    uint64_t size_{0};
+    std::vector<WeightTensor> tensors_;
+};
+
+const char *weight_dtype_name(WeightDType dtype);